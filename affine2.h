@@ -0,0 +1,99 @@
+#ifndef __BCOSTA_AFFINE2__
+#define __BCOSTA_AFFINE2__
+
+#include <math.h>
+#include "matrix3.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // 2D affine transform, the first two columns of a 2D Matrix3 in the row-vector
+    // convention of Vector2 * Matrix3:
+    //   x' = x * m[0] + y * m[2] + m[4]
+    //   y' = x * m[1] + y * m[3] + m[5]
+    // a * b applies a first, then b, as with Matrix3 products.
+    class Affine2
+    {
+    public:
+
+        float m[6];
+
+        // Identity.
+        Affine2()
+        {
+            m[0] = 1.f;
+            m[1] = 0.f;
+            m[2] = 0.f;
+            m[3] = 1.f;
+            m[4] = 0.f;
+            m[5] = 0.f;
+        }
+
+        Affine2(float m0, float m1, float m2, float m3, float m4, float m5)
+        {
+            m[0] = m0;
+            m[1] = m1;
+            m[2] = m2;
+            m[3] = m3;
+            m[4] = m4;
+            m[5] = m5;
+        }
+
+        Affine2 operator *(const Affine2 &b) const
+        {
+            return Affine2(
+                m[0] * b.m[0] + m[1] * b.m[2],
+                m[0] * b.m[1] + m[1] * b.m[3],
+                m[2] * b.m[0] + m[3] * b.m[2],
+                m[2] * b.m[1] + m[3] * b.m[3],
+                m[4] * b.m[0] + m[5] * b.m[2] + b.m[4],
+                m[4] * b.m[1] + m[5] * b.m[3] + b.m[5]
+            );
+        }
+
+        void operator *=(const Affine2 &b)
+        { *this = *this * b; }
+
+        Vector2 TransformPoint(const Vector2 &p) const
+        { return Vector2(p.x * m[0] + p.y * m[2] + m[4], p.x * m[1] + p.y * m[3] + m[5]); }
+
+        Vector2 TransformVector(const Vector2 &v) const
+        { return Vector2(v.x * m[0] + v.y * m[2], v.x * m[1] + v.y * m[3]); }
+
+        Affine2 Inverse() const
+        {
+            const float d = 1.f / (m[0] * m[3] - m[1] * m[2]);
+            const float a = m[3] * d, b = -m[1] * d, c = -m[2] * d, e = m[0] * d;
+            return Affine2(a, b, c, e, -(m[4] * a + m[5] * c), -(m[4] * b + m[5] * e));
+        }
+
+        Matrix3 ToMatrix3() const
+        { return Matrix3(m[0], m[1], 0.f, m[2], m[3], 0.f, m[4], m[5], 1.f); }
+
+        static Affine2 FromMatrix3(const Matrix3 &a)
+        { return Affine2(a.m[0], a.m[1], a.m[3], a.m[4], a.m[6], a.m[7]); }
+
+        static Affine2 Translation(const float x, const float y)
+        { return Affine2(1.f, 0.f, 0.f, 1.f, x, y); }
+
+        static Affine2 Scale(const float x, const float y)
+        { return Affine2(x, 0.f, 0.f, y, 0.f, 0.f); }
+
+        // Counter-clockwise by a radians, as Matrix3::RotationZAxis.
+        static Affine2 Rotation(const float a)
+        {
+            const float c = cos(a), s = sin(a);
+            return Affine2(c, s, -s, c, 0.f, 0.f);
+        }
+
+        // Scale about the pivot, rotate, then move the pivot to position.
+        static Affine2 Compose(const Vector2 &position, const float rotation, const Vector2 &scale,
+                               const Vector2 &pivot)
+        {
+            const float c = cos(rotation), s = sin(rotation);
+            const float a = c * scale.x, b = s * scale.x, d = -s * scale.y, e = c * scale.y;
+            return Affine2(a, b, d, e, position.x - pivot.x * a - pivot.y * d, position.y - pivot.x * b - pivot.y * e);
+        }
+    };
+}
+#endif // __BCOSTA_AFFINE2__
@@ -0,0 +1,64 @@
+#ifndef __BCOSTA_ALIGNED__
+#define __BCOSTA_ALIGNED__
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+namespace BCosta
+{
+    // Minimal std allocator returning 'Align'-byte aligned blocks, so that std::vector
+    // storage can be fed to SIMD loads. Defaults to a cache line.
+    template<typename T, size_t Align = 64>
+    class AlignedAllocator
+    {
+    public:
+
+        typedef T value_type;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<typename U>
+        struct rebind
+        {
+            typedef AlignedAllocator<U, Align> other;
+        };
+
+        AlignedAllocator()
+        { }
+
+        template<typename U>
+        AlignedAllocator(const AlignedAllocator<U, Align> &)
+        { }
+
+        T *allocate(size_t n)
+        {
+            // Over-allocate and keep the original pointer just before the aligned block.
+            void *raw = malloc(n * sizeof(T) + Align + sizeof(void *));
+            if (!raw) {
+                throw std::bad_alloc();
+            }
+            size_t p = ((size_t) raw + sizeof(void *) + Align - 1) & ~(Align - 1);
+            ((void **) p)[-1] = raw;
+            return (T *) p;
+        }
+
+        void deallocate(T *p, size_t)
+        {
+            if (p) {
+                free(((void **) p)[-1]);
+            }
+        }
+
+        bool operator ==(const AlignedAllocator &) const
+        { return true; }
+
+        bool operator !=(const AlignedAllocator &) const
+        { return false; }
+    };
+}
+#endif // __BCOSTA_ALIGNED__
@@ -0,0 +1,441 @@
+#include <math.h>
+#include <vector>
+#include "bounds.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "parallel.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 16384;
+
+namespace
+{
+    // Split [0, count) into per-thread ranges, run 'func(range_index, begin, end)' on each
+    // and return the number of ranges, so callers can reduce per-range results in order.
+    template<typename F>
+    unsigned int ForRanges(const unsigned int count, const F &func)
+    {
+        unsigned int ranges = count / grain;
+        ranges = ranges < 1 ? 1 : (ranges > Parallel::ThreadCount() ? Parallel::ThreadCount() : ranges);
+
+        Parallel::For(ranges, 1, [&](unsigned int first, unsigned int end) {
+            for (unsigned int r = first; r < end; r++) {
+                func(r, (unsigned int) ((unsigned long long) count * r / ranges),
+                     (unsigned int) ((unsigned long long) count * (r + 1) / ranges));
+            }
+        });
+        return ranges;
+    }
+
+    float Dist2(const Vector3 &a, const Vector3 &b)
+    {
+        const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    unsigned int Farthest(const Vector3 *points, const unsigned int count, const Vector3 &from)
+    {
+        std::vector<unsigned int> best(Parallel::ThreadCount());
+        std::vector<float> best_d2(best.size());
+
+        const unsigned int ranges = ForRanges(count, [&](unsigned int r, unsigned int begin, unsigned int end) {
+            unsigned int index = begin;
+            float d2 = -1.f;
+            for (unsigned int i = begin; i < end; i++) {
+                const float d = Dist2(points[i], from);
+                if (d > d2) {
+                    d2 = d;
+                    index = i;
+                }
+            }
+            best[r] = index;
+            best_d2[r] = d2;
+        });
+
+        unsigned int r_best = 0;
+        for (unsigned int r = 1; r < ranges; r++) {
+            if (best_d2[r] > best_d2[r_best]) {
+                r_best = r;
+            }
+        }
+        return best[r_best];
+    }
+
+    // Smallest sphere enclosing both spheres.
+    BoundingSphere Merge(const BoundingSphere &a, const BoundingSphere &b)
+    {
+        const float d = sqrtf(Dist2(a.center, b.center));
+        if (d + b.radius <= a.radius) {
+            return a;
+        }
+        if (d + a.radius <= b.radius) {
+            return b;
+        }
+        BoundingSphere s;
+        s.radius = (d + a.radius + b.radius) * .5f;
+        const float k = (s.radius - a.radius) / d;
+        s.center.Set(a.center.x + (b.center.x - a.center.x) * k,
+                     a.center.y + (b.center.y - a.center.y) * k,
+                     a.center.z + (b.center.z - a.center.z) * k);
+        return s;
+    }
+
+    // Ritter growth pass, visiting points from 'start' and wrapping around. Each range grows
+    // its own copy and copies are merged, which still encloses every point.
+    BoundingSphere Grow(const Vector3 *points, const unsigned int count, const BoundingSphere &seed,
+                        const unsigned int start)
+    {
+        std::vector<BoundingSphere> grown(Parallel::ThreadCount());
+
+        const unsigned int ranges = ForRanges(count, [&](unsigned int r, unsigned int begin, unsigned int end) {
+            BoundingSphere s = seed;
+            float r2 = s.radius * s.radius;
+            for (unsigned int k = begin; k < end; k++) {
+                unsigned int i = k + start;
+                i = i >= count ? i - count : i;
+                const float d2 = Dist2(points[i], s.center);
+                if (d2 > r2) {
+                    const float d = sqrtf(d2);
+                    const float radius = (s.radius + d) * .5f;
+                    const float t = (radius - s.radius) / d;
+                    s.center.Set(s.center.x + (points[i].x - s.center.x) * t,
+                                 s.center.y + (points[i].y - s.center.y) * t,
+                                 s.center.z + (points[i].z - s.center.z) * t);
+                    s.radius = radius;
+                    r2 = radius * radius;
+                }
+            }
+            grown[r] = s;
+        });
+
+        BoundingSphere s = grown[0];
+        for (unsigned int r = 1; r < ranges; r++) {
+            s = Merge(s, grown[r]);
+        }
+
+        // Exact radius for this center, which also absorbs rounding in the growth steps.
+        s.radius = sqrtf(Dist2(points[Farthest(points, count, s.center)], s.center));
+        return s;
+    }
+
+    Vector3 Column(const float m[9], const unsigned int j)
+    { return Vector3(m[j], m[3 + j], m[6 + j]); }
+
+    void TransformPoint(const Matrix4 &m, const Vector3 &p, Vector3 &r)
+    {
+        r.Set(m.m[0] * p.x + m.m[1] * p.y + m.m[2] * p.z + m.m[3],
+              m.m[4] * p.x + m.m[5] * p.y + m.m[6] * p.z + m.m[7],
+              m.m[8] * p.x + m.m[9] * p.y + m.m[10] * p.z + m.m[11]);
+    }
+
+    void TransformVector(const Matrix4 &m, const Vector3 &v, Vector3 &r)
+    {
+        r.Set(m.m[0] * v.x + m.m[1] * v.y + m.m[2] * v.z,
+              m.m[4] * v.x + m.m[5] * v.y + m.m[6] * v.z,
+              m.m[8] * v.x + m.m[9] * v.y + m.m[10] * v.z);
+    }
+
+    // Quaternion whose ToMatrix3 columns are the given right-handed orthonormal axes.
+    // FromMatrix3 reads its input transposed relative to ToMatrix3, hence axes as rows.
+    Quaternion FromAxes(const Vector3 &a0, const Vector3 &a1, const Vector3 &a2)
+    {
+        return Quaternion::FromMatrix3(Matrix3(
+            a0.x, a0.y, a0.z,
+            a1.x, a1.y, a1.z,
+            a2.x, a2.y, a2.z
+        ));
+    }
+}
+
+Aabb Bounds::FitAabb(const Vector3 *points, const unsigned int count)
+{
+    std::vector<Aabb> boxes(Parallel::ThreadCount());
+
+    const unsigned int ranges = ForRanges(count, [&](unsigned int r, unsigned int begin, unsigned int end) {
+        float lx = 3.4e38f, ly = 3.4e38f, lz = 3.4e38f;
+        float hx = -3.4e38f, hy = -3.4e38f, hz = -3.4e38f;
+        for (unsigned int i = begin; i < end; i++) {
+            const Vector3 &p = points[i];
+            lx = p.x < lx ? p.x : lx;
+            ly = p.y < ly ? p.y : ly;
+            lz = p.z < lz ? p.z : lz;
+            hx = p.x > hx ? p.x : hx;
+            hy = p.y > hy ? p.y : hy;
+            hz = p.z > hz ? p.z : hz;
+        }
+        boxes[r].min.Set(lx, ly, lz);
+        boxes[r].max.Set(hx, hy, hz);
+    });
+
+    Aabb box = boxes[0];
+    for (unsigned int r = 1; r < ranges; r++) {
+        const Aabb &b = boxes[r];
+        box.min.Set(b.min.x < box.min.x ? b.min.x : box.min.x,
+                    b.min.y < box.min.y ? b.min.y : box.min.y,
+                    b.min.z < box.min.z ? b.min.z : box.min.z);
+        box.max.Set(b.max.x > box.max.x ? b.max.x : box.max.x,
+                    b.max.y > box.max.y ? b.max.y : box.max.y,
+                    b.max.z > box.max.z ? b.max.z : box.max.z);
+    }
+    return box;
+}
+
+BoundingSphere Bounds::FitSphere(const Vector3 *points, const unsigned int count, const unsigned int refinements)
+{
+    BoundingSphere best;
+    if (!count) {
+        best.center = Vector3::origin;
+        best.radius = 0.f;
+        return best;
+    }
+
+    // Seed from an approximate farthest pair.
+    const unsigned int a = Farthest(points, count, points[0]);
+    const unsigned int b = Farthest(points, count, points[a]);
+    BoundingSphere seed;
+    seed.center.Set((points[a].x + points[b].x) * .5f, (points[a].y + points[b].y) * .5f,
+                    (points[a].z + points[b].z) * .5f);
+    seed.radius = sqrtf(Dist2(points[a], points[b])) * .5f;
+
+    best = Grow(points, count, seed, 0);
+
+    for (unsigned int k = 1; k <= refinements; k++) {
+        seed = best;
+        seed.radius *= .95f;
+        const BoundingSphere s = Grow(points, count, seed,
+                                      (unsigned int) ((unsigned long long) count * k / (refinements + 1)));
+        if (s.radius < best.radius) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+void Bounds::SymmetricEigen(const float m[6], float vectors[9], float values[3])
+{
+    double a[3][3] = {
+        {m[0], m[3], m[4]},
+        {m[3], m[1], m[5]},
+        {m[4], m[5], m[2]}
+    };
+    double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    static const unsigned int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+
+    for (unsigned int sweep = 0; sweep < 16; sweep++) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        const double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-24 * diag || off == 0.0) {
+            break;
+        }
+        for (unsigned int k = 0; k < 3; k++) {
+            const unsigned int p = pairs[k][0], q = pairs[k][1];
+            if (a[p][q] == 0.0) {
+                continue;
+            }
+            // Rotation in the (p, q) plane zeroing a[p][q]: A' = J^T A J.
+            const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+            const double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+            const double c = 1.0 / sqrt(t * t + 1.0);
+            const double s = t * c;
+
+            for (unsigned int i = 0; i < 3; i++) {
+                const double aip = a[i][p], aiq = a[i][q];
+                a[i][p] = c * aip - s * aiq;
+                a[i][q] = s * aip + c * aiq;
+            }
+            for (unsigned int j = 0; j < 3; j++) {
+                const double apj = a[p][j], aqj = a[q][j];
+                a[p][j] = c * apj - s * aqj;
+                a[q][j] = s * apj + c * aqj;
+            }
+            for (unsigned int i = 0; i < 3; i++) {
+                const double vip = v[i][p], viq = v[i][q];
+                v[i][p] = c * vip - s * viq;
+                v[i][q] = s * vip + c * viq;
+            }
+        }
+    }
+
+    // Sort by decreasing eigenvalue.
+    unsigned int order[3] = {0, 1, 2};
+    for (unsigned int i = 0; i < 2; i++) {
+        for (unsigned int j = i + 1; j < 3; j++) {
+            if (a[order[j]][order[j]] > a[order[i]][order[i]]) {
+                const unsigned int o = order[i];
+                order[i] = order[j];
+                order[j] = o;
+            }
+        }
+    }
+    for (unsigned int j = 0; j < 3; j++) {
+        values[j] = (float) a[order[j]][order[j]];
+        for (unsigned int i = 0; i < 3; i++) {
+            vectors[i * 3 + j] = (float) v[i][order[j]];
+        }
+    }
+
+    // Right-handed: third axis = first x second.
+    vectors[2] = vectors[3] * vectors[7] - vectors[6] * vectors[4];
+    vectors[5] = vectors[6] * vectors[1] - vectors[0] * vectors[7];
+    vectors[8] = vectors[0] * vectors[4] - vectors[3] * vectors[1];
+}
+
+Obb Bounds::FitObb(const Vector3 *points, const unsigned int count)
+{
+    Obb box;
+    box.center = Vector3::origin;
+    box.extents = Vector3::origin;
+    box.orientation = Quaternion();
+    if (!count) {
+        return box;
+    }
+
+    // Mean and covariance, accumulated in double per range.
+    std::vector<double> sums(Parallel::ThreadCount() * 9);
+    unsigned int ranges = ForRanges(count, [&](unsigned int r, unsigned int begin, unsigned int end) {
+        double s[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+        for (unsigned int i = begin; i < end; i++) {
+            const double x = points[i].x, y = points[i].y, z = points[i].z;
+            s[0] += x;
+            s[1] += y;
+            s[2] += z;
+            s[3] += x * x;
+            s[4] += y * y;
+            s[5] += z * z;
+            s[6] += x * y;
+            s[7] += x * z;
+            s[8] += y * z;
+        }
+        for (unsigned int k = 0; k < 9; k++) {
+            sums[r * 9 + k] = s[k];
+        }
+    });
+    double s[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    for (unsigned int r = 0; r < ranges; r++) {
+        for (unsigned int k = 0; k < 9; k++) {
+            s[k] += sums[r * 9 + k];
+        }
+    }
+    const double n = count;
+    const double mx = s[0] / n, my = s[1] / n, mz = s[2] / n;
+    const float covariance[6] = {
+        (float) (s[3] / n - mx * mx), (float) (s[4] / n - my * my), (float) (s[5] / n - mz * mz),
+        (float) (s[6] / n - mx * my), (float) (s[7] / n - mx * mz), (float) (s[8] / n - my * mz)
+    };
+
+    float axes[9], variances[3];
+    SymmetricEigen(covariance, axes, variances);
+    const Vector3 a0 = Column(axes, 0), a1 = Column(axes, 1), a2 = Column(axes, 2);
+
+    // Extent of the points along each axis.
+    std::vector<float> spans(Parallel::ThreadCount() * 6);
+    ranges = ForRanges(count, [&](unsigned int r, unsigned int begin, unsigned int end) {
+        float lo[3] = {3.4e38f, 3.4e38f, 3.4e38f}, hi[3] = {-3.4e38f, -3.4e38f, -3.4e38f};
+        for (unsigned int i = begin; i < end; i++) {
+            const float d[3] = {Vector3::Dot(points[i], a0), Vector3::Dot(points[i], a1), Vector3::Dot(points[i], a2)};
+            for (unsigned int k = 0; k < 3; k++) {
+                lo[k] = d[k] < lo[k] ? d[k] : lo[k];
+                hi[k] = d[k] > hi[k] ? d[k] : hi[k];
+            }
+        }
+        for (unsigned int k = 0; k < 3; k++) {
+            spans[r * 6 + k] = lo[k];
+            spans[r * 6 + 3 + k] = hi[k];
+        }
+    });
+    float lo[3] = {3.4e38f, 3.4e38f, 3.4e38f}, hi[3] = {-3.4e38f, -3.4e38f, -3.4e38f};
+    for (unsigned int r = 0; r < ranges; r++) {
+        for (unsigned int k = 0; k < 3; k++) {
+            lo[k] = spans[r * 6 + k] < lo[k] ? spans[r * 6 + k] : lo[k];
+            hi[k] = spans[r * 6 + 3 + k] > hi[k] ? spans[r * 6 + 3 + k] : hi[k];
+        }
+    }
+
+    const float c0 = (lo[0] + hi[0]) * .5f, c1 = (lo[1] + hi[1]) * .5f, c2 = (lo[2] + hi[2]) * .5f;
+    box.center.Set(a0.x * c0 + a1.x * c1 + a2.x * c2,
+                   a0.y * c0 + a1.y * c1 + a2.y * c2,
+                   a0.z * c0 + a1.z * c1 + a2.z * c2);
+    box.extents.Set((hi[0] - lo[0]) * .5f, (hi[1] - lo[1]) * .5f, (hi[2] - lo[2]) * .5f);
+    box.orientation = FromAxes(a0, a1, a2);
+    return box;
+}
+
+void Bounds::TransformObbs(const Obb *in, const Matrix4 *transforms, const unsigned int count, Obb *out)
+{
+    Parallel::For(count, 4096, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Matrix4 &m = transforms[i];
+            Quaternion q = in[i].orientation;
+            const Matrix3 r = q.ToMatrix3();
+
+            // Half-size vectors of the box after the linear part.
+            Vector3 b0, b1, b2;
+            TransformVector(m, Column(r.m, 0) * in[i].extents.x, b0);
+            TransformVector(m, Column(r.m, 1) * in[i].extents.y, b1);
+            TransformVector(m, Column(r.m, 2) * in[i].extents.z, b2);
+
+            // Orthonormalize; with shear the box is re-fitted around the parallelepiped.
+            Vector3 u0 = b0.Len2() > 0.f ? b0.Normalized() : Vector3(1.f, 0.f, 0.f);
+            Vector3 u1 = b1 - u0 * Vector3::Dot(u0, b1);
+            if (u1.Len2() <= 1e-12f * b1.Len2() || u1.Len2() == 0.f) {
+                u1 = fabsf(u0.x) < .9f ? Vector3(1.f, 0.f, 0.f) : Vector3(0.f, 1.f, 0.f);
+                u1 = u1 - u0 * Vector3::Dot(u0, u1);
+            }
+            u1.normalize();
+            Vector3 u2;
+            Vector3::Cross(u2, u0, u1);
+
+            Obb &o = out[i];
+            TransformPoint(m, in[i].center, o.center);
+            o.extents.Set(fabsf(Vector3::Dot(u0, b0)) + fabsf(Vector3::Dot(u0, b1)) + fabsf(Vector3::Dot(u0, b2)),
+                          fabsf(Vector3::Dot(u1, b0)) + fabsf(Vector3::Dot(u1, b1)) + fabsf(Vector3::Dot(u1, b2)),
+                          fabsf(Vector3::Dot(u2, b0)) + fabsf(Vector3::Dot(u2, b1)) + fabsf(Vector3::Dot(u2, b2)));
+            o.orientation = FromAxes(u0, u1, u2);
+        }
+    });
+}
+
+void Bounds::TransformSpheres(const BoundingSphere *in, const Matrix4 *transforms, const unsigned int count,
+                              BoundingSphere *out)
+{
+    Parallel::For(count, 4096, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            // Largest stretch of the linear part: the square root of the largest eigenvalue
+            // of MtM, bounded by its largest absolute row sum (Gershgorin), which is exact
+            // for rotation and scale, and by its trace (Frobenius), tighter under shear.
+            const float *m = transforms[i].m;
+            const float g00 = m[0] * m[0] + m[4] * m[4] + m[8] * m[8];
+            const float g11 = m[1] * m[1] + m[5] * m[5] + m[9] * m[9];
+            const float g22 = m[2] * m[2] + m[6] * m[6] + m[10] * m[10];
+            const float g01 = fabsf(m[0] * m[1] + m[4] * m[5] + m[8] * m[9]);
+            const float g02 = fabsf(m[0] * m[2] + m[4] * m[6] + m[8] * m[10]);
+            const float g12 = fabsf(m[1] * m[2] + m[5] * m[6] + m[9] * m[10]);
+            const float r0 = g00 + g01 + g02, r1 = g11 + g01 + g12, r2 = g22 + g02 + g12;
+            const float rows = r0 > r1 ? (r0 > r2 ? r0 : r2) : (r1 > r2 ? r1 : r2);
+            const float trace = g00 + g11 + g22;
+
+            TransformPoint(transforms[i], in[i].center, out[i].center);
+            out[i].radius = in[i].radius * sqrtf(rows < trace ? rows : trace);
+        }
+    });
+}
+
+void Bounds::TransformAabbs(const Aabb *in, const Matrix4 *transforms, const unsigned int count, Aabb *out)
+{
+    Parallel::For(count, 4096, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const float *m = transforms[i].m;
+            const Vector3 c = in[i].Center(), e = in[i].Extents();
+
+            Vector3 center;
+            TransformPoint(transforms[i], c, center);
+            const float ex = fabsf(m[0]) * e.x + fabsf(m[1]) * e.y + fabsf(m[2]) * e.z;
+            const float ey = fabsf(m[4]) * e.x + fabsf(m[5]) * e.y + fabsf(m[6]) * e.z;
+            const float ez = fabsf(m[8]) * e.x + fabsf(m[9]) * e.y + fabsf(m[10]) * e.z;
+
+            out[i].min.Set(center.x - ex, center.y - ey, center.z - ez);
+            out[i].max.Set(center.x + ex, center.y + ey, center.z + ez);
+        }
+    });
+}
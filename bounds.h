@@ -0,0 +1,69 @@
+#ifndef __BCOSTA_BOUNDS__
+#define __BCOSTA_BOUNDS__
+
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    struct Aabb
+    {
+        Vector3 min, max;
+
+        Vector3 Center() const
+        { return Vector3((min.x + max.x) * .5f, (min.y + max.y) * .5f, (min.z + max.z) * .5f); }
+
+        Vector3 Extents() const
+        { return Vector3((max.x - min.x) * .5f, (max.y - min.y) * .5f, (max.z - min.z) * .5f); }
+    };
+
+    struct BoundingSphere
+    {
+        Vector3 center;
+        float radius;
+    };
+
+    // Oriented box: local axes are the columns of orientation.ToMatrix3(), 'extents' are the
+    // half sizes along them.
+    struct Obb
+    {
+        Vector3 center;
+        Vector3 extents;
+        Quaternion orientation;
+    };
+
+    // Bounding volume fitting over point sets. Fits split the points into ranges reduced in
+    // parallel, so they scale to millions of points.
+    namespace Bounds
+    {
+        Aabb FitAabb(const Vector3 *points, const unsigned int count);
+
+        // Ritter's sphere (farthest-pair seed, then growth over every point), refined by
+        // 'refinements' passes that shrink the sphere and regrow it from a different point
+        // order, keeping the smallest enclosing result. Typically within a few percent of
+        // the minimal sphere.
+        BoundingSphere FitSphere(const Vector3 *points, const unsigned int count, const unsigned int refinements = 8);
+
+        // Box aligned with the principal axes of the point covariance.
+        Obb FitObb(const Vector3 *points, const unsigned int count);
+
+        // Eigen decomposition of a symmetric 3x3 matrix given as (xx, yy, zz, xy, xz, yz) by
+        // cyclic Jacobi rotations. Eigenvectors are the columns of 'vectors', forming a
+        // right-handed basis, sorted by decreasing eigenvalue.
+        void SymmetricEigen(const float m[6], float vectors[9], float values[3]);
+
+        // Per-instance world bounds: out[i] = in[i] transformed by transforms[i]. Affine
+        // transforms with scale or shear are supported; boxes stay enclosing.
+        void TransformObbs(const Obb *in, const Matrix4 *transforms, const unsigned int count, Obb *out);
+
+        // Radii grow by a bound on the largest stretch of the transform: exact for rotation
+        // and scale, conservative under shear.
+        void TransformSpheres(const BoundingSphere *in, const Matrix4 *transforms, const unsigned int count,
+                              BoundingSphere *out);
+
+        void TransformAabbs(const Aabb *in, const Matrix4 *transforms, const unsigned int count, Aabb *out);
+    }
+}
+#endif // __BCOSTA_BOUNDS__
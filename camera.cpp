@@ -0,0 +1,244 @@
+#include <math.h>
+#include "camera.h"
+#include "decompose.h"
+#include "math.h"
+#include "matrix3.h"
+#include "parallel.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 16;
+
+namespace
+{
+    Vector3 Sub(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+    Vector3 Cross(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+    Vector3 Normalized(const Vector3 &v)
+    {
+        const float k = 1.f / sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+        return Vector3(v.x * k, v.y * k, v.z * k);
+    }
+
+    // a * b where b is affine (last row 0 0 0 1).
+    void MultiplyByAffine(const float *a, const float *b, float *out)
+    {
+        for (unsigned int i = 0; i < 16; i += 4) {
+            for (unsigned int j = 0; j < 4; j++) {
+                out[i + j] = a[i] * b[j] + a[i + 1] * b[4 + j] + a[i + 2] * b[8 + j];
+            }
+            out[i + 3] += a[i + 3];
+        }
+    }
+
+    // a * b where a is affine.
+    void AffineMultiply(const float *a, const float *b, float *out)
+    {
+        for (unsigned int i = 0; i < 12; i += 4) {
+            for (unsigned int j = 0; j < 4; j++) {
+                out[i + j] = a[i] * b[j] + a[i + 1] * b[4 + j] + a[i + 2] * b[8 + j] + a[i + 3] * b[12 + j];
+            }
+        }
+        for (unsigned int j = 0; j < 4; j++) {
+            out[12 + j] = b[12 + j];
+        }
+    }
+}
+
+Camera::Camera()
+    : position(0.f, 0.f, 0.f), orientation(0.f, 0.f, 0.f, 1.f), type(Projection_Perspective), valid(0)
+{
+    SetPerspective(60.f, 1.f, .1f, 1000.f);
+}
+
+void Camera::SetPosition(const Vector3 &_position)
+{
+    position = _position;
+    valid &= ~(Cache_View | Cache_ViewProjection | Cache_InverseView | Cache_InverseViewProjection);
+}
+
+void Camera::SetOrientation(const Quaternion &_orientation)
+{
+    orientation = _orientation;
+    valid &= ~(Cache_View | Cache_ViewProjection | Cache_InverseView | Cache_InverseViewProjection);
+}
+
+void Camera::LookAt(const Vector3 &_position, const Vector3 &target, const Vector3 &up)
+{
+    const Vector3 forward = Normalized(Sub(target, _position));
+    const Vector3 right = Normalized(Cross(forward, up));
+    const Vector3 true_up = Cross(right, forward);
+
+    const Matrix3 r(
+        right.x, true_up.x, -forward.x,
+        right.y, true_up.y, -forward.y,
+        right.z, true_up.z, -forward.z
+    );
+
+    position = _position;
+    orientation = Decompose::RotationToQuaternion(r);
+    valid &= ~(Cache_View | Cache_ViewProjection | Cache_InverseView | Cache_InverseViewProjection);
+}
+
+void Camera::SetPerspective(const float fov, const float ratio, const float z_near, const float z_far)
+{
+    type = Projection_Perspective;
+    parameters[0] = fov;
+    parameters[1] = ratio;
+    parameters[2] = z_near;
+    parameters[3] = z_far;
+    valid &= ~(Cache_Projection | Cache_ViewProjection | Cache_InverseProjection | Cache_InverseViewProjection);
+}
+
+void Camera::SetOrthographic(const float l, const float r, const float b, const float t, const float n, const float f)
+{
+    type = Projection_Orthographic;
+    parameters[0] = l;
+    parameters[1] = r;
+    parameters[2] = b;
+    parameters[3] = t;
+    parameters[4] = n;
+    parameters[5] = f;
+    valid &= ~(Cache_Projection | Cache_ViewProjection | Cache_InverseProjection | Cache_InverseViewProjection);
+}
+
+const Matrix4 &Camera::View() const
+{
+    if (!(valid & Cache_View)) {
+        float r[9];
+        // Columns of the rotation are the camera axes in world space.
+        orientation.ToRotationScale(Vector3(1.f, 1.f, 1.f), r);
+
+        // Transposed rotation, then the position brought into camera space.
+        float *m = view.m;
+        for (unsigned int i = 0; i < 3; i++) {
+            m[i * 4] = r[i];
+            m[i * 4 + 1] = r[3 + i];
+            m[i * 4 + 2] = r[6 + i];
+            m[i * 4 + 3] = -(r[i] * position.x + r[3 + i] * position.y + r[6 + i] * position.z);
+        }
+        m[12] = m[13] = m[14] = 0.f;
+        m[15] = 1.f;
+        valid |= Cache_View;
+    }
+    return view;
+}
+
+const Matrix4 &Camera::InverseView() const
+{
+    if (!(valid & Cache_InverseView)) {
+        float r[9];
+        orientation.ToRotationScale(Vector3(1.f, 1.f, 1.f), r);
+
+        float *m = inverse_view.m;
+        for (unsigned int i = 0; i < 3; i++) {
+            m[i * 4] = r[i * 3];
+            m[i * 4 + 1] = r[i * 3 + 1];
+            m[i * 4 + 2] = r[i * 3 + 2];
+        }
+        m[3] = position.x;
+        m[7] = position.y;
+        m[11] = position.z;
+        m[12] = m[13] = m[14] = 0.f;
+        m[15] = 1.f;
+        valid |= Cache_InverseView;
+    }
+    return inverse_view;
+}
+
+const Matrix4 &Camera::Projection() const
+{
+    if (!(valid & Cache_Projection)) {
+        const float *p = parameters;
+        if (type == Projection_Perspective) {
+            const float f = 1.f / tanf(Math::radians(p[0]) * .5f);
+            const float q = 1.f / (p[2] - p[3]);
+            projection.Set(
+                f / p[1], 0.f, 0.f, 0.f,
+                0.f, f, 0.f, 0.f,
+                0.f, 0.f, (p[2] + p[3]) * q, 2.f * p[2] * p[3] * q,
+                0.f, 0.f, -1.f, 0.f
+            );
+        } else {
+            const float w = 1.f / (p[1] - p[0]), h = 1.f / (p[3] - p[2]), d = 1.f / (p[5] - p[4]);
+            projection.Set(
+                2.f * w, 0.f, 0.f, -(p[1] + p[0]) * w,
+                0.f, 2.f * h, 0.f, -(p[3] + p[2]) * h,
+                0.f, 0.f, -2.f * d, -(p[5] + p[4]) * d,
+                0.f, 0.f, 0.f, 1.f
+            );
+        }
+        valid |= Cache_Projection;
+    }
+    return projection;
+}
+
+const Matrix4 &Camera::InverseProjection() const
+{
+    if (!(valid & Cache_InverseProjection)) {
+        const float *p = parameters;
+        if (type == Projection_Perspective) {
+            const float t = tanf(Math::radians(p[0]) * .5f);
+            const float b = .5f / (p[2] * p[3]);
+            inverse_projection.Set(
+                t * p[1], 0.f, 0.f, 0.f,
+                0.f, t, 0.f, 0.f,
+                0.f, 0.f, 0.f, -1.f,
+                0.f, 0.f, (p[2] - p[3]) * b, (p[2] + p[3]) * b
+            );
+        } else {
+            inverse_projection.Set(
+                .5f * (p[1] - p[0]), 0.f, 0.f, .5f * (p[1] + p[0]),
+                0.f, .5f * (p[3] - p[2]), 0.f, .5f * (p[3] + p[2]),
+                0.f, 0.f, -.5f * (p[5] - p[4]), -.5f * (p[5] + p[4]),
+                0.f, 0.f, 0.f, 1.f
+            );
+        }
+        valid |= Cache_InverseProjection;
+    }
+    return inverse_projection;
+}
+
+const Matrix4 &Camera::ViewProjection() const
+{
+    if (!(valid & Cache_ViewProjection)) {
+        MultiplyByAffine(Projection().m, View().m, view_projection.m);
+        valid |= Cache_ViewProjection;
+    }
+    return view_projection;
+}
+
+const Matrix4 &Camera::InverseViewProjection() const
+{
+    if (!(valid & Cache_InverseViewProjection)) {
+        AffineMultiply(InverseView().m, InverseProjection().m, inverse_view_projection.m);
+        valid |= Cache_InverseViewProjection;
+    }
+    return inverse_view_projection;
+}
+
+Vector3 Camera::Unproject(const Vector3 &ndc) const
+{
+    const float *m = InverseViewProjection().m;
+    const float w = 1.f / (m[12] * ndc.x + m[13] * ndc.y + m[14] * ndc.z + m[15]);
+    return Vector3(
+        (m[0] * ndc.x + m[1] * ndc.y + m[2] * ndc.z + m[3]) * w,
+        (m[4] * ndc.x + m[5] * ndc.y + m[6] * ndc.z + m[7]) * w,
+        (m[8] * ndc.x + m[9] * ndc.y + m[10] * ndc.z + m[11]) * w
+    );
+}
+
+void Camera::Update(const Camera *cameras, const unsigned int count)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            if (cameras[i].valid != Cache_All) {
+                cameras[i].ViewProjection();
+                cameras[i].InverseViewProjection();
+            }
+        }
+    });
+}
@@ -0,0 +1,98 @@
+#ifndef __BCOSTA_CAMERA__
+#define __BCOSTA_CAMERA__
+
+#include "matrix4.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Camera with position, orientation and projection parameters. View, projection,
+    // view-projection and their inverses are built in closed form on first use after the
+    // inputs they depend on change; repeated queries within a frame are free.
+    //
+    // The camera looks down its local -Z axis with +Y up, and projections map depth to
+    // [-1, 1] as Math::persp does.
+    class Camera
+    {
+    public:
+
+        enum ProjectionType
+        {
+            Projection_Perspective = 0,
+            Projection_Orthographic
+        };
+
+        Camera();
+
+        void SetPosition(const Vector3 &_position);
+
+        // Local to world rotation; expected to be unit length.
+        void SetOrientation(const Quaternion &_orientation);
+
+        // Place the camera at position looking towards target. up need not be orthogonal
+        // to the view direction but must not be parallel to it.
+        void LookAt(const Vector3 &_position, const Vector3 &target, const Vector3 &up);
+
+        // fov is the vertical field of view in degrees, as in Math::persp.
+        void SetPerspective(const float fov, const float ratio, const float z_near, const float z_far);
+
+        void SetOrthographic(const float l, const float r, const float b, const float t, const float n, const float f);
+
+        const Vector3 &Position() const
+        { return position; }
+
+        const Quaternion &Orientation() const
+        { return orientation; }
+
+        ProjectionType Type() const
+        { return type; }
+
+        const Matrix4 &View() const;
+
+        const Matrix4 &Projection() const;
+
+        const Matrix4 &ViewProjection() const;
+
+        const Matrix4 &InverseView() const;
+
+        const Matrix4 &InverseProjection() const;
+
+        const Matrix4 &InverseViewProjection() const;
+
+        // Normalized device coordinates to world space.
+        Vector3 Unproject(const Vector3 &ndc) const;
+
+        // Bring every cached matrix of every camera up to date, cameras split across threads.
+        // For cascaded shadow maps and split-screen, where all views are needed each frame.
+        static void Update(const Camera *cameras, const unsigned int count);
+
+    private:
+
+        enum Cache
+        {
+            Cache_View = 1 << 0,
+            Cache_Projection = 1 << 1,
+            Cache_ViewProjection = 1 << 2,
+            Cache_InverseView = 1 << 3,
+            Cache_InverseProjection = 1 << 4,
+            Cache_InverseViewProjection = 1 << 5,
+            Cache_All = (1 << 6) - 1
+        };
+
+        Vector3 position;
+        Quaternion orientation;
+
+        ProjectionType type;
+
+        // Perspective: fov (degrees), ratio, near, far. Orthographic: l, r, b, t, n, f.
+        float parameters[6];
+
+        // Cache bits of the matrices that are current.
+        mutable unsigned int valid;
+
+        mutable Matrix4 view, projection, view_projection;
+        mutable Matrix4 inverse_view, inverse_projection, inverse_view_projection;
+    };
+}
+#endif // __BCOSTA_CAMERA__
@@ -0,0 +1,715 @@
+#include <math.h>
+#include "collision.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "parallel.h"
+
+using namespace BCosta;
+
+static const unsigned int max_gjk_iterations = 64;
+static const unsigned int max_epa_iterations = 64;
+
+// EPA polytope capacity; every iteration adds one vertex and at most a few faces.
+static const unsigned int max_epa_vertices = max_epa_iterations + 4;
+static const unsigned int max_epa_faces = 2 * max_epa_vertices;
+
+// Relative progress under which GJK stops, and squared distance treated as contact.
+static const float gjk_tolerance = 1e-6f;
+static const float contact_tolerance2 = 1e-12f;
+static const float epa_tolerance = 1e-4f;
+
+namespace
+{
+    Vector3 Add(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x + b.x, a.y + b.y, a.z + b.z); }
+
+    Vector3 Sub(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+    Vector3 Mul(const Vector3 &a, const float k)
+    { return Vector3(a.x * k, a.y * k, a.z * k); }
+
+    Vector3 Cross(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+    float Dot(const Vector3 &a, const Vector3 &b)
+    { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    // A shape bound to its pose, answering world-space support queries.
+    struct Support
+    {
+        const ConvexShape &shape;
+        const ConvexPose &pose;
+
+        Support(const ConvexShape &_shape, const ConvexPose &_pose)
+            : shape(_shape), pose(_pose)
+        { }
+
+        float Margin() const
+        { return shape.type == ConvexShape::Shape_Sphere || shape.type == ConvexShape::Shape_Capsule ? shape.radius : 0.f; }
+
+        // Farthest point of the core along world direction d.
+        Vector3 Core(const Vector3 &d) const
+        {
+            const float *l = pose.linear;
+            const Vector3 dl(l[0] * d.x + l[3] * d.y + l[6] * d.z,
+                             l[1] * d.x + l[4] * d.y + l[7] * d.z,
+                             l[2] * d.x + l[5] * d.y + l[8] * d.z);
+            Vector3 p;
+            switch (shape.type) {
+                case ConvexShape::Shape_Sphere:
+                    p.Set(0.f, 0.f, 0.f);
+                    break;
+                case ConvexShape::Shape_Capsule:
+                    p.Set(0.f, dl.y >= 0.f ? shape.half_height : -shape.half_height, 0.f);
+                    break;
+                case ConvexShape::Shape_Box:
+                    p.Set(dl.x >= 0.f ? shape.half_extents.x : -shape.half_extents.x,
+                          dl.y >= 0.f ? shape.half_extents.y : -shape.half_extents.y,
+                          dl.z >= 0.f ? shape.half_extents.z : -shape.half_extents.z);
+                    break;
+                case ConvexShape::Shape_Hull: {
+                    unsigned int best = 0;
+                    float best_dot = Dot(shape.points[0], dl);
+                    for (unsigned int i = 1; i < shape.point_count; i++) {
+                        const float dot = Dot(shape.points[i], dl);
+                        if (dot > best_dot) {
+                            best_dot = dot;
+                            best = i;
+                        }
+                    }
+                    p = shape.points[best];
+                    break;
+                }
+            }
+            return Vector3(l[0] * p.x + l[1] * p.y + l[2] * p.z + pose.translation.x,
+                           l[3] * p.x + l[4] * p.y + l[5] * p.z + pose.translation.y,
+                           l[6] * p.x + l[7] * p.y + l[8] * p.z + pose.translation.z);
+        }
+    };
+
+    // Point of the Minkowski difference A - B with the shape points it comes from and the
+    // search direction that found it.
+    struct SimplexVertex
+    {
+        Vector3 w, a, b, d;
+    };
+
+    SimplexVertex SupportCore(const Support &a, const Support &b, const Vector3 &d)
+    {
+        SimplexVertex v;
+        v.d = d;
+        v.a = a.Core(d);
+        v.b = b.Core(Mul(d, -1.f));
+        v.w = Sub(v.a, v.b);
+        return v;
+    }
+
+    struct Simplex
+    {
+        SimplexVertex v[4];
+        float lambda[4];
+        unsigned int n;
+
+        void Keep1(const unsigned int i)
+        {
+            v[0] = v[i];
+            lambda[0] = 1.f;
+            n = 1;
+        }
+
+        void Keep2(const unsigned int i, const unsigned int j, const float t)
+        {
+            const SimplexVertex vi = v[i], vj = v[j];
+            v[0] = vi;
+            v[1] = vj;
+            lambda[0] = 1.f - t;
+            lambda[1] = t;
+            n = 2;
+        }
+
+        Vector3 Point() const
+        {
+            Vector3 p(0.f, 0.f, 0.f);
+            for (unsigned int i = 0; i < n; i++) {
+                p = Add(p, Mul(v[i].w, lambda[i]));
+            }
+            return p;
+        }
+
+        void Witnesses(Vector3 &pa, Vector3 &pb) const
+        {
+            pa.Set(0.f, 0.f, 0.f);
+            pb.Set(0.f, 0.f, 0.f);
+            for (unsigned int i = 0; i < n; i++) {
+                pa = Add(pa, Mul(v[i].a, lambda[i]));
+                pb = Add(pb, Mul(v[i].b, lambda[i]));
+            }
+        }
+
+        void SolveSegment()
+        {
+            const Vector3 ab = Sub(v[1].w, v[0].w);
+            const float len2 = Dot(ab, ab);
+            const float t = len2 > 0.f ? -Dot(v[0].w, ab) / len2 : 0.f;
+            if (t <= 0.f) {
+                Keep1(0);
+            } else if (t >= 1.f) {
+                Keep1(1);
+            } else {
+                Keep2(0, 1, t);
+            }
+        }
+
+        // Closest point of triangle (i, j, k) to the origin (Ericson's region tests); reduces
+        // the simplex to the closest feature.
+        void SolveTriangle(const unsigned int i, const unsigned int j, const unsigned int k)
+        {
+            const SimplexVertex a = v[i], b = v[j], c = v[k];
+            const Vector3 ab = Sub(b.w, a.w), ac = Sub(c.w, a.w);
+
+            const float d1 = -Dot(ab, a.w), d2 = -Dot(ac, a.w);
+            if (d1 <= 0.f && d2 <= 0.f) {
+                Keep1(i);
+                return;
+            }
+            const float d3 = -Dot(ab, b.w), d4 = -Dot(ac, b.w);
+            if (d3 >= 0.f && d4 <= d3) {
+                Keep1(j);
+                return;
+            }
+            const float vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+                Keep2(i, j, d1 / (d1 - d3));
+                return;
+            }
+            const float d5 = -Dot(ab, c.w), d6 = -Dot(ac, c.w);
+            if (d6 >= 0.f && d5 <= d6) {
+                Keep1(k);
+                return;
+            }
+            const float vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+                Keep2(i, k, d2 / (d2 - d6));
+                return;
+            }
+            const float va = d3 * d6 - d5 * d4;
+            if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) {
+                Keep2(j, k, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+                return;
+            }
+            if (!(va + vb + vc > 0.f)) {
+                // Collinear vertices that slipped through the region tests.
+                Keep1(Dot(a.w, a.w) <= Dot(b.w, b.w) ? (Dot(a.w, a.w) <= Dot(c.w, c.w) ? i : k)
+                                                     : (Dot(b.w, b.w) <= Dot(c.w, c.w) ? j : k));
+                return;
+            }
+            const float denom = 1.f / (va + vb + vc);
+            v[0] = a;
+            v[1] = b;
+            v[2] = c;
+            lambda[1] = vb * denom;
+            lambda[2] = vc * denom;
+            lambda[0] = 1.f - lambda[1] - lambda[2];
+            n = 3;
+        }
+
+        // Return true when the origin is inside the tetrahedron, otherwise reduce to the
+        // closest face feature.
+        bool SolveTetrahedron()
+        {
+            static const unsigned int faces[4][4] = {{1, 2, 3, 0}, {0, 3, 2, 1}, {0, 1, 3, 2}, {0, 2, 1, 3}};
+            const Simplex start = *this;
+
+            // The origin is inside when it is on the inner side of every face. Side tests are
+            // noise on a nearly flat tetrahedron, which therefore never counts as enclosing.
+            const Vector3 e1 = Sub(v[1].w, v[0].w), e2 = Sub(v[2].w, v[0].w), e3 = Sub(v[3].w, v[0].w);
+            const float scale = Dot(e1, e1) + Dot(e2, e2) + Dot(e3, e3);
+            bool inside = fabsf(Dot(Cross(e1, e2), e3)) > 1e-6f * scale * sqrtf(scale);
+            for (unsigned int f = 0; f < 4 && inside; f++) {
+                const Vector3 &p0 = v[faces[f][0]].w, &p1 = v[faces[f][1]].w, &p2 = v[faces[f][2]].w;
+                const Vector3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+                inside = Dot(normal, p0) * Dot(normal, Sub(v[faces[f][3]].w, p0)) <= 0.f;
+            }
+
+            if (inside) {
+                float total = 0.f;
+                for (unsigned int f = 0; f < 4; f++) {
+                    const Vector3 &p0 = v[faces[f][0]].w, &p1 = v[faces[f][1]].w, &p2 = v[faces[f][2]].w;
+                    lambda[faces[f][3]] = fabsf(Dot(Cross(p1, p2), p0));
+                    total += lambda[faces[f][3]];
+                }
+                for (unsigned int f = 0; f < 4; f++) {
+                    lambda[f] = total > 0.f ? lambda[f] / total : .25f;
+                }
+                return true;
+            }
+
+            // Otherwise the closest point is on one of the faces.
+            float best_d2 = -1.f;
+            Simplex best = start;
+            for (unsigned int f = 0; f < 4; f++) {
+                Simplex s = start;
+                s.SolveTriangle(faces[f][0], faces[f][1], faces[f][2]);
+                const Vector3 p = s.Point();
+                const float d2 = Dot(p, p);
+                if (best_d2 < 0.f || d2 < best_d2) {
+                    best_d2 = d2;
+                    best = s;
+                }
+            }
+            *this = best;
+            return false;
+        }
+
+        // Reduce to the feature closest to the origin; true when the origin is enclosed.
+        bool Solve()
+        {
+            switch (n) {
+                case 1:
+                    lambda[0] = 1.f;
+                    return false;
+                case 2:
+                    SolveSegment();
+                    return false;
+                case 3:
+                    SolveTriangle(0, 1, 2);
+                    return false;
+                default:
+                    return SolveTetrahedron();
+            }
+        }
+    };
+
+    enum GjkStatus
+    {
+        Gjk_Overlap,
+        Gjk_Closest,
+        Gjk_Separated
+    };
+
+    bool Contains(const Simplex &simplex, const SimplexVertex &w)
+    {
+        for (unsigned int i = 0; i < simplex.n; i++) {
+            const Vector3 d = Sub(simplex.v[i].w, w.w);
+            if (Dot(d, d) == 0.f) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // GJK on the shape cores. On Gjk_Closest 'v' is the closest point of A - B to the origin.
+    // With 'separation' >= 0 the search gives up with Gjk_Separated as soon as the cores are
+    // proven farther apart than that.
+    //
+    // A cache restarts from last query's simplex, re-evaluated at the current poses: for
+    // coherent motion it is already at or next to the answer.
+    GjkStatus Gjk(const Support &a, const Support &b, Simplex &simplex, Vector3 &v, unsigned int &iterations,
+                  const GjkCache *cache, const float separation = -1.f)
+    {
+        iterations = 0;
+        simplex.n = 0;
+        for (unsigned int i = 0; cache && i < cache->count; i++) {
+            const SimplexVertex w = SupportCore(a, b, cache->directions[i]);
+            if (!Contains(simplex, w)) {
+                simplex.v[simplex.n++] = w;
+            }
+        }
+
+        if (simplex.n > 0) {
+            if (simplex.Solve()) {
+                v.Set(0.f, 0.f, 0.f);
+                return Gjk_Overlap;
+            }
+            v = simplex.Point();
+            if (Dot(v, v) < contact_tolerance2) {
+                return Gjk_Overlap;
+            }
+        } else {
+            v = Sub(a.pose.translation, b.pose.translation);
+            if (Dot(v, v) < contact_tolerance2) {
+                v.Set(1.f, 0.f, 0.f);
+            }
+        }
+
+        for (; iterations < max_gjk_iterations; iterations++) {
+            const SimplexVertex w = SupportCore(a, b, Mul(v, -1.f));
+            const float vv = Dot(v, v);
+            const float vw = Dot(v, w.w);
+
+            // Every point x of A - B has x.v >= w.v, so the distance is at least w.v / |v|.
+            if (separation >= 0.f && vw > 0.f && vw * vw > separation * separation * vv) {
+                return Gjk_Separated;
+            }
+            if (simplex.n > 0) {
+                if (vv - vw <= gjk_tolerance * vv || Contains(simplex, w)) {
+                    return Gjk_Closest;
+                }
+            }
+
+            const bool had_simplex = simplex.n > 0;
+            simplex.v[simplex.n++] = w;
+            if (simplex.Solve()) {
+                v.Set(0.f, 0.f, 0.f);
+                return Gjk_Overlap;
+            }
+            v = simplex.Point();
+            const float next_vv = Dot(v, v);
+            if (next_vv < contact_tolerance2) {
+                return Gjk_Overlap;
+            }
+            // No progress: rounding made the new vertex fall off the simplex again.
+            if (had_simplex && next_vv >= vv) {
+                return Gjk_Closest;
+            }
+        }
+        return Gjk_Closest;
+    }
+
+    struct EpaFace
+    {
+        unsigned int v[3];
+        Vector3 normal;
+        float distance;
+    };
+
+    bool MakeFace(const SimplexVertex *vertices, const unsigned int i, const unsigned int j, const unsigned int k,
+                  EpaFace &face)
+    {
+        const Vector3 normal = Cross(Sub(vertices[j].w, vertices[i].w), Sub(vertices[k].w, vertices[i].w));
+        const float len = sqrtf(Dot(normal, normal));
+        if (len <= 0.f) {
+            return false;
+        }
+        face.v[0] = i;
+        face.v[1] = j;
+        face.v[2] = k;
+        face.normal = Mul(normal, 1.f / len);
+        face.distance = Dot(face.normal, vertices[i].w);
+        return true;
+    }
+
+    // Grow the GJK simplex into a tetrahedron. Returns false when A - B is flat around the
+    // origin: touching boxes, or crossing capsule and sphere cores.
+    bool Inflate(const Support &a, const Support &b, Simplex &s)
+    {
+        static const Vector3 axes[6] = {
+            Vector3(1.f, 0.f, 0.f), Vector3(-1.f, 0.f, 0.f), Vector3(0.f, 1.f, 0.f),
+            Vector3(0.f, -1.f, 0.f), Vector3(0.f, 0.f, 1.f), Vector3(0.f, 0.f, -1.f)
+        };
+        const float eps2 = 1e-10f;
+
+        if (s.n == 1) {
+            for (unsigned int i = 0; i < 6 && s.n == 1; i++) {
+                const SimplexVertex w = SupportCore(a, b, axes[i]);
+                const Vector3 d = Sub(w.w, s.v[0].w);
+                if (Dot(d, d) > eps2) {
+                    s.v[s.n++] = w;
+                }
+            }
+        }
+        if (s.n == 2) {
+            const Vector3 d = Sub(s.v[1].w, s.v[0].w);
+            const Vector3 axis = fabsf(d.x) < fabsf(d.y) ? (fabsf(d.x) < fabsf(d.z) ? axes[0] : axes[4])
+                                                         : (fabsf(d.y) < fabsf(d.z) ? axes[2] : axes[4]);
+            const Vector3 e1 = Cross(d, axis);
+            const Vector3 e2 = Cross(d, e1);
+            const Vector3 dirs[4] = {e1, e2, Mul(e1, -1.f), Mul(e2, -1.f)};
+            for (unsigned int i = 0; i < 4 && s.n == 2; i++) {
+                const SimplexVertex w = SupportCore(a, b, dirs[i]);
+                const Vector3 c = Cross(d, Sub(w.w, s.v[0].w));
+                if (Dot(c, c) > eps2 * Dot(d, d)) {
+                    s.v[s.n++] = w;
+                }
+            }
+        }
+        if (s.n == 3) {
+            const Vector3 normal = Cross(Sub(s.v[1].w, s.v[0].w), Sub(s.v[2].w, s.v[0].w));
+            const float len = sqrtf(Dot(normal, normal));
+            for (unsigned int i = 0; i < 2 && s.n == 3 && len > 0.f; i++) {
+                const SimplexVertex w = SupportCore(a, b, Mul(normal, i ? -1.f : 1.f));
+                if (fabsf(Dot(normal, Sub(w.w, s.v[0].w))) > 1e-5f * len) {
+                    s.v[s.n++] = w;
+                }
+            }
+        }
+        return s.n == 4;
+    }
+
+    // Expanding polytope on the cores, starting from a simplex enclosing the origin. Fills
+    // depth, normal (A to B) and witness points; returns the iteration count.
+    //
+    // Margins are left to the caller: inflating both shapes by a ball inflates A - B by one,
+    // which adds the radii to the depth without changing the normal.
+    unsigned int Epa(const Support &a, const Support &b, Simplex &s, ContactResult &result)
+    {
+        SimplexVertex vertices[max_epa_vertices];
+        EpaFace faces[max_epa_faces];
+        unsigned int vertex_count = 0, face_count = 0;
+
+        result.distance = 0.f;
+        s.Witnesses(result.point_a, result.point_b);
+
+        if (!Inflate(a, b, s)) {
+            // Flat difference: zero depth, along its normal when it has one, else along the
+            // line between the shapes.
+            Vector3 normal = Sub(b.pose.translation, a.pose.translation);
+            if (s.n == 3) {
+                const Vector3 ab = Sub(s.v[1].w, s.v[0].w), ac = Sub(s.v[2].w, s.v[0].w);
+                const Vector3 face = Cross(ab, ac);
+                normal = Dot(face, normal) < 0.f ? Mul(face, -1.f) : face;
+            } else if (s.n == 2) {
+                const Vector3 d = Sub(s.v[1].w, s.v[0].w);
+                const Vector3 side = Cross(d, normal);
+                normal = Dot(side, side) > 0.f ? Cross(side, d)
+                                               : Cross(d, fabsf(d.x) < fabsf(d.y) ? Vector3(1.f, 0.f, 0.f)
+                                                                                  : Vector3(0.f, 1.f, 0.f));
+            }
+            const float len = sqrtf(Dot(normal, normal));
+            result.normal = len > 0.f ? Mul(normal, 1.f / len) : Vector3(1.f, 0.f, 0.f);
+            return 0;
+        }
+        for (unsigned int i = 0; i < 4; i++) {
+            vertices[vertex_count++] = s.v[i];
+        }
+
+        // Wind the tetrahedron faces outwards.
+        static const unsigned int tetra[4][4] = {{1, 2, 3, 0}, {0, 3, 2, 1}, {0, 1, 3, 2}, {0, 2, 1, 3}};
+        for (unsigned int f = 0; f < 4; f++) {
+            unsigned int i = tetra[f][0], j = tetra[f][1], k = tetra[f][2];
+            const Vector3 normal = Cross(Sub(vertices[j].w, vertices[i].w), Sub(vertices[k].w, vertices[i].w));
+            if (Dot(normal, Sub(vertices[tetra[f][3]].w, vertices[i].w)) > 0.f) {
+                const unsigned int t = j;
+                j = k;
+                k = t;
+            }
+            if (MakeFace(vertices, i, j, k, faces[face_count])) {
+                face_count++;
+            }
+        }
+        if (face_count < 4) {
+            result.normal.Set(1.f, 0.f, 0.f);
+            return 0;
+        }
+
+        unsigned int iterations = 0;
+        unsigned int closest = 0;
+        for (; iterations < max_epa_iterations; iterations++) {
+            closest = 0;
+            for (unsigned int f = 1; f < face_count; f++) {
+                if (faces[f].distance < faces[closest].distance) {
+                    closest = f;
+                }
+            }
+            const EpaFace face = faces[closest];
+            const SimplexVertex w = SupportCore(a, b, face.normal);
+            const float gain = Dot(w.w, face.normal) - face.distance;
+            if (gain <= epa_tolerance * (face.distance > 1.f ? face.distance : 1.f) ||
+                vertex_count == max_epa_vertices) {
+                break;
+            }
+
+            // Find the faces the new vertex sees and their boundary edges. An edge shared by
+            // two visible faces shows up in both directions and cancels out. Faces the vertex
+            // is merely coplanar with, common on box differences, stay: removing them on
+            // rounding noise would leave a horizon that is not a simple loop.
+            const float visible = epa_tolerance * .01f * (face.distance > 1.f ? face.distance : 1.f);
+            bool seen[max_epa_faces];
+            unsigned int horizon[max_epa_faces * 3][2];
+            unsigned int edge_count = 0, kept = 0;
+            for (unsigned int f = 0; f < face_count; f++) {
+                seen[f] = Dot(faces[f].normal, Sub(w.w, vertices[faces[f].v[0]].w)) > visible;
+                if (!seen[f]) {
+                    kept++;
+                    continue;
+                }
+                for (unsigned int e = 0; e < 3; e++) {
+                    const unsigned int p = faces[f].v[e], q = faces[f].v[(e + 1) % 3];
+                    bool cancelled = false;
+                    for (unsigned int h = 0; h < edge_count; h++) {
+                        if (horizon[h][0] == q && horizon[h][1] == p) {
+                            horizon[h][0] = horizon[edge_count - 1][0];
+                            horizon[h][1] = horizon[edge_count - 1][1];
+                            edge_count--;
+                            cancelled = true;
+                            break;
+                        }
+                    }
+                    if (!cancelled) {
+                        horizon[edge_count][0] = p;
+                        horizon[edge_count][1] = q;
+                        edge_count++;
+                    }
+                }
+            }
+
+            // Out of room: the polytope is still whole, finish on its closest face.
+            if (kept + edge_count > max_epa_faces) {
+                break;
+            }
+
+            unsigned int f = 0;
+            for (unsigned int g = 0; g < face_count; g++) {
+                if (!seen[g]) {
+                    faces[f++] = faces[g];
+                }
+            }
+            face_count = f;
+            const unsigned int added = vertex_count;
+            vertices[vertex_count++] = w;
+            for (unsigned int h = 0; h < edge_count; h++) {
+                if (MakeFace(vertices, horizon[h][0], horizon[h][1], added, faces[face_count])) {
+                    face_count++;
+                }
+            }
+            if (face_count == 0) {
+                // Every new face was degenerate; the last closest face is still a valid answer.
+                faces[face_count++] = face;
+                break;
+            }
+        }
+
+        closest = 0;
+        for (unsigned int f = 1; f < face_count; f++) {
+            if (faces[f].distance < faces[closest].distance) {
+                closest = f;
+            }
+        }
+        const EpaFace &face = faces[closest];
+
+        // Barycentric coordinates of the origin's projection on the closest face.
+        const SimplexVertex &v0 = vertices[face.v[0]], &v1 = vertices[face.v[1]], &v2 = vertices[face.v[2]];
+        const Vector3 p = Mul(face.normal, face.distance);
+        const Vector3 e0 = Sub(v1.w, v0.w), e1 = Sub(v2.w, v0.w), ep = Sub(p, v0.w);
+        const float d00 = Dot(e0, e0), d01 = Dot(e0, e1), d11 = Dot(e1, e1);
+        const float d20 = Dot(ep, e0), d21 = Dot(ep, e1);
+        const float denom = d00 * d11 - d01 * d01;
+        const float l1 = denom != 0.f ? (d11 * d20 - d01 * d21) / denom : 0.f;
+        const float l2 = denom != 0.f ? (d00 * d21 - d01 * d20) / denom : 0.f;
+        const float l0 = 1.f - l1 - l2;
+
+        // Pushing A by -distance * normal separates the shapes, so the normal points to B.
+        result.distance = -face.distance;
+        result.normal = face.normal;
+        result.point_a = Add(Add(Mul(v0.a, l0), Mul(v1.a, l1)), Mul(v2.a, l2));
+        result.point_b = Add(Add(Mul(v0.b, l0), Mul(v1.b, l1)), Mul(v2.b, l2));
+        return iterations;
+    }
+
+    void Store(const Simplex &simplex, GjkCache *cache)
+    {
+        if (cache) {
+            cache->count = simplex.n;
+            for (unsigned int i = 0; i < simplex.n; i++) {
+                cache->directions[i] = simplex.v[i].d;
+            }
+        }
+    }
+}
+
+ConvexShape ConvexShape::Sphere(const float radius)
+{
+    ConvexShape s = {Shape_Sphere, Vector3(0.f, 0.f, 0.f), radius, 0.f, 0, 0};
+    return s;
+}
+
+ConvexShape ConvexShape::Box(const Vector3 &half_extents)
+{
+    ConvexShape s = {Shape_Box, half_extents, 0.f, 0.f, 0, 0};
+    return s;
+}
+
+ConvexShape ConvexShape::Capsule(const float radius, const float half_height)
+{
+    ConvexShape s = {Shape_Capsule, Vector3(0.f, 0.f, 0.f), radius, half_height, 0, 0};
+    return s;
+}
+
+ConvexShape ConvexShape::Hull(const Vector3 *points, const unsigned int count)
+{
+    ConvexShape s = {Shape_Hull, Vector3(0.f, 0.f, 0.f), 0.f, 0.f, points, count};
+    return s;
+}
+
+ConvexPose ConvexPose::FromMatrix4(const Matrix4 &m)
+{
+    ConvexPose p;
+    for (unsigned int i = 0; i < 3; i++) {
+        for (unsigned int j = 0; j < 3; j++) {
+            p.linear[i * 3 + j] = m.m[i * 4 + j];
+        }
+    }
+    p.translation.Set(m.m[3], m.m[7], m.m[11]);
+    return p;
+}
+
+ConvexPose ConvexPose::FromRotation(const Quaternion &rotation, const Vector3 &translation)
+{
+    Quaternion r = rotation;
+    const Matrix3 m = r.ToMatrix3();
+    ConvexPose p;
+    for (unsigned int i = 0; i < 9; i++) {
+        p.linear[i] = m.m[i];
+    }
+    p.translation = translation;
+    return p;
+}
+
+bool Collision::Query(const ConvexShape &a, const ConvexPose &pose_a, const ConvexShape &b,
+                      const ConvexPose &pose_b, ContactResult &result, GjkCache *cache)
+{
+    const Support sa(a, pose_a), sb(b, pose_b);
+    const float margin = sa.Margin() + sb.Margin();
+
+    Simplex simplex;
+    Vector3 v;
+    if (Gjk(sa, sb, simplex, v, result.iterations, cache) == Gjk_Closest) {
+        // Separated cores: margins only shift the closest points along the axis.
+        const float len = sqrtf(Dot(v, v));
+        result.normal = Mul(v, -1.f / len);
+        simplex.Witnesses(result.point_a, result.point_b);
+        result.point_a = Add(result.point_a, Mul(result.normal, sa.Margin()));
+        result.point_b = Sub(result.point_b, Mul(result.normal, sb.Margin()));
+        result.distance = len - margin;
+        result.intersecting = result.distance < 0.f;
+        Store(simplex, cache);
+        return result.intersecting;
+    }
+
+    Store(simplex, cache);
+    result.iterations += Epa(sa, sb, simplex, result);
+    result.point_a = Add(result.point_a, Mul(result.normal, sa.Margin()));
+    result.point_b = Sub(result.point_b, Mul(result.normal, sb.Margin()));
+    result.distance -= margin;
+    result.intersecting = true;
+    return true;
+}
+
+bool Collision::Intersect(const ConvexShape &a, const ConvexPose &pose_a, const ConvexShape &b,
+                          const ConvexPose &pose_b, GjkCache *cache)
+{
+    const Support sa(a, pose_a), sb(b, pose_b);
+    const float margin = sa.Margin() + sb.Margin();
+
+    Simplex simplex;
+    Vector3 v;
+    unsigned int iterations;
+    const GjkStatus status = Gjk(sa, sb, simplex, v, iterations, cache, margin);
+    Store(simplex, cache);
+    if (status == Gjk_Overlap) {
+        return true;
+    }
+    return status == Gjk_Closest && Dot(v, v) < margin * margin;
+}
+
+void Collision::QueryPairs(const ConvexShape *shapes, const ConvexPose *poses, const CollisionPair *pairs,
+                           const unsigned int count, ContactResult *results, GjkCache *caches)
+{
+    Parallel::For(count, 256, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            const CollisionPair &p = pairs[i];
+            Query(shapes[p.a], poses[p.a], shapes[p.b], poses[p.b], results[i], caches ? caches + i : 0);
+        }
+    });
+}
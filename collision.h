@@ -0,0 +1,106 @@
+#ifndef __BCOSTA_COLLISION__
+#define __BCOSTA_COLLISION__
+
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    // Convex shape in its local frame. Spheres and capsules are a core (a point, a segment
+    // along local Y) inflated by 'radius'; queries run on the cores and add the margins
+    // afterwards, which is exact for them and much faster than sampling round surfaces.
+    struct ConvexShape
+    {
+        enum Type
+        {
+            Shape_Sphere,
+            Shape_Box,
+            Shape_Capsule,
+            Shape_Hull
+        };
+
+        Type type;
+        Vector3 half_extents;
+        float radius;
+        float half_height;
+
+        // Hull vertices, caller-owned.
+        const Vector3 *points;
+        unsigned int point_count;
+
+        static ConvexShape Sphere(const float radius);
+
+        static ConvexShape Box(const Vector3 &half_extents);
+
+        // Segment from -half_height to +half_height along Y, plus radius.
+        static ConvexShape Capsule(const float radius, const float half_height);
+
+        static ConvexShape Hull(const Vector3 *points, const unsigned int count);
+    };
+
+    // Placement of a shape: world = linear * local + translation, linear row-major. Any affine
+    // Matrix4 works for boxes and hulls; sphere and capsule radii are not scaled.
+    struct ConvexPose
+    {
+        float linear[9];
+        Vector3 translation;
+
+        static ConvexPose FromMatrix4(const Matrix4 &m);
+
+        static ConvexPose FromRotation(const Quaternion &rotation, const Vector3 &translation);
+    };
+
+    // Per-pair state kept across frames: the search directions of the last GJK simplex. The
+    // next query rebuilds the simplex from them at the new poses, so slowly moving pairs
+    // usually converge in one or two iterations.
+    struct GjkCache
+    {
+        Vector3 directions[4];
+        unsigned int count;
+
+        GjkCache()
+            : count(0)
+        { }
+    };
+
+    struct ContactResult
+    {
+        bool intersecting;
+
+        // Separation distance, negative penetration depth when intersecting.
+        float distance;
+
+        // Unit contact normal, from A towards B.
+        Vector3 normal;
+
+        // Closest points when separated, deepest points when intersecting.
+        Vector3 point_a, point_b;
+
+        unsigned int iterations;
+    };
+
+    struct CollisionPair
+    {
+        unsigned int a, b;
+    };
+
+    // GJK distance and EPA penetration queries between convex shapes.
+    namespace Collision
+    {
+        // Fill 'result' and return result.intersecting.
+        bool Query(const ConvexShape &a, const ConvexPose &pose_a, const ConvexShape &b, const ConvexPose &pose_b,
+                   ContactResult &result, GjkCache *cache = 0);
+
+        // Overlap test only: GJK stops at the first separating axis and EPA never runs.
+        bool Intersect(const ConvexShape &a, const ConvexPose &pose_a, const ConvexShape &b,
+                       const ConvexPose &pose_b, GjkCache *cache = 0);
+
+        // results[i] = Query(shapes[pairs[i].a], poses[pairs[i].a], shapes[pairs[i].b], ...),
+        // with caches[i] when 'caches' is given. Pairs run in parallel.
+        void QueryPairs(const ConvexShape *shapes, const ConvexPose *poses, const CollisionPair *pairs,
+                        const unsigned int count, ContactResult *results, GjkCache *caches = 0);
+    }
+}
+#endif // __BCOSTA_COLLISION__
@@ -0,0 +1,384 @@
+#include <math.h>
+#include "curve.h"
+#include "parallel.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+using namespace BCosta;
+
+static const unsigned int grain = 8192;
+
+namespace
+{
+    Vector3 Add(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x + b.x, a.y + b.y, a.z + b.z); }
+
+    Vector3 Sub(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+    Vector3 Mul(const Vector3 &a, const float k)
+    { return Vector3(a.x * k, a.y * k, a.z * k); }
+
+    // Segment index and local parameter for u.
+    unsigned int Locate(const float u, const unsigned int count, float &t)
+    {
+        if (!(u > 0.f)) {
+            t = 0.f;
+            return 0;
+        }
+        if (u >= (float) count) {
+            t = 1.f;
+            return count - 1;
+        }
+        const unsigned int s = (unsigned int) u;
+        t = u - (float) s;
+        return s;
+    }
+
+#ifdef __SSE__
+    // Horner on the (x, y, z, 0) rows of a segment.
+    __m128 Horner(const float *c, const float t)
+    {
+        const __m128 tt = _mm_set1_ps(t);
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c), tt), _mm_load_ps(c + 4));
+        r = _mm_add_ps(_mm_mul_ps(r, tt), _mm_load_ps(c + 8));
+        return _mm_add_ps(_mm_mul_ps(r, tt), _mm_load_ps(c + 12));
+    }
+#endif
+
+    Quaternion Scaled(const Quaternion &q, const float k)
+    { return Quaternion(q.x * k, q.y * k, q.z * k, q.w * k); }
+
+    Quaternion Sum(const Quaternion &a, const Quaternion &b)
+    { return Quaternion(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+
+    Quaternion Conjugate(const Quaternion &q)
+    { return Quaternion(-q.x, -q.y, -q.z, q.w); }
+
+    // Logarithm of a unit quaternion: the rotation vector over two, w = 0.
+    Quaternion Log(const Quaternion &q)
+    {
+        const float s = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z);
+        const float k = s > 1e-7f ? atan2f(s, q.w) / s : 1.f;
+        return Quaternion(q.x * k, q.y * k, q.z * k, 0.f);
+    }
+
+    Quaternion Exp(const Quaternion &v)
+    {
+        const float a = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+        const float k = a > 1e-7f ? sinf(a) / a : 1.f;
+        return Quaternion(v.x * k, v.y * k, v.z * k, cosf(a));
+    }
+
+    // Angle between unit quaternions and its sine reciprocal, or zeros for linear blending.
+    void SlerpAngle(const Quaternion &a, const Quaternion &b, float &angle, float &inv_sin)
+    {
+        const float d = a.Dot(b);
+        if (fabsf(d) > .9999f) {
+            angle = inv_sin = 0.f;
+            return;
+        }
+        const float s = sqrtf(1.f - d * d);
+        angle = atan2f(s, d);
+        inv_sin = 1.f / s;
+    }
+
+    Quaternion Slerp(const Quaternion &a, const Quaternion &b, const float t, const float angle,
+                     const float inv_sin)
+    {
+        if (inv_sin == 0.f) {
+            return Sum(Scaled(a, 1.f - t), Scaled(b, t));
+        }
+        return Sum(Scaled(a, sinf((1.f - t) * angle) * inv_sin), Scaled(b, sinf(t * angle) * inv_sin));
+    }
+}
+
+void Curve3::AddSegment(const Vector3 &a, const Vector3 &b, const Vector3 &c, const Vector3 &d)
+{
+    const Vector3 rows[4] = {a, b, c, d};
+    Segment s;
+    for (unsigned int i = 0; i < 4; i++) {
+        s.c[i * 4] = rows[i].x;
+        s.c[i * 4 + 1] = rows[i].y;
+        s.c[i * 4 + 2] = rows[i].z;
+        s.c[i * 4 + 3] = 0.f;
+    }
+    segments.push_back(s);
+}
+
+Curve3 Curve3::CatmullRom(const Vector3 *points, const unsigned int count, const bool closed)
+{
+    Curve3 curve;
+    if (count < 2) {
+        return curve;
+    }
+
+    const unsigned int n = closed ? count : count - 1;
+    curve.segments.reserve(n);
+    for (unsigned int i = 0; i < n; i++) {
+        const Vector3 &p0 = closed ? points[(i + count - 1) % count] : points[i ? i - 1 : 0];
+        const Vector3 &p1 = points[i];
+        const Vector3 &p2 = points[(i + 1) % count];
+        const Vector3 &p3 = closed ? points[(i + 2) % count] : points[i + 2 < count ? i + 2 : count - 1];
+
+        curve.AddSegment(
+            Mul(Add(Sub(Mul(Sub(p1, p2), 3.f), p0), p3), .5f),
+            Mul(Sub(Add(Mul(p0, 2.f), Mul(p2, 4.f)), Add(Mul(p1, 5.f), p3)), .5f),
+            Mul(Sub(p2, p0), .5f),
+            p1
+        );
+    }
+    return curve;
+}
+
+Curve3 Curve3::Bezier(const Vector3 *points, const unsigned int count)
+{
+    Curve3 curve;
+    const unsigned int n = count ? (count - 1) / 3 : 0;
+    curve.segments.reserve(n);
+    for (unsigned int i = 0; i < n; i++) {
+        const Vector3 *p = points + i * 3;
+        curve.AddSegment(
+            Add(Sub(Mul(Sub(p[1], p[2]), 3.f), p[0]), p[3]),
+            Mul(Add(Sub(p[0], Mul(p[1], 2.f)), p[2]), 3.f),
+            Mul(Sub(p[1], p[0]), 3.f),
+            p[0]
+        );
+    }
+    return curve;
+}
+
+Curve3 Curve3::Hermite(const Vector3 *points, const Vector3 *tangents, const unsigned int count)
+{
+    Curve3 curve;
+    const unsigned int n = count ? count - 1 : 0;
+    curve.segments.reserve(n);
+    for (unsigned int i = 0; i < n; i++) {
+        const Vector3 &p0 = points[i], &p1 = points[i + 1], &m0 = tangents[i], &m1 = tangents[i + 1];
+        curve.AddSegment(
+            Add(Mul(Sub(p0, p1), 2.f), Add(m0, m1)),
+            Sub(Mul(Sub(p1, p0), 3.f), Add(Mul(m0, 2.f), m1)),
+            m0,
+            p0
+        );
+    }
+    return curve;
+}
+
+Vector3 Curve3::Evaluate(const float u) const
+{
+    if (segments.empty()) {
+        return Vector3(0.f, 0.f, 0.f);
+    }
+    float t;
+    const float *c = segments[Locate(u, SegmentCount(), t)].c;
+    return Vector3(
+        ((c[0] * t + c[4]) * t + c[8]) * t + c[12],
+        ((c[1] * t + c[5]) * t + c[9]) * t + c[13],
+        ((c[2] * t + c[6]) * t + c[10]) * t + c[14]
+    );
+}
+
+Vector3 Curve3::Derivative(const float u) const
+{
+    if (segments.empty()) {
+        return Vector3(0.f, 0.f, 0.f);
+    }
+    float t;
+    const float *c = segments[Locate(u, SegmentCount(), t)].c;
+    return Vector3(
+        (3.f * c[0] * t + 2.f * c[4]) * t + c[8],
+        (3.f * c[1] * t + 2.f * c[5]) * t + c[9],
+        (3.f * c[2] * t + 2.f * c[6]) * t + c[10]
+    );
+}
+
+void Curve3::Evaluate(const float *u, const unsigned int count, Vector3 *out) const
+{
+    const unsigned int n = SegmentCount();
+    const Segment *segment = segments.data();
+    if (!n) {
+        for (unsigned int i = 0; i < count; i++) {
+            out[i] = Vector3(0.f, 0.f, 0.f);
+        }
+        return;
+    }
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int i = begin;
+#ifdef __SSE__
+        static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be three packed floats");
+
+        // The four-float store spills into the next element's x, which the next iteration
+        // rewrites, so the range's last element is done separately.
+        for (; i + 1 < end; i++) {
+            float t;
+            const float *c = segment[Locate(u[i], n, t)].c;
+            _mm_storeu_ps(&out[i].x, Horner(c, t));
+        }
+#endif
+        for (; i < end; i++) {
+            out[i] = Evaluate(u[i]);
+        }
+    });
+}
+
+void Curve3::Evaluate(const Curve3 *curves, const float *u, const unsigned int count, Vector3 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int i = begin;
+#ifdef __SSE__
+        // As above, one segment lookup per curve.
+        for (; i + 1 < end; i++) {
+            const Curve3 &curve = curves[i];
+            if (curve.segments.empty()) {
+                out[i] = Vector3(0.f, 0.f, 0.f);
+                continue;
+            }
+            float t;
+            const float *c = curve.segments[Locate(u[i], curve.SegmentCount(), t)].c;
+            _mm_storeu_ps(&out[i].x, Horner(c, t));
+        }
+#endif
+        for (; i < end; i++) {
+            out[i] = curves[i].Evaluate(u[i]);
+        }
+    });
+}
+
+void Curve3::BuildArcLength(const unsigned int samples_per_segment)
+{
+    // Three-point Gauss-Legendre nodes and weights on [0, 1].
+    static const float nodes[3] = {.1127016654f, .5f, .8872983346f};
+    static const float weights[3] = {.2777777778f, .4444444444f, .2777777778f};
+
+    samples = samples_per_segment ? samples_per_segment : 1;
+    const unsigned int total = SegmentCount() * samples;
+    lengths.resize(total + 1);
+    lengths[0] = 0.f;
+
+    const float step = 1.f / samples;
+    Parallel::For(total, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; k++) {
+            float l = 0.f;
+            for (unsigned int g = 0; g < 3; g++) {
+                const Vector3 d = Derivative((k + nodes[g]) * step);
+                l += weights[g] * sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+            }
+            lengths[k + 1] = l * step;
+        }
+    });
+    for (unsigned int k = 1; k <= total; k++) {
+        lengths[k] += lengths[k - 1];
+    }
+
+    // Sample interval at the start of each of 'total' equal distance steps, so lookups start
+    // next to their interval instead of searching the table.
+    buckets.resize(total);
+    const float length = lengths[total];
+    unsigned int k = 0;
+    for (unsigned int j = 0; j < total; j++) {
+        const float d = length * j / total;
+        while (k + 1 < total && lengths[k + 1] <= d) {
+            k++;
+        }
+        buckets[j] = k;
+    }
+}
+
+float Curve3::ParameterAt(const float distance) const
+{
+    if (buckets.empty() || !(distance > 0.f)) {
+        return 0.f;
+    }
+    const unsigned int total = (unsigned int) buckets.size();
+    if (distance >= lengths[total]) {
+        return (float) SegmentCount();
+    }
+
+    // Interval holding the distance, then linear within it.
+    const unsigned int j = (unsigned int) (distance / lengths[total] * total);
+    unsigned int k = buckets[j < total ? j : total - 1];
+    while (k + 1 < total && lengths[k + 1] <= distance) {
+        k++;
+    }
+    const float span = lengths[k + 1] - lengths[k];
+    const float f = span > 0.f ? (distance - lengths[k]) / span : 0.f;
+    return (k + f) / samples;
+}
+
+void Curve3::EvaluateAtDistances(const float *distances, const unsigned int count, Vector3 *out) const
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            out[i] = Evaluate(ParameterAt(distances[i]));
+        }
+    });
+}
+
+RotationCurve RotationCurve::Squad(const Quaternion *keys, const unsigned int count)
+{
+    RotationCurve curve;
+    if (count < 2) {
+        return curve;
+    }
+
+    // Keys on one hemisphere relative to their predecessors, so each segment takes the
+    // short way round.
+    std::vector<Quaternion> q(keys, keys + count);
+    for (unsigned int i = 1; i < count; i++) {
+        if (q[i].Dot(q[i - 1]) < 0.f) {
+            q[i] = Scaled(q[i], -1.f);
+        }
+    }
+
+    // s_i = q_i exp(-(log(q_i^-1 q_i+1) + log(q_i^-1 q_i-1)) / 4), end keys as their own.
+    std::vector<Quaternion> s(count);
+    for (unsigned int i = 0; i < count; i++) {
+        if (i == 0 || i == count - 1) {
+            s[i] = q[i];
+            continue;
+        }
+        const Quaternion inverse = Conjugate(q[i]);
+        const Quaternion sum = Sum(Log(inverse * q[i + 1]), Log(inverse * q[i - 1]));
+        s[i] = q[i] * Exp(Scaled(sum, -.25f));
+    }
+
+    curve.segments.resize(count - 1);
+    for (unsigned int i = 0; i + 1 < count; i++) {
+        Segment &g = curve.segments[i];
+        g.q0 = q[i];
+        g.q1 = q[i + 1];
+        g.s0 = s[i];
+        g.s1 = s[i + 1];
+        SlerpAngle(g.q0, g.q1, g.angle_q, g.inv_sin_q);
+        SlerpAngle(g.s0, g.s1, g.angle_s, g.inv_sin_s);
+    }
+    return curve;
+}
+
+Quaternion RotationCurve::Evaluate(const float u) const
+{
+    if (segments.empty()) {
+        return Quaternion();
+    }
+    float t;
+    const Segment &g = segments[Locate(u, SegmentCount(), t)];
+
+    const Quaternion a = Slerp(g.q0, g.q1, t, g.angle_q, g.inv_sin_q);
+    const Quaternion b = Slerp(g.s0, g.s1, t, g.angle_s, g.inv_sin_s);
+    float angle, inv_sin;
+    SlerpAngle(a, b, angle, inv_sin);
+    return Slerp(a, b, 2.f * t * (1.f - t), angle, inv_sin);
+}
+
+void RotationCurve::Evaluate(const float *u, const unsigned int count, Quaternion *out) const
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            out[i] = Evaluate(u[i]);
+        }
+    });
+}
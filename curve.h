@@ -0,0 +1,120 @@
+#ifndef __BCOSTA_CURVE__
+#define __BCOSTA_CURVE__
+
+#include <vector>
+#include "aligned.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Piecewise cubic Vector3 curve. Every segment is converted once to power-basis
+    // coefficients, p(t) = ((a * t + b) * t + c) * t + d, so evaluation is a segment lookup
+    // and three multiply-adds per component, done on all three components at once on SSE.
+    //
+    // The parameter u runs over [0, SegmentCount()]: segment floor(u) at t = u - floor(u).
+    // Values outside are clamped. A curve without segments (default constructed, or built
+    // from too few points) evaluates to the zero vector, with a zero derivative.
+    class Curve3
+    {
+    public:
+
+        Curve3()
+            : samples(0)
+        { }
+
+        // Uniform Catmull-Rom spline through the points. Open curves repeat their end
+        // points as outer neighbours and have count - 1 segments; closed ones wrap around
+        // and have count.
+        static Curve3 CatmullRom(const Vector3 *points, const unsigned int count, const bool closed = false);
+
+        // Chain of cubic Bezier segments sharing end points: 3 * n + 1 control points.
+        static Curve3 Bezier(const Vector3 *points, const unsigned int count);
+
+        // Cubic Hermite segments between consecutive points with the given tangents.
+        static Curve3 Hermite(const Vector3 *points, const Vector3 *tangents, const unsigned int count);
+
+        unsigned int SegmentCount() const
+        { return (unsigned int) segments.size(); }
+
+        Vector3 Evaluate(const float u) const;
+
+        // dp/du.
+        Vector3 Derivative(const float u) const;
+
+        // out[i] = Evaluate(u[i]), split across threads.
+        void Evaluate(const float *u, const unsigned int count, Vector3 *out) const;
+
+        // out[i] = curves[i].Evaluate(u[i]): one point on each of many curves, with the same
+        // SSE evaluation as the single-curve batch.
+        static void Evaluate(const Curve3 *curves, const float *u, const unsigned int count, Vector3 *out);
+
+        // Cumulative arc length table at 'samples_per_segment' parameter steps per segment,
+        // integrated by Gauss-Legendre quadrature. Needed by the distance functions below and
+        // rebuilt by any call; control point edits need a rebuild.
+        void BuildArcLength(const unsigned int samples_per_segment = 16);
+
+        float Length() const
+        { return lengths.empty() ? 0.f : lengths.back(); }
+
+        // Parameter u at arc length 'distance' from the start, clamped to the curve.
+        float ParameterAt(const float distance) const;
+
+        // out[i] = point at arc length distances[i]: constant-speed sampling.
+        void EvaluateAtDistances(const float *distances, const unsigned int count, Vector3 *out) const;
+
+    private:
+
+        // a, b, c, d as four (x, y, z, 0) rows.
+        struct Segment
+        {
+            alignas(16) float c[16];
+        };
+
+        std::vector<Segment, AlignedAllocator<Segment>> segments;
+
+        // lengths[k]: arc length up to u = k / samples.
+        std::vector<float> lengths;
+        unsigned int samples;
+
+        // buckets[j]: sample interval holding distance j / buckets.size() of the length.
+        std::vector<unsigned int> buckets;
+
+        void AddSegment(const Vector3 &a, const Vector3 &b, const Vector3 &c, const Vector3 &d);
+    };
+
+    // Spherical quadrangle (squad) interpolation through rotation keys: C1-continuous
+    // angular velocity, unlike piecewise slerp. Keys are sign-aligned with their
+    // predecessors and the inner control rotations and slerp angles are computed once per
+    // segment. The parameter runs over [0, count - 1] as for Curve3; a curve from fewer than
+    // two keys evaluates to the identity.
+    class RotationCurve
+    {
+    public:
+
+        // Unit keys.
+        static RotationCurve Squad(const Quaternion *keys, const unsigned int count);
+
+        unsigned int SegmentCount() const
+        { return (unsigned int) segments.size(); }
+
+        Quaternion Evaluate(const float u) const;
+
+        // out[i] = Evaluate(u[i]), split across threads; each element is evaluated scalar.
+        void Evaluate(const float *u, const unsigned int count, Quaternion *out) const;
+
+    private:
+
+        struct Segment
+        {
+            // Keys and inner control rotations.
+            Quaternion q0, q1, s0, s1;
+            // Angles between q0, q1 and between s0, s1 and their sine reciprocals, 0 when the
+            // pair is too close for slerp and is interpolated linearly.
+            float angle_q, inv_sin_q, angle_s, inv_sin_s;
+        };
+
+        std::vector<Segment> segments;
+    };
+}
+#endif // __BCOSTA_CURVE__
@@ -0,0 +1,252 @@
+#include <math.h>
+#include "decompose.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include "quaternion.h"
+#include "vector.h"
+
+using namespace BCosta;
+
+// Jacobi sweeps on A^T A. Rotations are exact, so convergence is quadratic and 4 sweeps
+// reach float precision for any input.
+static const unsigned int sweeps = 4;
+
+// Matrices per batch kernel call.
+static const unsigned int lanes = 8;
+
+namespace
+{
+    // Lane-parallel SVD: a, u and v are 3x3 row-major matrices (a[i * 3 + j][lane]).
+    // No data-dependent branches: the selects compile to blends.
+    template<unsigned int W>
+    void SvdLanes(const float a[9][W], float u[9][W], float sigma[3][W], float v[9][W])
+    {
+        static const unsigned int pairs[3][3] = {{0, 1, 2}, {0, 2, 1}, {1, 2, 0}};
+        float s[9][W];
+
+        for (unsigned int l = 0; l < W; l++) {
+            for (unsigned int i = 0; i < 3; i++) {
+                for (unsigned int j = 0; j < 3; j++) {
+                    s[i * 3 + j][l] = a[i][l] * a[j][l] + a[3 + i][l] * a[3 + j][l] + a[6 + i][l] * a[6 + j][l];
+                    v[i * 3 + j][l] = i == j ? 1.f : 0.f;
+                }
+            }
+        }
+
+        for (unsigned int sweep = 0; sweep < sweeps; sweep++) {
+            for (unsigned int k = 0; k < 3; k++) {
+                const unsigned int p = pairs[k][0], q = pairs[k][1], r = pairs[k][2];
+                for (unsigned int l = 0; l < W; l++) {
+                    const float app = s[p * 3 + p][l], aqq = s[q * 3 + q][l], apq = s[p * 3 + q][l];
+                    const float arp = s[r * 3 + p][l], arq = s[r * 3 + q][l];
+
+                    // tan of the rotation angle zeroing apq, smallest root; 0 when apq = 0.
+                    const float d = aqq - app;
+                    const float t = copysignf(1.f, d) * 2.f * apq / (fabsf(d) + sqrtf(d * d + 4.f * apq * apq) + 1e-30f);
+                    const float c = 1.f / sqrtf(1.f + t * t);
+                    const float sn = t * c;
+
+                    s[p * 3 + p][l] = app - t * apq;
+                    s[q * 3 + q][l] = aqq + t * apq;
+                    s[p * 3 + q][l] = s[q * 3 + p][l] = 0.f;
+                    s[r * 3 + p][l] = s[p * 3 + r][l] = c * arp - sn * arq;
+                    s[r * 3 + q][l] = s[q * 3 + r][l] = sn * arp + c * arq;
+
+                    for (unsigned int i = 0; i < 3; i++) {
+                        const float vp = v[i * 3 + p][l], vq = v[i * 3 + q][l];
+                        v[i * 3 + p][l] = c * vp - sn * vq;
+                        v[i * 3 + q][l] = sn * vp + c * vq;
+                    }
+                }
+            }
+        }
+
+        for (unsigned int l = 0; l < W; l++) {
+            // Sort eigenvalues of A^T A in decreasing order. Swapping two columns flips
+            // det(V), so one of them is negated to keep V a rotation.
+            float e[3] = {s[0][l], s[4][l], s[8][l]};
+            for (unsigned int k = 0; k < 3; k++) {
+                const unsigned int p = pairs[k][0], q = pairs[k][1];
+                const bool swap = e[q] > e[p];
+                const float ep = e[p], eq = e[q];
+                e[p] = swap ? eq : ep;
+                e[q] = swap ? ep : eq;
+                for (unsigned int i = 0; i < 3; i++) {
+                    const float vp = v[i * 3 + p][l], vq = v[i * 3 + q][l];
+                    v[i * 3 + p][l] = swap ? vq : vp;
+                    v[i * 3 + q][l] = swap ? -vp : vq;
+                }
+            }
+
+            // B = A V, whose columns are the singular values times the columns of U.
+            float b[3][3];
+            for (unsigned int j = 0; j < 3; j++) {
+                for (unsigned int i = 0; i < 3; i++) {
+                    b[j][i] = a[i * 3][l] * v[j][l] + a[i * 3 + 1][l] * v[3 + j][l] + a[i * 3 + 2][l] * v[6 + j][l];
+                }
+            }
+
+            // Gram-Schmidt with fallbacks for rank-deficient inputs, third axis by cross
+            // product so U is proper and the sign of det(A) lands on the last singular value.
+            const float n0 = sqrtf(b[0][0] * b[0][0] + b[0][1] * b[0][1] + b[0][2] * b[0][2]);
+            const bool null0 = n0 < 1e-30f;
+            const float k0 = null0 ? 0.f : 1.f / n0;
+            const float u0[3] = {null0 ? 1.f : b[0][0] * k0, b[0][1] * k0, b[0][2] * k0};
+
+            const float d01 = u0[0] * b[1][0] + u0[1] * b[1][1] + u0[2] * b[1][2];
+            float w1[3] = {b[1][0] - u0[0] * d01, b[1][1] - u0[1] * d01, b[1][2] - u0[2] * d01};
+            float n1 = sqrtf(w1[0] * w1[0] + w1[1] * w1[1] + w1[2] * w1[2]);
+            const bool null1 = n1 <= 1e-6f * n0 || n1 < 1e-30f;
+            // Any unit vector orthogonal to u0.
+            const bool use_x = fabsf(u0[0]) < .9f;
+            const float f[3] = {use_x ? 1.f - u0[0] * u0[0] : -u0[1] * u0[0],
+                                use_x ? -u0[0] * u0[1] : 1.f - u0[1] * u0[1],
+                                use_x ? -u0[0] * u0[2] : -u0[1] * u0[2]};
+            for (unsigned int i = 0; i < 3; i++) {
+                w1[i] = null1 ? f[i] : w1[i];
+            }
+            n1 = sqrtf(w1[0] * w1[0] + w1[1] * w1[1] + w1[2] * w1[2]);
+            const float u1[3] = {w1[0] / n1, w1[1] / n1, w1[2] / n1};
+            const float u2[3] = {u0[1] * u1[2] - u0[2] * u1[1], u0[2] * u1[0] - u0[0] * u1[2], u0[0] * u1[1] - u0[1] * u1[0]};
+
+            sigma[0][l] = n0;
+            sigma[1][l] = u1[0] * b[1][0] + u1[1] * b[1][1] + u1[2] * b[1][2];
+            sigma[2][l] = u2[0] * b[2][0] + u2[1] * b[2][1] + u2[2] * b[2][2];
+
+            for (unsigned int i = 0; i < 3; i++) {
+                u[i * 3][l] = u0[i];
+                u[i * 3 + 1][l] = u1[i];
+                u[i * 3 + 2][l] = u2[i];
+            }
+        }
+    }
+
+    // R = U V^T and S = V diag(sigma) V^T per lane.
+    template<unsigned int W>
+    void PolarLanes(const float a[9][W], float r[9][W], float s[9][W])
+    {
+        float u[9][W], sigma[3][W], v[9][W];
+        SvdLanes<W>(a, u, sigma, v);
+
+        for (unsigned int l = 0; l < W; l++) {
+            for (unsigned int i = 0; i < 3; i++) {
+                for (unsigned int j = 0; j < 3; j++) {
+                    r[i * 3 + j][l] = u[i * 3][l] * v[j * 3][l] + u[i * 3 + 1][l] * v[j * 3 + 1][l] +
+                                      u[i * 3 + 2][l] * v[j * 3 + 2][l];
+                    s[i * 3 + j][l] = v[i * 3][l] * sigma[0][l] * v[j * 3][l] +
+                                      v[i * 3 + 1][l] * sigma[1][l] * v[j * 3 + 1][l] +
+                                      v[i * 3 + 2][l] * sigma[2][l] * v[j * 3 + 2][l];
+                }
+            }
+        }
+    }
+
+    template<unsigned int W>
+    void TrsLanes(const Matrix4 *m, Vector3 *translations, Quaternion *rotations, Vector3 *scales)
+    {
+        float a[9][W], r[9][W], s[9][W], flip[3][W];
+        for (unsigned int l = 0; l < W; l++) {
+            for (unsigned int i = 0; i < 3; i++) {
+                for (unsigned int j = 0; j < 3; j++) {
+                    a[i * 3 + j][l] = m[l].m[i * 4 + j];
+                }
+            }
+
+            // A mirrored transform would leave the reflection in the stretch, which is no
+            // longer diagonal when two scales have the same magnitude. Negate the shortest
+            // axis up front instead and give its sign back to the scale afterwards.
+            const float det = a[0][l] * (a[4][l] * a[8][l] - a[5][l] * a[7][l]) -
+                              a[1][l] * (a[3][l] * a[8][l] - a[5][l] * a[6][l]) +
+                              a[2][l] * (a[3][l] * a[7][l] - a[4][l] * a[6][l]);
+            float len[3];
+            for (unsigned int j = 0; j < 3; j++) {
+                len[j] = a[j][l] * a[j][l] + a[3 + j][l] * a[3 + j][l] + a[6 + j][l] * a[6 + j][l];
+            }
+            const unsigned int k = len[0] < len[1] ? (len[0] < len[2] ? 0 : 2) : (len[1] < len[2] ? 1 : 2);
+            for (unsigned int j = 0; j < 3; j++) {
+                flip[j][l] = det < 0.f && j == k ? -1.f : 1.f;
+                a[j][l] *= flip[j][l];
+                a[3 + j][l] *= flip[j][l];
+                a[6 + j][l] *= flip[j][l];
+            }
+        }
+
+        PolarLanes<W>(a, r, s);
+
+        for (unsigned int l = 0; l < W; l++) {
+            translations[l].Set(m[l].m[3], m[l].m[7], m[l].m[11]);
+            scales[l].Set(s[0][l] * flip[0][l], s[4][l] * flip[1][l], s[8][l] * flip[2][l]);
+            rotations[l] = Decompose::RotationToQuaternion(Matrix3(
+                r[0][l], r[1][l], r[2][l],
+                r[3][l], r[4][l], r[5][l],
+                r[6][l], r[7][l], r[8][l]
+            ));
+        }
+    }
+}
+
+void Decompose::Svd(const Matrix3 &a, Matrix3 &u, Vector3 &sigma, Matrix3 &v)
+{
+    float la[9][1], lu[9][1], ls[3][1], lv[9][1];
+    for (unsigned int i = 0; i < 9; i++) {
+        la[i][0] = a.m[i];
+    }
+    SvdLanes<1>(la, lu, ls, lv);
+    for (unsigned int i = 0; i < 9; i++) {
+        u.m[i] = lu[i][0];
+        v.m[i] = lv[i][0];
+    }
+    sigma.Set(ls[0][0], ls[1][0], ls[2][0]);
+}
+
+void Decompose::Polar(const Matrix3 &a, Matrix3 &r, Matrix3 &s)
+{
+    float la[9][1], lr[9][1], ls[9][1];
+    for (unsigned int i = 0; i < 9; i++) {
+        la[i][0] = a.m[i];
+    }
+    PolarLanes<1>(la, lr, ls);
+    for (unsigned int i = 0; i < 9; i++) {
+        r.m[i] = lr[i][0];
+        s.m[i] = ls[i][0];
+    }
+}
+
+void Decompose::Trs(const Matrix4 *m, const unsigned int count, Vector3 *translations, Quaternion *rotations,
+                    Vector3 *scales)
+{
+    const unsigned int blocks = count / lanes;
+
+    Parallel::For(blocks, 512, [&](unsigned int first, unsigned int end) {
+        for (unsigned int b = first; b < end; b++) {
+            const unsigned int i = b * lanes;
+            TrsLanes<lanes>(m + i, translations + i, rotations + i, scales + i);
+        }
+    });
+    for (unsigned int i = blocks * lanes; i < count; i++) {
+        TrsLanes<1>(m + i, translations + i, rotations + i, scales + i);
+    }
+}
+
+Quaternion Decompose::RotationToQuaternion(const Matrix3 &r)
+{
+    const float *m = r.m;
+    const float trace = m[0] + m[4] + m[8];
+
+    // Shepperd: divide by the largest of the four squared components.
+    if (trace > 0.f) {
+        const float k = .5f / sqrtf(1.f + trace);
+        return Quaternion((m[7] - m[5]) * k, (m[2] - m[6]) * k, (m[3] - m[1]) * k, .25f / k);
+    }
+    if (m[0] > m[4] && m[0] > m[8]) {
+        const float k = .5f / sqrtf(1.f + m[0] - m[4] - m[8]);
+        return Quaternion(.25f / k, (m[1] + m[3]) * k, (m[2] + m[6]) * k, (m[7] - m[5]) * k);
+    }
+    if (m[4] > m[8]) {
+        const float k = .5f / sqrtf(1.f + m[4] - m[0] - m[8]);
+        return Quaternion((m[1] + m[3]) * k, .25f / k, (m[5] + m[7]) * k, (m[2] - m[6]) * k);
+    }
+    const float k = .5f / sqrtf(1.f + m[8] - m[0] - m[4]);
+    return Quaternion((m[2] + m[6]) * k, (m[5] + m[7]) * k, .25f / k, (m[3] - m[1]) * k);
+}
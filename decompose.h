@@ -0,0 +1,37 @@
+#ifndef __BCOSTA_DECOMPOSE__
+#define __BCOSTA_DECOMPOSE__
+
+namespace BCosta
+{
+    class Matrix3;
+    class Matrix4;
+    class Quaternion;
+    class Vector3;
+
+    // Matrix factorizations for recovering rotation and scale from arbitrary transforms.
+    //
+    // All of them run the same kernel: a fixed number of cyclic Jacobi sweeps on A^T A with
+    // branch-free rotations, then a Gram-Schmidt pass for U. Batched forms run the kernel
+    // on 8 matrices at once, laid out so that every step is a straight loop over lanes.
+    namespace Decompose
+    {
+        // A = U * diag(sigma) * V^T, with U and V proper rotations, sigma sorted by
+        // decreasing magnitude. When det(A) < 0 the last singular value is negative.
+        void Svd(const Matrix3 &a, Matrix3 &u, Vector3 &sigma, Matrix3 &v);
+
+        // A = R * S with R a proper rotation and S symmetric. When det(A) < 0 the
+        // reflection ends up in S.
+        void Polar(const Matrix3 &a, Matrix3 &r, Matrix3 &s);
+
+        // Split affine transforms into translation, rotation and per-axis scale so that
+        // Matrix4::Compose(t, r, s) gives the transform back when it has no shear. With
+        // shear, the rotation is the polar one and 'scale' the diagonal of the stretch.
+        // Mirrored transforms get a negative scale on their shortest axis.
+        void Trs(const Matrix4 *m, const unsigned int count, Vector3 *translations, Quaternion *rotations,
+                 Vector3 *scales);
+
+        // Quaternion of a proper rotation matrix, following the ToMatrix3 convention.
+        Quaternion RotationToQuaternion(const Matrix3 &r);
+    }
+}
+#endif // __BCOSTA_DECOMPOSE__
@@ -0,0 +1,219 @@
+#include <string.h>
+#include "gpu_pack.h"
+#include "half.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include "vector.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace BCosta;
+
+static const unsigned int grain = 8192;
+
+// Elements per half-float staging block. Blocks start on 16-byte boundaries of the
+// destination for every layout (64 * 8 bytes at least).
+static const unsigned int half_block = 64;
+
+namespace
+{
+    bool Aligned16(const void *p)
+    { return ((size_t) p & 15) == 0; }
+
+    // Copy whole 16-byte lines with non-temporal stores when both ends allow it.
+    void StreamBytes(unsigned char *dst, const unsigned char *src, size_t bytes)
+    {
+#ifdef __SSE2__
+        if (Aligned16(dst) && Aligned16(src)) {
+            for (; bytes >= 16; bytes -= 16, dst += 16, src += 16) {
+                _mm_stream_si128((__m128i *) dst, _mm_load_si128((const __m128i *) src));
+            }
+        }
+#endif
+        memcpy(dst, src, bytes);
+    }
+
+    // Make streamed lines visible before the caller hands the buffer over.
+    void Fence()
+    {
+#ifdef __SSE2__
+        _mm_sfence();
+#endif
+    }
+
+    void ColumnMajor(const float *m, float *out)
+    {
+        out[0] = m[0];
+        out[1] = m[4];
+        out[2] = m[8];
+        out[3] = m[12];
+        out[4] = m[1];
+        out[5] = m[5];
+        out[6] = m[9];
+        out[7] = m[13];
+        out[8] = m[2];
+        out[9] = m[6];
+        out[10] = m[10];
+        out[11] = m[14];
+        out[12] = m[3];
+        out[13] = m[7];
+        out[14] = m[11];
+        out[15] = m[15];
+    }
+
+    void Matrix3Std140(const float *m, float *out)
+    {
+        for (unsigned int j = 0; j < 3; j++) {
+            out[j * 4] = m[j];
+            out[j * 4 + 1] = m[3 + j];
+            out[j * 4 + 2] = m[6 + j];
+            out[j * 4 + 3] = 0.f;
+        }
+    }
+
+    // Run fill(i, floats) for every element over per-block staging, convert the block to
+    // half floats and stream it out.
+    template<unsigned int Floats, typename F>
+    void WriteHalf(const unsigned int count, void *dst, const F &fill)
+    {
+        const unsigned int blocks = (count + half_block - 1) / half_block;
+
+        Parallel::For(blocks, grain / half_block, [&](unsigned int first, unsigned int end) {
+            alignas(16) float floats[half_block * Floats];
+            alignas(16) unsigned short halves[half_block * Floats];
+
+            for (unsigned int b = first; b < end; b++) {
+                const unsigned int begin = b * half_block;
+                const unsigned int n = count - begin < half_block ? count - begin : half_block;
+                for (unsigned int i = 0; i < n; i++) {
+                    fill(begin + i, floats + i * Floats);
+                }
+                Half::FromFloats(floats, n * Floats, halves);
+                StreamBytes((unsigned char *) dst + (size_t) begin * Floats * 2, (const unsigned char *) halves,
+                            (size_t) n * Floats * 2);
+            }
+            Fence();
+        });
+    }
+}
+
+void GpuPack::WriteColumnMajor(const Matrix4 *m, const unsigned int count, void *dst)
+{
+    float *out = (float *) dst;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+#ifdef __SSE2__
+        if (Aligned16(out)) {
+            for (unsigned int i = begin; i < end; i++) {
+                __m128 r0 = _mm_loadu_ps(m[i].m), r1 = _mm_loadu_ps(m[i].m + 4);
+                __m128 r2 = _mm_loadu_ps(m[i].m + 8), r3 = _mm_loadu_ps(m[i].m + 12);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_stream_ps(out + i * 16, r0);
+                _mm_stream_ps(out + i * 16 + 4, r1);
+                _mm_stream_ps(out + i * 16 + 8, r2);
+                _mm_stream_ps(out + i * 16 + 12, r3);
+            }
+            _mm_sfence();
+            return;
+        }
+#endif
+        for (unsigned int i = begin; i < end; i++) {
+            ColumnMajor(m[i].m, out + i * 16);
+        }
+    });
+}
+
+void GpuPack::WriteAffine3x4(const Matrix4 *m, const unsigned int count, void *dst)
+{
+    float *out = (float *) dst;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+#ifdef __SSE2__
+        if (Aligned16(out)) {
+            for (unsigned int i = begin; i < end; i++) {
+                _mm_stream_ps(out + i * 12, _mm_loadu_ps(m[i].m));
+                _mm_stream_ps(out + i * 12 + 4, _mm_loadu_ps(m[i].m + 4));
+                _mm_stream_ps(out + i * 12 + 8, _mm_loadu_ps(m[i].m + 8));
+            }
+            _mm_sfence();
+            return;
+        }
+#endif
+        for (unsigned int i = begin; i < end; i++) {
+            memcpy(out + i * 12, m[i].m, 12 * sizeof(float));
+        }
+    });
+}
+
+void GpuPack::WriteMatrix3Std140(const Matrix3 *m, const unsigned int count, void *dst)
+{
+    float *out = (float *) dst;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+#ifdef __SSE2__
+        if (Aligned16(out)) {
+            for (unsigned int i = begin; i < end; i++) {
+                const float *a = m[i].m;
+                _mm_stream_ps(out + i * 12, _mm_set_ps(0.f, a[6], a[3], a[0]));
+                _mm_stream_ps(out + i * 12 + 4, _mm_set_ps(0.f, a[7], a[4], a[1]));
+                _mm_stream_ps(out + i * 12 + 8, _mm_set_ps(0.f, a[8], a[5], a[2]));
+            }
+            _mm_sfence();
+            return;
+        }
+#endif
+        for (unsigned int i = begin; i < end; i++) {
+            Matrix3Std140(m[i].m, out + i * 12);
+        }
+    });
+}
+
+void GpuPack::WriteVector3Std140(const Vector3 *v, const unsigned int count, void *dst, const float w)
+{
+    float *out = (float *) dst;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+#ifdef __SSE2__
+        if (Aligned16(out)) {
+            for (unsigned int i = begin; i < end; i++) {
+                _mm_stream_ps(out + i * 4, _mm_set_ps(w, v[i].z, v[i].y, v[i].x));
+            }
+            _mm_sfence();
+            return;
+        }
+#endif
+        for (unsigned int i = begin; i < end; i++) {
+            out[i * 4] = v[i].x;
+            out[i * 4 + 1] = v[i].y;
+            out[i * 4 + 2] = v[i].z;
+            out[i * 4 + 3] = w;
+        }
+    });
+}
+
+void GpuPack::WriteColumnMajorHalf(const Matrix4 *m, const unsigned int count, void *dst)
+{
+    WriteHalf<16>(count, dst, [&](unsigned int i, float *out) {
+        ColumnMajor(m[i].m, out);
+    });
+}
+
+void GpuPack::WriteAffine3x4Half(const Matrix4 *m, const unsigned int count, void *dst)
+{
+    WriteHalf<12>(count, dst, [&](unsigned int i, float *out) {
+        memcpy(out, m[i].m, 12 * sizeof(float));
+    });
+}
+
+void GpuPack::WriteVector3Half(const Vector3 *v, const unsigned int count, void *dst, const float w)
+{
+    WriteHalf<4>(count, dst, [&](unsigned int i, float *out) {
+        out[0] = v[i].x;
+        out[1] = v[i].y;
+        out[2] = v[i].z;
+        out[3] = w;
+    });
+}
@@ -0,0 +1,51 @@
+#ifndef __BCOSTA_GPU_PACK__
+#define __BCOSTA_GPU_PACK__
+
+#include <stddef.h>
+
+namespace BCosta
+{
+    class Matrix3;
+    class Matrix4;
+    class Vector3;
+
+    // Writers converting math arrays straight into GPU buffer layouts, typically a mapped
+    // upload buffer. Destinations aligned on 16 bytes are filled with non-temporal stores,
+    // which go to memory without reading the lines first or evicting the caller's working
+    // set; others fall back to plain stores. Large arrays are split across threads.
+    //
+    // For the types below std140 and std430 agree: a mat4 is 4 vec4 columns, a mat3 3 vec4
+    // columns, and vec3 array elements take 16 bytes.
+    namespace GpuPack
+    {
+        // Bytes written per element by each writer.
+        const size_t column_major_size = 64;
+        const size_t affine_3x4_size = 48;
+        const size_t matrix3_std140_size = 48;
+        const size_t vector3_std140_size = 16;
+        const size_t column_major_half_size = 32;
+        const size_t affine_3x4_half_size = 24;
+        const size_t vector3_half_size = 8;
+
+        // mat4, column-major (what Matrix4::Transpose gives).
+        void WriteColumnMajor(const Matrix4 *m, const unsigned int count, void *dst);
+
+        // Top three rows of an affine transform, row-major: a float3x4 in HLSL, a mat3x4
+        // used as 'v * m' in GLSL. Translation is the last element of each row.
+        void WriteAffine3x4(const Matrix4 *m, const unsigned int count, void *dst);
+
+        // mat3, column-major with each column padded to a vec4.
+        void WriteMatrix3Std140(const Matrix3 *m, const unsigned int count, void *dst);
+
+        // vec4 per element with 'w' in the fourth component.
+        void WriteVector3Std140(const Vector3 *v, const unsigned int count, void *dst, const float w = 0.f);
+
+        // Half-float forms of the above, for shaders reading f16 data.
+        void WriteColumnMajorHalf(const Matrix4 *m, const unsigned int count, void *dst);
+
+        void WriteAffine3x4Half(const Matrix4 *m, const unsigned int count, void *dst);
+
+        void WriteVector3Half(const Vector3 *v, const unsigned int count, void *dst, const float w = 0.f);
+    }
+}
+#endif // __BCOSTA_GPU_PACK__
@@ -0,0 +1,92 @@
+#include <string.h>
+#include "half.h"
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+using namespace BCosta;
+
+namespace
+{
+    unsigned int Bits(const float f)
+    {
+        unsigned int u;
+        memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+
+    float Float(const unsigned int u)
+    {
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+}
+
+unsigned short Half::FromFloat(const float f)
+{
+    unsigned int u = Bits(f);
+    const unsigned int sign = u & 0x80000000u;
+    u ^= sign;
+
+    unsigned int h;
+    if (u >= 0x47800000u) {
+        // Out of range: infinity, or a quiet NaN.
+        h = u > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    } else if (u < 0x38800000u) {
+        // Denormal or zero: adding 0.5 lines the mantissa up with the half denormal one,
+        // and the FPU does the rounding.
+        h = Bits(Float(u) + .5f) - 0x3f000000u;
+    } else {
+        // Rebias the exponent and round the dropped 13 bits to nearest even.
+        const unsigned int odd = (u >> 13) & 1u;
+        u += 0xc8000fffu + odd;
+        h = u >> 13;
+    }
+    return (unsigned short) (h | (sign >> 16));
+}
+
+float Half::ToFloat(const unsigned short h)
+{
+    const unsigned int exp_mask = 0x7c00u << 13;
+    unsigned int u = (h & 0x7fffu) << 13;
+    const unsigned int exp = u & exp_mask;
+    u += (127 - 15) << 23;
+
+    if (exp == exp_mask) {
+        // Infinity or NaN.
+        u += (128 - 16) << 23;
+    } else if (exp == 0) {
+        // Denormal: renormalize through the FPU.
+        u = Bits(Float(u + (1 << 23)) - Float(113u << 23));
+    }
+    return Float(u | ((h & 0x8000u) << 16));
+}
+
+void Half::FromFloats(const float *in, const unsigned int count, unsigned short *out)
+{
+    unsigned int i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i *) (out + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = FromFloat(in[i]);
+    }
+}
+
+void Half::ToFloats(const unsigned short *in, const unsigned int count, float *out)
+{
+    unsigned int i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (in + i))));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = ToFloat(in[i]);
+    }
+}
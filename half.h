@@ -0,0 +1,40 @@
+#ifndef __BCOSTA_HALF__
+#define __BCOSTA_HALF__
+
+namespace BCosta
+{
+    // IEEE 754 binary16 conversions. Rounding is to nearest even; overflow gives infinity,
+    // NaNs stay NaNs and denormals are kept both ways.
+    namespace Half
+    {
+        unsigned short FromFloat(const float f);
+
+        float ToFloat(const unsigned short h);
+
+        // Array forms, using the F16C instructions when the build targets them.
+        void FromFloats(const float *in, const unsigned int count, unsigned short *out);
+
+        void ToFloats(const unsigned short *in, const unsigned int count, float *out);
+    }
+
+    // Storage-only half float: converts to float for arithmetic and back on assignment, so
+    // templates written for float work on it unchanged.
+    class Float16
+    {
+    public:
+
+        unsigned short bits;
+
+        Float16()
+            : bits(0)
+        { }
+
+        Float16(const float f)
+            : bits(Half::FromFloat(f))
+        { }
+
+        operator float() const
+        { return Half::ToFloat(bits); }
+    };
+}
+#endif // __BCOSTA_HALF__
@@ -0,0 +1,575 @@
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <queue>
+#include "hull.h"
+#include "parallel.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+static const unsigned int none = ~0u;
+
+// Points per parallel range of the whole-input scans and the point assignment.
+static const unsigned int grain = 16384;
+
+namespace
+{
+    float Abs(const float a)
+    { return fabsf(a); }
+
+    struct Best
+    {
+        float value;
+        unsigned int index;
+    };
+
+    // Largest value wins, then lowest index, so the outcome is independent of how the
+    // input was split.
+    void Keep(Best &best, const float value, const unsigned int index)
+    {
+        if (value > best.value || (value == best.value && index < best.index)) {
+            best.value = value;
+            best.index = index;
+        }
+    }
+
+    // +x, -x, +y, -y, +z, -z.
+    struct AxisExtremes
+    {
+        static const unsigned int metrics = 6;
+
+        template<typename F>
+        void operator()(const F &x, const F &y, const F &z, F *out) const
+        {
+            out[0] = x;
+            out[1] = -x;
+            out[2] = y;
+            out[3] = -y;
+            out[4] = z;
+            out[5] = -z;
+        }
+    };
+
+    // Squared distance to the line through 'origin' along the unit 'direction'.
+    struct LineDistance
+    {
+        static const unsigned int metrics = 1;
+        float origin[3], direction[3];
+
+        template<typename F>
+        void operator()(const F &x, const F &y, const F &z, F *out) const
+        {
+            const F px = x - F(origin[0]), py = y - F(origin[1]), pz = z - F(origin[2]);
+            const F cx = py * F(direction[2]) - pz * F(direction[1]);
+            const F cy = pz * F(direction[0]) - px * F(direction[2]);
+            const F cz = px * F(direction[1]) - py * F(direction[0]);
+            out[0] = cx * cx + cy * cy + cz * cz;
+        }
+    };
+
+    // Distance to the plane through 'origin' with the unit 'normal', on either side.
+    struct PlaneDistance
+    {
+        static const unsigned int metrics = 1;
+        float origin[3], normal[3];
+
+        template<typename F>
+        void operator()(const F &x, const F &y, const F &z, F *out) const
+        {
+            out[0] = Abs((x - F(origin[0])) * F(normal[0]) + (y - F(origin[1])) * F(normal[1]) +
+                         (z - F(origin[2])) * F(normal[2]));
+        }
+    };
+
+    template<typename M>
+    void Scan(const Vector3 *points, const unsigned int begin, const unsigned int end, const M &metric, Best *best)
+    {
+        for (unsigned int k = 0; k < M::metrics; k++) {
+            best[k].value = -FLT_MAX;
+            best[k].index = none;
+        }
+
+        unsigned int i = begin;
+#ifdef __SSE2__
+        if (end - begin >= 4) {
+            Sse::Float4 values[M::metrics];
+            __m128i indices[M::metrics];
+            for (unsigned int k = 0; k < M::metrics; k++) {
+                values[k] = Sse::Float4(-FLT_MAX);
+                indices[k] = _mm_set1_epi32((int) none);
+            }
+
+            __m128i lane = _mm_setr_epi32((int) i, (int) i + 1, (int) i + 2, (int) i + 3);
+            const __m128i step = _mm_set1_epi32(4);
+            for (; i + 4 <= end; i += 4) {
+                const float *p = &points[i].x;
+                Sse::Float4 x, y, z;
+                Sse::Deinterleave3(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), x.v, y.v, z.v);
+
+                Sse::Float4 m[M::metrics];
+                metric(x, y, z, m);
+                for (unsigned int k = 0; k < M::metrics; k++) {
+                    const Sse::Float4 better = m[k] > values[k];
+                    const __m128i mask = _mm_castps_si128(better.v);
+                    values[k] = Select(better, m[k], values[k]);
+                    indices[k] = _mm_or_si128(_mm_and_si128(mask, lane), _mm_andnot_si128(mask, indices[k]));
+                }
+                lane = _mm_add_epi32(lane, step);
+            }
+
+            for (unsigned int k = 0; k < M::metrics; k++) {
+                alignas(16) float lane_values[4];
+                alignas(16) unsigned int lane_indices[4];
+                _mm_store_ps(lane_values, values[k].v);
+                _mm_store_si128((__m128i *) lane_indices, indices[k]);
+                for (unsigned int l = 0; l < 4; l++) {
+                    Keep(best[k], lane_values[l], lane_indices[l]);
+                }
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            float m[M::metrics];
+            metric(points[i].x, points[i].y, points[i].z, m);
+            for (unsigned int k = 0; k < M::metrics; k++) {
+                Keep(best[k], m[k], i);
+            }
+        }
+    }
+
+    // Point maximizing each of the metric's values.
+    template<typename M>
+    void Farthest(const Vector3 *points, const unsigned int count, const M &metric, Best *best)
+    {
+        const unsigned int chunks = (count + grain - 1) / grain;
+        std::vector<Best> partial(chunks * M::metrics);
+
+        Parallel::For(chunks, 1, [&](unsigned int first, unsigned int end) {
+            for (unsigned int c = first; c < end; c++) {
+                const unsigned int last = (c + 1) * grain < count ? (c + 1) * grain : count;
+                Scan(points, c * grain, last, metric, &partial[c * M::metrics]);
+            }
+        });
+
+        for (unsigned int k = 0; k < M::metrics; k++) {
+            best[k] = partial[k];
+            for (unsigned int c = 1; c < chunks; c++) {
+                Keep(best[k], partial[c * M::metrics + k].value, partial[c * M::metrics + k].index);
+            }
+        }
+    }
+
+    double Exact(const double *plane, const Vector3 &p)
+    { return p.x * plane[0] + p.y * plane[1] + p.z * plane[2] - plane[3]; }
+
+    // First of the planes (blocks of four: normal x, y, z, offset) the point is more than
+    // 'tolerance' above, and its distance, or none. Float distances decide unless they are
+    // within 'epsilon' of zero, where the double planes in 'exact' (four values per plane)
+    // settle it.
+    unsigned int Classify(const float *planes, const double *exact, const unsigned int blocks, const Vector3 &p,
+                          const float epsilon, const double tolerance, float &distance)
+    {
+#ifdef __SSE2__
+        const __m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y), pz = _mm_set1_ps(p.z);
+        const __m128 eps = _mm_set1_ps(epsilon), negative_eps = _mm_set1_ps(-epsilon);
+        for (unsigned int b = 0; b < blocks; b++) {
+            const float *plane = planes + b * 16;
+            const __m128 d = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_load_ps(plane)),
+                                                              _mm_mul_ps(py, _mm_load_ps(plane + 4))),
+                                                   _mm_mul_ps(pz, _mm_load_ps(plane + 8))),
+                                        _mm_load_ps(plane + 12));
+            const int candidates = _mm_movemask_ps(_mm_cmpge_ps(d, negative_eps));
+            if (!candidates) {
+                continue;
+            }
+            const int outside = _mm_movemask_ps(_mm_cmpgt_ps(d, eps));
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, d);
+            for (unsigned int l = 0; l < 4; l++) {
+                if ((outside >> l) & 1) {
+                    distance = lanes[l];
+                    return b * 4 + l;
+                }
+                if ((candidates >> l) & 1) {
+                    const double e = Exact(exact + (b * 4 + l) * 4, p);
+                    if (e > tolerance) {
+                        distance = (float) e;
+                        return b * 4 + l;
+                    }
+                }
+            }
+        }
+#else
+        for (unsigned int b = 0; b < blocks; b++) {
+            const float *plane = planes + b * 16;
+            for (unsigned int l = 0; l < 4; l++) {
+                const float d = p.x * plane[l] + p.y * plane[4 + l] + p.z * plane[8 + l] - plane[12 + l];
+                if (d > epsilon) {
+                    distance = d;
+                    return b * 4 + l;
+                }
+                if (d >= -epsilon) {
+                    const double e = Exact(exact + (b * 4 + l) * 4, p);
+                    if (e > tolerance) {
+                        distance = (float) e;
+                        return b * 4 + l;
+                    }
+                }
+            }
+        }
+#endif
+        return none;
+    }
+
+    struct Candidate
+    {
+        float distance;
+        unsigned int face;
+        unsigned int serial;
+
+        bool operator <(const Candidate &other) const
+        { return distance < other.distance || (distance == other.distance && face > other.face); }
+    };
+
+    Vector3 Sub(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+    Vector3 Cross(const Vector3 &a, const Vector3 &b)
+    { return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+    float Dot(const Vector3 &a, const Vector3 &b)
+    { return a.x * b.x + a.y * b.y + a.z * b.z; }
+}
+
+bool ConvexHull::Build(const Vector3 *points, const unsigned int count, const unsigned int max_vertices)
+{
+    vertices.clear();
+    indices.clear();
+    faces.clear();
+    free_faces.clear();
+    if (!points || count < 4) {
+        return false;
+    }
+    source = points;
+
+    Best extremes[6];
+    Farthest(points, count, AxisExtremes(), extremes);
+
+    // Tolerances from the coordinate magnitudes, as qhull does; 'epsilon' also covers the
+    // rounding of the float planes.
+    float scale = 0.f;
+    for (unsigned int k = 0; k < 6; k += 2) {
+        scale += std::max(fabsf(extremes[k].value), fabsf(extremes[k + 1].value));
+    }
+    epsilon = 16.f * FLT_EPSILON * scale;
+    tolerance = 3.0 * DBL_EPSILON * scale;
+
+    // Initial tetrahedron: the axis extremes farthest apart, the point farthest from their
+    // line and the point farthest from the plane of the three.
+    unsigned int a = extremes[0].index, b = extremes[1].index;
+    float span = 0.f;
+    for (unsigned int k = 0; k < 6; k += 2) {
+        const Vector3 d = Sub(points[extremes[k].index], points[extremes[k + 1].index]);
+        if (Dot(d, d) > span) {
+            span = Dot(d, d);
+            a = extremes[k].index;
+            b = extremes[k + 1].index;
+        }
+    }
+    if (span <= epsilon * epsilon) {
+        return false;
+    }
+
+    LineDistance line;
+    const Vector3 direction = Sub(points[b], points[a]) * (1.f / sqrtf(span));
+    line.origin[0] = points[a].x;
+    line.origin[1] = points[a].y;
+    line.origin[2] = points[a].z;
+    line.direction[0] = direction.x;
+    line.direction[1] = direction.y;
+    line.direction[2] = direction.z;
+    Best farthest;
+    Farthest(points, count, line, &farthest);
+    if (farthest.value <= epsilon * epsilon) {
+        return false;
+    }
+    unsigned int c = farthest.index;
+
+    Vector3 normal = Cross(Sub(points[b], points[a]), Sub(points[c], points[a]));
+    normal = normal * (1.f / sqrtf(Dot(normal, normal)));
+    PlaneDistance plane;
+    plane.origin[0] = points[a].x;
+    plane.origin[1] = points[a].y;
+    plane.origin[2] = points[a].z;
+    plane.normal[0] = normal.x;
+    plane.normal[1] = normal.y;
+    plane.normal[2] = normal.z;
+    Farthest(points, count, plane, &farthest);
+    if (farthest.value <= epsilon) {
+        return false;
+    }
+    const unsigned int d = farthest.index;
+
+    // a, b, c counter-clockwise seen from outside, d below them.
+    if (Dot(Sub(points[d], points[a]), normal) > 0.f) {
+        std::swap(b, c);
+    }
+    const unsigned int f0 = NewFace(a, b, c);
+    const unsigned int f1 = NewFace(a, d, b);
+    const unsigned int f2 = NewFace(b, d, c);
+    const unsigned int f3 = NewFace(c, d, a);
+    const unsigned int adjacency[4][3] = { { f1, f2, f3 }, { f3, f2, f0 }, { f1, f3, f0 }, { f2, f1, f0 } };
+    const unsigned int tetrahedron[4] = { f0, f1, f2, f3 };
+    new_faces.assign(tetrahedron, tetrahedron + 4);
+    for (unsigned int f = 0; f < 4; f++) {
+        for (unsigned int e = 0; e < 3; e++) {
+            faces[tetrahedron[f]].adj[e] = adjacency[f][e];
+        }
+    }
+
+    next.resize(count);
+    Assign(0, count);
+
+    // The farthest point overall goes in first, so a vertex-limited hull keeps the
+    // points that matter most.
+    std::priority_queue<Candidate> queue;
+    unsigned int hull_vertices = 4;
+    const unsigned int limit = max_vertices ? std::max(max_vertices, 4u) : none;
+    for (;;) {
+        for (size_t i = 0; i < new_faces.size(); i++) {
+            const Face &f = faces[new_faces[i]];
+            if (f.head != none) {
+                const Candidate candidate = { f.farthest_distance, new_faces[i], f.serial };
+                queue.push(candidate);
+            }
+        }
+
+        // Skip entries of faces removed since they were queued.
+        while (!queue.empty() && faces[queue.top().face].serial != queue.top().serial) {
+            queue.pop();
+        }
+        if (queue.empty() || hull_vertices >= limit) {
+            break;
+        }
+
+        const unsigned int face = queue.top().face;
+        queue.pop();
+        AddPoint(face, faces[face].farthest);
+        hull_vertices++;
+    }
+
+    Output();
+    return true;
+}
+
+unsigned int ConvexHull::NewFace(const unsigned int a, const unsigned int b, const unsigned int c)
+{
+    unsigned int index;
+    if (!free_faces.empty()) {
+        index = free_faces.back();
+        free_faces.pop_back();
+    } else {
+        index = (unsigned int) faces.size();
+        faces.push_back(Face());
+        faces[index].serial = 0;
+    }
+
+    Face &f = faces[index];
+    f.v[0] = a;
+    f.v[1] = b;
+    f.v[2] = c;
+    f.adj[0] = f.adj[1] = f.adj[2] = none;
+
+    const Vector3 &pa = source[a], &pb = source[b], &pc = source[c];
+    const double ux = (double) pb.x - pa.x, uy = (double) pb.y - pa.y, uz = (double) pb.z - pa.z;
+    const double vx = (double) pc.x - pa.x, vy = (double) pc.y - pa.y, vz = (double) pc.z - pa.z;
+    double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+    const double length = sqrt(nx * nx + ny * ny + nz * nz);
+    if (length > 0.0) {
+        nx /= length;
+        ny /= length;
+        nz /= length;
+    }
+    f.normal[0] = nx;
+    f.normal[1] = ny;
+    f.normal[2] = nz;
+    f.offset = nx * pa.x + ny * pa.y + nz * pa.z;
+
+    f.head = none;
+    f.farthest = none;
+    f.farthest_distance = 0.f;
+    f.mark = 0;
+    f.alive = true;
+    return index;
+}
+
+double ConvexHull::Distance(const Face &f, const unsigned int point) const
+{
+    const Vector3 &p = source[point];
+    return p.x * f.normal[0] + p.y * f.normal[1] + p.z * f.normal[2] - f.offset;
+}
+
+void ConvexHull::Assign(const unsigned int *points, const unsigned int count)
+{
+    // Planes of the new faces four at a time; the padding accepts nothing.
+    const unsigned int blocks = ((unsigned int) new_faces.size() + 3) / 4;
+    planes.assign(blocks * 16 + 4, 0.f);
+    exact_planes.resize(blocks * 16);
+    float *aligned = &planes[0] + ((16 - ((size_t) &planes[0] & 15)) & 15) / sizeof(float);
+    for (unsigned int i = 0; i < blocks * 4; i++) {
+        float *block = aligned + (i / 4) * 16 + (i & 3);
+        if (i < new_faces.size()) {
+            const Face &f = faces[new_faces[i]];
+            block[0] = (float) f.normal[0];
+            block[4] = (float) f.normal[1];
+            block[8] = (float) f.normal[2];
+            block[12] = (float) f.offset;
+            for (unsigned int k = 0; k < 3; k++) {
+                exact_planes[i * 4 + k] = f.normal[k];
+            }
+            exact_planes[i * 4 + 3] = f.offset;
+        } else {
+            block[12] = FLT_MAX;
+        }
+    }
+
+    assigned.resize(count);
+    distances.resize(count);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const unsigned int p = points ? points[i] : i;
+            assigned[i] = Classify(aligned, &exact_planes[0], blocks, source[p], epsilon, tolerance, distances[i]);
+        }
+    });
+
+    // Linking stays serial and in order, so outside lists and farthest points do not
+    // depend on the thread count.
+    for (unsigned int i = 0; i < count; i++) {
+        if (assigned[i] == none) {
+            continue;
+        }
+        const unsigned int p = points ? points[i] : i;
+        Face &f = faces[new_faces[assigned[i]]];
+        next[p] = f.head;
+        f.head = p;
+        if (distances[i] > f.farthest_distance) {
+            f.farthest_distance = distances[i];
+            f.farthest = p;
+        }
+    }
+}
+
+void ConvexHull::AddPoint(const unsigned int face, const unsigned int eye)
+{
+    const unsigned int current = ++stamp;
+    visible.clear();
+    horizon.clear();
+    stack.clear();
+
+    // Depth first over the faces the eye sees, each face resuming after the edge it was
+    // entered by, so the edges where the search stops come out as one loop in order.
+    // Stack entries are (face, next edge, edges left).
+    faces[face].mark = current;
+    visible.push_back(face);
+    stack.push_back(face);
+    stack.push_back(0);
+    stack.push_back(3);
+    while (!stack.empty()) {
+        const size_t top = stack.size() - 3;
+        if (stack[top + 2] == 0) {
+            stack.resize(top);
+            continue;
+        }
+        const unsigned int f = stack[top];
+        const unsigned int edge = stack[top + 1];
+        stack[top + 1] = (edge + 1) % 3;
+        stack[top + 2]--;
+
+        const unsigned int g = faces[f].adj[edge];
+        if (faces[g].mark == current) {
+            continue;
+        }
+        if (Distance(faces[g], eye) > tolerance) {
+            faces[g].mark = current;
+            visible.push_back(g);
+            unsigned int back = 0;
+            while (faces[g].adj[back] != f) {
+                back++;
+            }
+            stack.push_back(g);
+            stack.push_back((back + 1) % 3);
+            stack.push_back(2);
+        } else {
+            const HorizonEdge e = { faces[f].v[edge], faces[f].v[(edge + 1) % 3], g };
+            horizon.push_back(e);
+        }
+    }
+
+    // Points outside the removed faces go to the new ones or turn out to be inside.
+    orphans.clear();
+    for (size_t i = 0; i < visible.size(); i++) {
+        Face &f = faces[visible[i]];
+        for (unsigned int p = f.head; p != none; p = next[p]) {
+            if (p != eye) {
+                orphans.push_back(p);
+            }
+        }
+        f.head = none;
+        f.alive = false;
+        f.serial++;
+        free_faces.push_back(visible[i]);
+    }
+
+    // A fan from the eye to the horizon. New face k is (a, b, eye): the horizon edge, then
+    // the edges shared with faces k + 1 and k - 1.
+    new_faces.clear();
+    for (size_t k = 0; k < horizon.size(); k++) {
+        const HorizonEdge &e = horizon[k];
+        const unsigned int f = NewFace(e.a, e.b, eye);
+        faces[f].adj[0] = e.outside;
+        Face &outside = faces[e.outside];
+        for (unsigned int j = 0; j < 3; j++) {
+            if (outside.v[j] == e.b) {
+                outside.adj[j] = f;
+            }
+        }
+        new_faces.push_back(f);
+    }
+    const size_t n = new_faces.size();
+    for (size_t k = 0; k < n; k++) {
+        faces[new_faces[k]].adj[1] = new_faces[(k + 1) % n];
+        faces[new_faces[k]].adj[2] = new_faces[(k + n - 1) % n];
+    }
+
+    Assign(orphans.empty() ? 0 : &orphans[0], (unsigned int) orphans.size());
+}
+
+void ConvexHull::Output()
+{
+    // Hull vertices are the corners of the remaining faces, kept in input order; the
+    // point links are free by now and map points to vertex numbers.
+    const unsigned int count = (unsigned int) next.size();
+    std::fill(next.begin(), next.end(), none);
+    for (size_t i = 0; i < faces.size(); i++) {
+        if (faces[i].alive) {
+            for (unsigned int k = 0; k < 3; k++) {
+                next[faces[i].v[k]] = 0;
+            }
+        }
+    }
+    for (unsigned int p = 0; p < count; p++) {
+        if (next[p] != none) {
+            next[p] = (unsigned int) vertices.size();
+            vertices.push_back(source[p]);
+        }
+    }
+
+    for (size_t i = 0; i < faces.size(); i++) {
+        if (faces[i].alive) {
+            for (unsigned int k = 0; k < 3; k++) {
+                indices.push_back(next[faces[i].v[k]]);
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef __BCOSTA_HULL__
+#define __BCOSTA_HULL__
+
+#include <vector>
+#include "vector.h"
+
+namespace BCosta
+{
+    // 3D convex hull by quickhull, as triangles.
+    //
+    // Faces live in a pool with a free list and outside points are chained through one
+    // per-point link array, so growing the hull allocates nothing per face or point; the
+    // working storage is kept between builds, which makes rebuilding many hulls cheap.
+    // Passes over the whole input (the initial extreme point scans and the first split of
+    // the points between the faces) are vectorized and split across threads, and so is
+    // every later reassignment large enough to be worth it. The result does not depend on
+    // the thread count.
+    //
+    // Face planes and visibility decisions are kept in double precision, with a tolerance
+    // scaled by the extent of the input; float tolerances fold dense, nearly flat regions
+    // (sampled spheres) into non-convex fans. The vectorized passes run in float and only
+    // settle in double the points too close to a face to tell.
+    class ConvexHull
+    {
+    public:
+
+        ConvexHull()
+            : source(0), stamp(0)
+        { }
+
+        // Hull of 'points'. A nonzero max_vertices stops growth at that many vertices (at
+        // least the four of the starting tetrahedron), each step adding the point farthest
+        // outside: the result is a simplified hull inside the exact one, as wanted for
+        // collision shapes. Returns false and leaves the hull empty when the points span no
+        // volume.
+        bool Build(const Vector3 *points, const unsigned int count, const unsigned int max_vertices = 0);
+
+        // Hull vertices, in input order.
+        const std::vector<Vector3> &Vertices() const
+        { return vertices; }
+
+        // Three indices into Vertices() per triangle, counter-clockwise seen from outside.
+        const std::vector<unsigned int> &Indices() const
+        { return indices; }
+
+        unsigned int VertexCount() const
+        { return (unsigned int) vertices.size(); }
+
+        unsigned int TriangleCount() const
+        { return (unsigned int) indices.size() / 3; }
+
+    private:
+
+        struct Face
+        {
+            // Edge i runs from v[i] to v[(i + 1) % 3]; adj[i] is the face across it.
+            unsigned int v[3];
+            unsigned int adj[3];
+            double normal[3];
+            double offset;
+
+            // Outside points, chained through 'next', and the farthest of them.
+            unsigned int head;
+            unsigned int farthest;
+            float farthest_distance;
+
+            // Changes whenever the slot is freed, invalidating queued references.
+            unsigned int serial;
+            unsigned int mark;
+            bool alive;
+        };
+
+        struct HorizonEdge
+        {
+            unsigned int a, b;
+            unsigned int outside;
+        };
+
+        unsigned int NewFace(const unsigned int a, const unsigned int b, const unsigned int c);
+
+        double Distance(const Face &f, const unsigned int point) const;
+
+        // Give each of the points to the first new face it is outside of.
+        void Assign(const unsigned int *points, const unsigned int count);
+
+        void AddPoint(const unsigned int face, const unsigned int eye);
+
+        void Output();
+
+        const Vector3 *source;
+        // Float distances within 'epsilon' of zero are rechecked against 'tolerance'.
+        float epsilon;
+        double tolerance;
+        unsigned int stamp;
+
+        std::vector<Face> faces;
+        std::vector<unsigned int> free_faces;
+        std::vector<unsigned int> next;
+
+        // Scratch of one step.
+        std::vector<unsigned int> new_faces;
+        std::vector<unsigned int> visible;
+        std::vector<HorizonEdge> horizon;
+        std::vector<unsigned int> orphans;
+        std::vector<unsigned int> stack;
+        std::vector<float> planes;
+        std::vector<double> exact_planes;
+        std::vector<unsigned int> assigned;
+        std::vector<float> distances;
+
+        std::vector<Vector3> vertices;
+        std::vector<unsigned int> indices;
+    };
+}
+#endif // __BCOSTA_HULL__
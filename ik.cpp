@@ -0,0 +1,513 @@
+#include <math.h>
+#include "ik.h"
+#include "parallel.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 1024;
+
+// Chains per range: each costs a few hundred operations per iteration.
+static const unsigned int chain_grain = 64;
+
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Ik streams Vector3 arrays as strided floats");
+
+namespace
+{
+    // Scalar counterparts of the Sse::Float4 functions, so the solvers below are written
+    // once and instantiated for one chain or four.
+    float Sqrt(const float a)
+    { return sqrtf(a); }
+
+    float Abs(const float a)
+    { return fabsf(a); }
+
+    float Min(const float a, const float b)
+    { return a < b ? a : b; }
+
+    float Max(const float a, const float b)
+    { return a > b ? a : b; }
+
+    float Select(const bool mask, const float a, const float b)
+    { return mask ? a : b; }
+
+    bool Any(const bool mask)
+    { return mask; }
+
+    bool And(const bool a, const bool b)
+    { return a && b; }
+
+    void Load(const float *p, float &out)
+    { out = *p; }
+
+    void Store(float *p, const float a)
+    { *p = a; }
+
+    void Flags(const bool mask, unsigned char *out)
+    { out[0] = mask; }
+
+#ifdef __SSE2__
+    void Load(const float *p, Sse::Float4 &out)
+    { out.v = _mm_loadu_ps(p); }
+
+    void Store(float *p, const Sse::Float4 &a)
+    { _mm_storeu_ps(p, a.v); }
+
+    void Flags(const Sse::Float4 &mask, unsigned char *out)
+    {
+        const int bits = _mm_movemask_ps(mask.v);
+        for (unsigned int k = 0; k < 4; k++) {
+            out[k] = (unsigned char) ((bits >> k) & 1);
+        }
+    }
+#endif
+
+    template<typename F>
+    struct Vec3
+    {
+        F x, y, z;
+    };
+
+    template<typename F>
+    struct Quat
+    {
+        F x, y, z, w;
+    };
+
+    template<typename F>
+    Vec3<F> Make(const F &x, const F &y, const F &z)
+    {
+        const Vec3<F> v = {x, y, z};
+        return v;
+    }
+
+    template<typename F>
+    Vec3<F> Add(const Vec3<F> &a, const Vec3<F> &b)
+    { return Make(a.x + b.x, a.y + b.y, a.z + b.z); }
+
+    template<typename F>
+    Vec3<F> Sub(const Vec3<F> &a, const Vec3<F> &b)
+    { return Make(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+    template<typename F>
+    Vec3<F> Scale(const Vec3<F> &a, const F &k)
+    { return Make(a.x * k, a.y * k, a.z * k); }
+
+    template<typename F>
+    F Dot(const Vec3<F> &a, const Vec3<F> &b)
+    { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    template<typename F>
+    Vec3<F> Cross(const Vec3<F> &a, const Vec3<F> &b)
+    { return Make(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+    template<typename F>
+    F Length(const Vec3<F> &a)
+    { return Sqrt(Dot(a, a)); }
+
+    // Zero vectors stay zero.
+    template<typename F>
+    Vec3<F> Normalize(const Vec3<F> &a)
+    { return Scale(a, F(1.f) / Max(Length(a), F(1e-20f))); }
+
+    template<typename F, typename M>
+    Vec3<F> Select(const M &mask, const Vec3<F> &a, const Vec3<F> &b)
+    { return Make(Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z)); }
+
+    // A unit vector perpendicular to unit 'a'.
+    template<typename F>
+    Vec3<F> Orthogonal(const Vec3<F> &a)
+    {
+        const F zero(0.f);
+        return Normalize(Select(Abs(a.x) > Abs(a.z), Make(-a.y, a.x, zero), Make(zero, -a.z, a.y)));
+    }
+
+    template<typename F>
+    Quat<F> Mul(const Quat<F> &a, const Quat<F> &b)
+    {
+        const Quat<F> q = {
+            a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+        };
+        return q;
+    }
+
+    // q v q*, for unit q.
+    template<typename F>
+    Vec3<F> Rotate(const Quat<F> &q, const Vec3<F> &v)
+    {
+        const Vec3<F> u = Make(q.x, q.y, q.z);
+        const Vec3<F> t = Scale(Cross(u, v), F(2.f));
+        return Add(Add(v, Scale(t, q.w)), Cross(u, t));
+    }
+
+    // Shortest arc taking unit 'a' onto unit 'b'; half a turn about any perpendicular axis
+    // when they are opposite.
+    template<typename F>
+    Quat<F> FromTo(const Vec3<F> &a, const Vec3<F> &b)
+    {
+        const F w = F(1.f) + Dot(a, b);
+        const auto opposite = w < F(1e-6f);
+        const Vec3<F> axis = Select(opposite, Orthogonal(a), Cross(a, b));
+        const F qw = Select(opposite, F(0.f), w);
+        const F inv = F(1.f) / Sqrt(Dot(axis, axis) + qw * qw);
+        const Quat<F> q = {axis.x * inv, axis.y * inv, axis.z * inv, qw * inv};
+        return q;
+    }
+
+    // Unit 'd' pulled back inside the cone of half-angle 'limit' around unit 'axis'.
+    template<typename F>
+    Vec3<F> Constrain(const Vec3<F> &d, const Vec3<F> &axis, const float limit)
+    {
+        const F cos_limit(cosf(limit)), sin_limit(sinf(limit));
+        const F c = Dot(d, axis);
+        const Vec3<F> perp = Sub(d, Scale(axis, c));
+        const F length = Length(perp);
+        const Vec3<F> side = Select(length > F(1e-6f), Scale(perp, F(1.f) / Max(length, F(1e-6f))), Orthogonal(axis));
+        return Select(c < cos_limit, Add(Scale(axis, cos_limit), Scale(side, sin_limit)), d);
+    }
+
+    // Joint positions as three strided float streams: one chain of a Vector3 array, or four
+    // consecutive chains of a batch.
+    struct Stream
+    {
+        float *x, *y, *z;
+        size_t stride;
+
+        template<typename F>
+        Vec3<F> Get(const unsigned int j) const
+        {
+            Vec3<F> v;
+            Load(x + j * stride, v.x);
+            Load(y + j * stride, v.y);
+            Load(z + j * stride, v.z);
+            return v;
+        }
+
+        template<typename F>
+        void Set(const unsigned int j, const Vec3<F> &v) const
+        {
+            Store(x + j * stride, v.x);
+            Store(y + j * stride, v.y);
+            Store(z + j * stride, v.z);
+        }
+    };
+
+    Stream FromArray(Vector3 *positions)
+    {
+        const Stream s = {&positions->x, &positions->y, &positions->z, 3};
+        return s;
+    }
+
+    Stream FromSoA(const Vector3SoA &soa, const unsigned int first, const unsigned int stride)
+    {
+        const Stream s = {soa.x + first, soa.y + first, soa.z + first, stride};
+        return s;
+    }
+
+    template<typename F>
+    auto Outside(const Vec3<F> &end, const Vec3<F> &target, const float tolerance) -> decltype(F() > F())
+    {
+        const Vec3<F> e = Sub(end, target);
+        return Dot(e, e) > F(tolerance * tolerance);
+    }
+
+    template<typename F>
+    auto Within(const Vec3<F> &end, const Vec3<F> &target, const float tolerance) -> decltype(F() > F())
+    {
+        const Vec3<F> e = Sub(end, target);
+        return Dot(e, e) <= F(tolerance * tolerance);
+    }
+
+    // Bone lengths are never stored: each pass reads them off the positions the previous
+    // pass left, which it had set at exactly those lengths. Returns the reached mask.
+    template<typename F>
+    auto Fabrik(const Stream &s, const unsigned int n, const Vec3<F> &target, const float *limits,
+                const unsigned int max_iterations, const float tolerance) -> decltype(F() > F())
+    {
+        const Vec3<F> root = s.Get<F>(0);
+        auto active = Outside(s.Get<F>(n - 1), target, tolerance);
+
+        for (unsigned int iteration = 0; iteration < max_iterations && Any(active); iteration++) {
+            // Forward: end effector onto the target, every joint then toward its child.
+            Vec3<F> child_old = s.Get<F>(n - 1), child = target;
+            s.Set(n - 1, Select(active, child, child_old));
+            for (unsigned int j = n - 1; j-- > 0;) {
+                const Vec3<F> p = s.Get<F>(j);
+                const F length = Length(Sub(child_old, p));
+                const Vec3<F> moved = Add(child, Scale(Normalize(Sub(p, child)), length));
+                s.Set(j, Select(active, moved, p));
+                child_old = p;
+                child = moved;
+            }
+
+            // Backward: root back in place, every joint then at bone length from its parent,
+            // inside its cone.
+            Vec3<F> parent_old = s.Get<F>(0), parent = root, bone = Make(F(0.f), F(0.f), F(0.f));
+            s.Set(0, Select(active, parent, parent_old));
+            for (unsigned int j = 0; j + 1 < n; j++) {
+                const Vec3<F> p = s.Get<F>(j + 1);
+                const F length = Length(Sub(p, parent_old));
+                Vec3<F> d = Normalize(Sub(p, parent));
+                if (limits && j > 0) {
+                    d = Constrain(d, bone, limits[j]);
+                }
+                const Vec3<F> moved = Add(parent, Scale(d, length));
+                s.Set(j + 1, Select(active, moved, p));
+                bone = d;
+                parent_old = p;
+                parent = moved;
+            }
+            active = And(active, Outside(parent, target, tolerance));
+        }
+        return Within(s.Get<F>(n - 1), target, tolerance);
+    }
+
+    template<typename F>
+    auto Ccd(const Stream &s, const unsigned int n, const Vec3<F> &target, const float *limits,
+             const unsigned int max_iterations, const float tolerance) -> decltype(F() > F())
+    {
+        auto active = Outside(s.Get<F>(n - 1), target, tolerance);
+
+        for (unsigned int iteration = 0; iteration < max_iterations && Any(active); iteration++) {
+            for (unsigned int j = n - 1; j-- > 0;) {
+                const Vec3<F> pivot = s.Get<F>(j);
+                Quat<F> q = FromTo(Normalize(Sub(s.Get<F>(n - 1), pivot)), Normalize(Sub(target, pivot)));
+
+                // Rotating the rest of the chain rigidly only changes the angle at this joint.
+                if (limits && j > 0) {
+                    const Vec3<F> d = Rotate(q, Normalize(Sub(s.Get<F>(j + 1), pivot)));
+                    const Vec3<F> parent_bone = Normalize(Sub(pivot, s.Get<F>(j - 1)));
+                    q = Mul(FromTo(d, Constrain(d, parent_bone, limits[j])), q);
+                }
+
+                for (unsigned int k = j + 1; k < n; k++) {
+                    const Vec3<F> p = s.Get<F>(k);
+                    s.Set(k, Select(active, Add(pivot, Rotate(q, Sub(p, pivot))), p));
+                }
+            }
+            active = And(active, Outside(s.Get<F>(n - 1), target, tolerance));
+        }
+        return Within(s.Get<F>(n - 1), target, tolerance);
+    }
+
+    // Law of cosines in the plane of root, target and pole. Out of reach targets, or ones
+    // too close for the bone lengths, are clamped to the nearest reachable distance.
+    template<typename F>
+    auto TwoBone(const Vec3<F> &a, Vec3<F> &b, Vec3<F> &c, const Vec3<F> &target, const Vec3<F> &pole,
+                 Quat<F> &root_delta, Quat<F> &mid_delta) -> decltype(F() > F())
+    {
+        const Vec3<F> ab = Sub(b, a), bc = Sub(c, b), at = Sub(target, a);
+        const F l1 = Length(ab), l2 = Length(bc), d = Length(at);
+        const F shortest = Abs(l1 - l2), longest = l1 + l2;
+        const auto reachable = And(d <= longest, shortest <= d);
+        const F reach = Min(Max(d, shortest * F(1.f + 1e-5f)), longest * F(1.f - 1e-5f));
+
+        // Aim direction, then the bend side: the pole's component across it, else the
+        // current mid joint's, else any.
+        const Vec3<F> dir = Select(d > F(1e-12f), Scale(at, F(1.f) / Max(d, F(1e-12f))), Normalize(Sub(c, a)));
+        const Vec3<F> pole_side = Sub(Sub(pole, a), Scale(dir, Dot(Sub(pole, a), dir)));
+        const Vec3<F> mid_side = Sub(ab, Scale(dir, Dot(ab, dir)));
+        const Vec3<F> side = Select(Dot(pole_side, pole_side) > F(1e-12f), pole_side,
+                                    Select(Dot(mid_side, mid_side) > F(1e-12f), mid_side, Orthogonal(dir)));
+        const Vec3<F> bend = Normalize(side);
+
+        const F cos_a = Min(Max((l1 * l1 + reach * reach - l2 * l2) / (F(2.f) * l1 * reach), F(-1.f)), F(1.f));
+        const F sin_a = Sqrt(Max(F(1.f) - cos_a * cos_a, F(0.f)));
+        const Vec3<F> mid = Add(a, Add(Scale(dir, l1 * cos_a), Scale(bend, l1 * sin_a)));
+        const Vec3<F> end = Add(a, Scale(dir, reach));
+
+        root_delta = FromTo(Normalize(ab), Normalize(Sub(mid, a)));
+        mid_delta = FromTo(Normalize(Rotate(root_delta, bc)), Normalize(Sub(end, mid)));
+        b = mid;
+        c = end;
+        return reachable;
+    }
+
+    template<typename F>
+    Vec3<F> Get(const Vector3SoA &soa, const unsigned int i)
+    { return FromSoA(soa, i, 1).Get<F>(0); }
+
+    template<typename F>
+    void Set(const Vector3SoA &soa, const unsigned int i, const Vec3<F> &v)
+    { FromSoA(soa, i, 1).Set(0, v); }
+
+    template<typename F>
+    void Set(const QuaternionSoA &soa, const unsigned int i, const Quat<F> &q)
+    {
+        Store(soa.x + i, q.x);
+        Store(soa.y + i, q.y);
+        Store(soa.z + i, q.z);
+        Store(soa.w + i, q.w);
+    }
+
+    template<typename F>
+    void TwoBoneAt(const Vector3SoA &root, const Vector3SoA &mid, const Vector3SoA &end, const Vector3SoA &targets,
+                   const Vector3SoA &poles, const unsigned int i, const QuaternionSoA &root_delta,
+                   const QuaternionSoA &mid_delta, unsigned char *reached)
+    {
+        Vec3<F> b = Get<F>(mid, i), c = Get<F>(end, i);
+        Quat<F> qr, qm;
+        const auto ok = TwoBone(Get<F>(root, i), b, c, Get<F>(targets, i), Get<F>(poles, i), qr, qm);
+        Set(mid, i, b);
+        Set(end, i, c);
+        Set(root_delta, i, qr);
+        Set(mid_delta, i, qm);
+        if (reached) {
+            Flags(ok, reached + i);
+        }
+    }
+
+    // Chains of a batch, four at a time then one at a time, through 'solve'.
+    template<typename S>
+    void Chains(const Vector3SoA &positions, const unsigned int chain_count, const Vector3SoA &targets,
+                unsigned char *reached, const S &solve)
+    {
+        Parallel::For(chain_count, chain_grain, [&](unsigned int begin, unsigned int end) {
+            unsigned int c = begin;
+#ifdef __SSE2__
+            for (; c + 4 <= end; c += 4) {
+                const Sse::Float4 ok = solve(FromSoA(positions, c, chain_count), Get<Sse::Float4>(targets, c));
+                if (reached) {
+                    Flags(ok, reached + c);
+                }
+            }
+#endif
+            for (; c < end; c++) {
+                const bool ok = solve(FromSoA(positions, c, chain_count), Get<float>(targets, c));
+                if (reached) {
+                    Flags(ok, reached + c);
+                }
+            }
+        });
+    }
+
+    struct FabrikSolver
+    {
+        unsigned int joint_count;
+        const float *limits;
+        unsigned int max_iterations;
+        float tolerance;
+
+        template<typename F>
+        auto operator()(const Stream &s, const Vec3<F> &target) const -> decltype(F() > F())
+        { return Fabrik(s, joint_count, target, limits, max_iterations, tolerance); }
+    };
+
+    struct CcdSolver
+    {
+        unsigned int joint_count;
+        const float *limits;
+        unsigned int max_iterations;
+        float tolerance;
+
+        template<typename F>
+        auto operator()(const Stream &s, const Vec3<F> &target) const -> decltype(F() > F())
+        { return Ccd(s, joint_count, target, limits, max_iterations, tolerance); }
+    };
+
+    Quat<float> ToQuat(const Quaternion &q)
+    {
+        const Quat<float> r = {q.x, q.y, q.z, q.w};
+        return r;
+    }
+
+    Quaternion ToQuaternion(const Quat<float> &q)
+    { return Quaternion(q.x, q.y, q.z, q.w); }
+
+    Vec3<float> ToVec3(const Vector3 &v)
+    { return Make(v.x, v.y, v.z); }
+}
+
+bool Ik::TwoBone(const Vector3 &root, Vector3 &mid, Vector3 &end, const Vector3 &target, const Vector3 &pole,
+                 Quaternion &root_delta, Quaternion &mid_delta)
+{
+    Vec3<float> b = ToVec3(mid), c = ToVec3(end);
+    Quat<float> qr, qm;
+    const bool ok = ::TwoBone(ToVec3(root), b, c, ToVec3(target), ToVec3(pole), qr, qm);
+    mid = Vector3(b.x, b.y, b.z);
+    end = Vector3(c.x, c.y, c.z);
+    root_delta = ToQuaternion(qr);
+    mid_delta = ToQuaternion(qm);
+    return ok;
+}
+
+void Ik::TwoBone(const Vector3SoA &root, const Vector3SoA &mid, const Vector3SoA &end, const Vector3SoA &targets,
+                 const Vector3SoA &poles, const unsigned int count, const QuaternionSoA &root_delta,
+                 const QuaternionSoA &mid_delta, unsigned char *reached)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int last) {
+        unsigned int i = begin;
+#ifdef __SSE2__
+        for (; i + 4 <= last; i += 4) {
+            TwoBoneAt<Sse::Float4>(root, mid, end, targets, poles, i, root_delta, mid_delta, reached);
+        }
+#endif
+        for (; i < last; i++) {
+            TwoBoneAt<float>(root, mid, end, targets, poles, i, root_delta, mid_delta, reached);
+        }
+    });
+}
+
+bool Ik::Fabrik(Vector3 *positions, const unsigned int joint_count, const Vector3 &target, const float *limits,
+                const unsigned int max_iterations, const float tolerance)
+{
+    if (joint_count < 2) {
+        return false;
+    }
+    return ::Fabrik(FromArray(positions), joint_count, ToVec3(target), limits, max_iterations, tolerance);
+}
+
+bool Ik::Ccd(Vector3 *positions, const unsigned int joint_count, const Vector3 &target, const float *limits,
+             const unsigned int max_iterations, const float tolerance)
+{
+    if (joint_count < 2) {
+        return false;
+    }
+    return ::Ccd(FromArray(positions), joint_count, ToVec3(target), limits, max_iterations, tolerance);
+}
+
+void Ik::Fabrik(const Vector3SoA &positions, const unsigned int joint_count, const unsigned int chain_count,
+                const Vector3SoA &targets, const float *limits, const unsigned int max_iterations,
+                const float tolerance, unsigned char *reached)
+{
+    if (joint_count < 2) {
+        return;
+    }
+    const FabrikSolver solver = {joint_count, limits, max_iterations, tolerance};
+    Chains(positions, chain_count, targets, reached, solver);
+}
+
+void Ik::Ccd(const Vector3SoA &positions, const unsigned int joint_count, const unsigned int chain_count,
+             const Vector3SoA &targets, const float *limits, const unsigned int max_iterations,
+             const float tolerance, unsigned char *reached)
+{
+    if (joint_count < 2) {
+        return;
+    }
+    const CcdSolver solver = {joint_count, limits, max_iterations, tolerance};
+    Chains(positions, chain_count, targets, reached, solver);
+}
+
+void Ik::Rotations(const Vector3 *before, const Vector3 *after, const unsigned int joint_count,
+                   const Quaternion &parent, Quaternion *locals)
+{
+    // Old and new world rotations of the previous joint.
+    Quat<float> world = ToQuat(parent), moved = world;
+    Quat<float> swing = {0.f, 0.f, 0.f, 1.f};
+
+    for (unsigned int i = 0; i < joint_count; i++) {
+        const Quat<float> old_world = Mul(world, ToQuat(locals[i]));
+        if (i + 1 < joint_count) {
+            swing = FromTo(Normalize(Sub(ToVec3(before[i + 1]), ToVec3(before[i]))),
+                           Normalize(Sub(ToVec3(after[i + 1]), ToVec3(after[i]))));
+        }
+        const Quat<float> new_world = Mul(swing, old_world);
+        const Quat<float> inverse = {-moved.x, -moved.y, -moved.z, moved.w};
+        locals[i] = ToQuaternion(Mul(inverse, new_world));
+        world = old_world;
+        moved = new_world;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __BCOSTA_IK__
+#define __BCOSTA_IK__
+
+#include "quaternion.h"
+#include "soa.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Inverse kinematics on joint positions. A chain of n joints has n - 1 bones, bone j
+    // running from joint j to joint j + 1; joint 0 is the fixed root and joint n - 1 the end
+    // effector. Solvers keep bone lengths and move the joints; Rotations turns the result
+    // into local rotations for the skeleton.
+    //
+    // Joint limits are cones: limits[j] is the largest angle in radians between bone j and
+    // bone j - 1 (limits[0] is unused). Iterative solvers stop as soon as the end effector is
+    // within 'tolerance' of the target.
+    //
+    // Batched calls take many independent chains as component streams and solve four per
+    // step in SSE lanes, in parallel ranges; lanes that have converged are left alone while
+    // the others iterate. In the chain batches, element j * chain_count + c of each stream
+    // is joint j of chain c.
+    namespace Ik
+    {
+        // Analytic two-bone solve (arm, leg): moves 'mid' and 'end' so that 'end' reaches
+        // 'target', or points at it when out of reach, with the bend in the plane of the
+        // target and 'pole'. root_delta and mid_delta are the world-space rotations taking the
+        // old bones onto the new ones: the root's world rotation becomes root_delta * rotation
+        // and the mid joint's mid_delta * root_delta * rotation. Returns whether the target
+        // is reachable.
+        bool TwoBone(const Vector3 &root, Vector3 &mid, Vector3 &end, const Vector3 &target, const Vector3 &pole,
+                     Quaternion &root_delta, Quaternion &mid_delta);
+
+        // TwoBone on every element. 'reached' may be null.
+        void TwoBone(const Vector3SoA &root, const Vector3SoA &mid, const Vector3SoA &end, const Vector3SoA &targets,
+                     const Vector3SoA &poles, const unsigned int count, const QuaternionSoA &root_delta,
+                     const QuaternionSoA &mid_delta, unsigned char *reached);
+
+        // Forward and backward reaching (FABRIK). Returns whether the target was reached.
+        bool Fabrik(Vector3 *positions, const unsigned int joint_count, const Vector3 &target, const float *limits = 0,
+                    const unsigned int max_iterations = 16, const float tolerance = 1e-3f);
+
+        // Cyclic coordinate descent: each joint in turn, from the end, rotates the rest of
+        // the chain to aim the end effector at the target.
+        bool Ccd(Vector3 *positions, const unsigned int joint_count, const Vector3 &target, const float *limits = 0,
+                 const unsigned int max_iterations = 16, const float tolerance = 1e-3f);
+
+        // Chain batches sharing joint count and limits. 'reached' may be null.
+        void Fabrik(const Vector3SoA &positions, const unsigned int joint_count, const unsigned int chain_count,
+                    const Vector3SoA &targets, const float *limits, const unsigned int max_iterations,
+                    const float tolerance, unsigned char *reached);
+
+        void Ccd(const Vector3SoA &positions, const unsigned int joint_count, const unsigned int chain_count,
+                 const Vector3SoA &targets, const float *limits, const unsigned int max_iterations,
+                 const float tolerance, unsigned char *reached);
+
+        // Update the local rotations of a chain from its joint positions before and after a
+        // solve. Each bone is swung by the shortest arc from its old direction to its new
+        // one; 'parent' is the world rotation of the root's parent. The end effector keeps
+        // its rotation relative to the last bone.
+        void Rotations(const Vector3 *before, const Vector3 *after, const unsigned int joint_count,
+                       const Quaternion &parent, Quaternion *locals);
+    }
+}
+#endif // __BCOSTA_IK__
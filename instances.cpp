@@ -0,0 +1,210 @@
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "instances.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+// Instances per chunk: the staged matrices (24 KB) stay in cache until streamed out.
+static const unsigned int chunk = 512;
+
+namespace
+{
+    float Abs(const float a)
+    { return fabsf(a); }
+
+    bool And(const bool a, const bool b)
+    { return a && b; }
+
+    void Load(const float *p, float &out)
+    { out = *p; }
+
+    // Lane visibility bits.
+    int Bits(const bool mask)
+    { return mask ? 1 : 0; }
+
+#ifdef __SSE2__
+    void Load(const float *p, Sse::Float4 &out)
+    { out.v = _mm_loadu_ps(p); }
+
+    int Bits(const Sse::Float4 &mask)
+    { return _mm_movemask_ps(mask.v); }
+#endif
+
+    // Planes a * x + b * y + c * z + d >= 0 bounding the visible volume, from the rows of
+    // the view-projection matrix (Gribb and Hartmann). Not normalized: only signs matter.
+    struct Frustum
+    {
+        float planes[6][4];
+
+        explicit Frustum(const Matrix4 &m)
+        {
+            for (unsigned int p = 0; p < 6; p++) {
+                const float sign = p & 1 ? -1.f : 1.f;
+                const unsigned int row = p / 2;
+                for (unsigned int k = 0; k < 4; k++) {
+                    planes[p][k] = m.m[12 + k] + sign * m.m[row * 4 + k];
+                }
+            }
+        }
+    };
+
+    template<typename F>
+    auto Inside(const float plane[4], const F c[3], const F e[3]) -> decltype(F() <= F())
+    {
+        const F distance = c[0] * F(plane[0]) + c[1] * F(plane[1]) + c[2] * F(plane[2]) + F(plane[3]);
+        const F radius = e[0] * F(fabsf(plane[0])) + e[1] * F(fabsf(plane[1])) + e[2] * F(fabsf(plane[2]));
+        return F(0.f) <= distance + radius;
+    }
+
+    // World matrix rows (three of them, translation last) of instances i .. i + lanes and
+    // their visibility bits.
+    template<typename F>
+    int Instance(const InstanceSoA &in, const unsigned int i, const Vector3 &center, const Vector3 &extents,
+                 const Frustum &frustum, F rows[12])
+    {
+        F tx, ty, tz, qx, qy, qz, qw, sx, sy, sz;
+        Load(in.translation.x + i, tx);
+        Load(in.translation.y + i, ty);
+        Load(in.translation.z + i, tz);
+        Load(in.rotation.x + i, qx);
+        Load(in.rotation.y + i, qy);
+        Load(in.rotation.z + i, qz);
+        Load(in.rotation.w + i, qw);
+        Load(in.scale.x + i, sx);
+        Load(in.scale.y + i, sy);
+        Load(in.scale.z + i, sz);
+
+        // Rotation times scale, as in Matrix4::Compose.
+        const F two(2.f), one(1.f);
+        const F xx = qx * qx * two, yy = qy * qy * two, zz = qz * qz * two;
+        const F xy = qx * qy * two, xz = qx * qz * two, yz = qy * qz * two;
+        const F xw = qx * qw * two, yw = qy * qw * two, zw = qz * qw * two;
+        rows[0] = (one - yy - zz) * sx;
+        rows[1] = (xy - zw) * sy;
+        rows[2] = (xz + yw) * sz;
+        rows[3] = tx;
+        rows[4] = (xy + zw) * sx;
+        rows[5] = (one - xx - zz) * sy;
+        rows[6] = (yz - xw) * sz;
+        rows[7] = ty;
+        rows[8] = (xz - yw) * sx;
+        rows[9] = (yz + xw) * sy;
+        rows[10] = (one - xx - yy) * sz;
+        rows[11] = tz;
+
+        // World box around the transformed local box (Arvo).
+        F c[3], e[3];
+        for (unsigned int r = 0; r < 3; r++) {
+            const F *row = rows + r * 4;
+            c[r] = row[0] * F(center.x) + row[1] * F(center.y) + row[2] * F(center.z) + row[3];
+            e[r] = Abs(row[0]) * F(extents.x) + Abs(row[1]) * F(extents.y) + Abs(row[2]) * F(extents.z);
+        }
+
+        // Outside when the box's nearest corner to a plane is behind it.
+        auto visible = Inside(frustum.planes[0], c, e);
+        for (unsigned int p = 1; p < 6; p++) {
+            visible = And(visible, Inside(frustum.planes[p], c, e));
+        }
+        return Bits(visible);
+    }
+
+    // Instances [begin, end) into 'staged' (12 floats each) and 'staged_indices', packed.
+    unsigned int Stage(const InstanceSoA &in, const unsigned int begin, const unsigned int end,
+                       const Vector3 &center, const Vector3 &extents, const Frustum &frustum,
+                       float *staged, unsigned int *staged_indices)
+    {
+        unsigned int n = 0;
+        unsigned int i = begin;
+#ifdef __SSE2__
+        for (; i + 4 <= end; i += 4) {
+            Sse::Float4 rows[12];
+            const int bits = Instance(in, i, center, extents, frustum, rows);
+            if (!bits) {
+                continue;
+            }
+
+            alignas(16) float lanes[12][4];
+            for (unsigned int r = 0; r < 12; r++) {
+                _mm_store_ps(lanes[r], rows[r].v);
+            }
+            // Write every lane at the packed position and advance past the visible ones.
+            for (unsigned int k = 0; k < 4; k++) {
+                float *out = staged + n * 12;
+                for (unsigned int r = 0; r < 12; r++) {
+                    out[r] = lanes[r][k];
+                }
+                staged_indices[n] = i + k;
+                n += (bits >> k) & 1;
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            if (Instance(in, i, center, extents, frustum, staged + n * 12)) {
+                staged_indices[n++] = i;
+            }
+        }
+        return n;
+    }
+
+    // Streams 'floats' floats, bypassing the cache when the destination allows it.
+    void Stream(float *dst, const float *src, const size_t floats)
+    {
+#ifdef __SSE2__
+        if (((size_t) dst & 15) == 0) {
+            for (size_t k = 0; k < floats; k += 4) {
+                _mm_stream_ps(dst + k, _mm_load_ps(src + k));
+            }
+            return;
+        }
+#endif
+        memcpy(dst, src, floats * sizeof(float));
+    }
+}
+
+unsigned int Instances::CullAndPack(const InstanceSoA &instances, const unsigned int count, const Aabb &local_bounds,
+                                    const Matrix4 &view_projection, void *dst, unsigned int *indices)
+{
+    const Frustum frustum(view_projection);
+    const Vector3 center = local_bounds.Center(), extents = local_bounds.Extents();
+    const unsigned int chunks = (count + chunk - 1) / chunk;
+
+    // Chunks are taken in order from 'next'; 'turn' is the chunk allowed to claim output
+    // next and 'total' the output claimed so far.
+    std::atomic<unsigned int> next(0), turn(0);
+    unsigned int total = 0;
+
+    const unsigned int workers = chunks < Parallel::ThreadCount() ? chunks : Parallel::ThreadCount();
+    Parallel::For(workers, 1, [&](unsigned int, unsigned int) {
+        alignas(16) float staged[chunk * 12];
+        unsigned int staged_indices[chunk];
+
+        for (unsigned int c = next++; c < chunks; c = next++) {
+            const unsigned int begin = c * chunk;
+            const unsigned int end = begin + chunk < count ? begin + chunk : count;
+            const unsigned int n = Stage(instances, begin, end, center, extents, frustum, staged, staged_indices);
+
+            // The previous chunk was taken earlier and is at most finishing; only claiming
+            // the span is ordered, the copies run concurrently.
+            while (turn.load(std::memory_order_acquire) != c) {
+                std::this_thread::yield();
+            }
+            const unsigned int offset = total;
+            total += n;
+            turn.store(c + 1, std::memory_order_release);
+
+            Stream((float *) dst + (size_t) offset * 12, staged, (size_t) n * 12);
+            if (indices) {
+                memcpy(indices + offset, staged_indices, n * sizeof(unsigned int));
+            }
+        }
+#ifdef __SSE2__
+        _mm_sfence();
+#endif
+    });
+    return total;
+}
@@ -0,0 +1,38 @@
+#ifndef __BCOSTA_INSTANCES__
+#define __BCOSTA_INSTANCES__
+
+#include "bounds.h"
+#include "soa.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    // Instance transforms as translation, rotation and scale streams.
+    struct InstanceSoA
+    {
+        Vector3SoA translation;
+        QuaternionSoA rotation;
+        Vector3SoA scale;
+    };
+
+    // Per-frame instance preparation in one pass: each instance's TRS is read once, turned
+    // into its world matrix, its bounds tested against the view frustum and, if visible,
+    // the matrix written straight to the upload buffer. No intermediate matrix or
+    // visibility arrays go through memory.
+    //
+    // Work is split in cache-sized chunks handed to the threads in order. A chunk stages its
+    // survivors locally, takes the next span of the output once the previous chunks have
+    // taken theirs and streams them out, so the packed output keeps instance order.
+    namespace Instances
+    {
+        // Writes the visible instances as GpuPack::WriteAffine3x4 does (48 bytes each) and
+        // their indices to 'indices' (may be null); both need room for every instance.
+        // 'local_bounds' is the box shared by all instances (the mesh bounds) and
+        // 'view_projection' maps world space to clip space, -w <= x, y, z <= w. Returns how
+        // many instances are visible.
+        unsigned int CullAndPack(const InstanceSoA &instances, const unsigned int count, const Aabb &local_bounds,
+                                 const Matrix4 &view_projection, void *dst, unsigned int *indices);
+    }
+}
+#endif // __BCOSTA_INSTANCES__
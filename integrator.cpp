@@ -0,0 +1,164 @@
+#include "integrator.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include "quaternion.h"
+#include "vector.h"
+
+using namespace BCosta;
+
+// Elements per thread range; steps are a handful of flops per element.
+static const unsigned int grain = 16384;
+
+void Integrator::Resize(const unsigned int n)
+{
+    position.Resize(n);
+    previous.Resize(n);
+    velocity.Resize(n);
+    force.Resize(n);
+    angular_velocity.Resize(n);
+    orientation[0].resize(n, 0.f);
+    orientation[1].resize(n, 0.f);
+    orientation[2].resize(n, 0.f);
+    orientation[3].resize(n, 1.f);
+    inverse_mass.resize(n, 1.f);
+    count = n;
+}
+
+void Integrator::Reserve(const unsigned int n)
+{
+    position.Reserve(n);
+    previous.Reserve(n);
+    velocity.Reserve(n);
+    force.Reserve(n);
+    angular_velocity.Reserve(n);
+    for (unsigned int i = 0; i < 4; i++) {
+        orientation[i].reserve(n);
+    }
+    inverse_mass.reserve(n);
+}
+
+unsigned int Integrator::Add(const Vector3 &p, const Vector3 &v, const float inv_mass, const Quaternion &q,
+                             const Vector3 &w)
+{
+    const unsigned int i = count;
+    Resize(count + 1);
+    position.View().Set(i, p);
+    previous.View().Set(i, p);
+    velocity.View().Set(i, v);
+    angular_velocity.View().Set(i, w);
+    Orientations().Set(i, q);
+    inverse_mass[i] = inv_mass;
+    return i;
+}
+
+void Integrator::StepEuler(const float dt, const Vector3 &gravity, const float damping)
+{
+    const Vector3SoA p = position.View(), v = velocity.View(), f = force.View();
+    const float *inv_mass = inverse_mass.data();
+    const float gx = gravity.x, gy = gravity.y, gz = gravity.z;
+    const float keep = 1.f - damping;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            // Static elements get no acceleration at all, gravity included.
+            const float im = inv_mass[i];
+            const float g = im > 0.f ? 1.f : 0.f;
+            const float vx = (v.x[i] + (gx * g + f.x[i] * im) * dt) * keep;
+            const float vy = (v.y[i] + (gy * g + f.y[i] * im) * dt) * keep;
+            const float vz = (v.z[i] + (gz * g + f.z[i] * im) * dt) * keep;
+            v.x[i] = vx;
+            v.y[i] = vy;
+            v.z[i] = vz;
+            p.x[i] += vx * dt;
+            p.y[i] += vy * dt;
+            p.z[i] += vz * dt;
+            f.x[i] = f.y[i] = f.z[i] = 0.f;
+        }
+    });
+}
+
+void Integrator::StepVerlet(const float dt, const Vector3 &gravity, const float damping)
+{
+    const Vector3SoA p = position.View(), prev = previous.View(), v = velocity.View(), f = force.View();
+    const float *inv_mass = inverse_mass.data();
+    const float gx = gravity.x, gy = gravity.y, gz = gravity.z;
+    const float keep = 1.f - damping;
+    const float dt2 = dt * dt;
+    const float inv_dt = 1.f / dt;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            const float im = inv_mass[i];
+            const float g = im > 0.f ? 1.f : 0.f;
+            const float x = p.x[i], y = p.y[i], z = p.z[i];
+            const float dx = (x - prev.x[i]) * keep * g + (gx * g + f.x[i] * im) * dt2;
+            const float dy = (y - prev.y[i]) * keep * g + (gy * g + f.y[i] * im) * dt2;
+            const float dz = (z - prev.z[i]) * keep * g + (gz * g + f.z[i] * im) * dt2;
+            prev.x[i] = x;
+            prev.y[i] = y;
+            prev.z[i] = z;
+            p.x[i] = x + dx;
+            p.y[i] = y + dy;
+            p.z[i] = z + dz;
+            v.x[i] = dx * inv_dt;
+            v.y[i] = dy * inv_dt;
+            v.z[i] = dz * inv_dt;
+            f.x[i] = f.y[i] = f.z[i] = 0.f;
+        }
+    });
+}
+
+void Integrator::SyncPrevious(const float dt)
+{
+    const Vector3SoA p = position.View(), prev = previous.View(), v = velocity.View();
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            prev.x[i] = p.x[i] - v.x[i] * dt;
+            prev.y[i] = p.y[i] - v.y[i] * dt;
+            prev.z[i] = p.z[i] - v.z[i] * dt;
+        }
+    });
+}
+
+void Integrator::IntegrateRotations(const float dt)
+{
+    const Vector3SoA w = angular_velocity.View();
+    float *qx = orientation[0].data(), *qy = orientation[1].data(), *qz = orientation[2].data(),
+        *qw = orientation[3].data();
+    const float h = dt * .5f;
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            const float x = qx[i], y = qy[i], z = qz[i], s = qw[i];
+            const float wx = w.x[i] * h, wy = w.y[i] * h, wz = w.z[i] * h;
+
+            // (w, 0) * q
+            const float nx = x + wx * s + wy * z - wz * y;
+            const float ny = y + wy * s + wz * x - wx * z;
+            const float nz = z + wz * s + wx * y - wy * x;
+            const float nw = s - wx * x - wy * y - wz * z;
+
+            // 1 / sqrt(n) ~ (3 - n) / 2 around n = 1.
+            const float k = 1.5f - .5f * (nx * nx + ny * ny + nz * nz + nw * nw);
+            qx[i] = nx * k;
+            qy[i] = ny * k;
+            qz[i] = nz * k;
+            qw[i] = nw * k;
+        }
+    });
+}
+
+void Integrator::WorldMatrices(Matrix4 *out) const
+{
+    const float *px = position.x.data(), *py = position.y.data(), *pz = position.z.data();
+    const float *qx = orientation[0].data(), *qy = orientation[1].data(), *qz = orientation[2].data(),
+        *qw = orientation[3].data();
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            out[i] = Matrix4::Compose(Vector3(px[i], py[i], pz[i]), Quaternion(qx[i], qy[i], qz[i], qw[i]),
+                                      Vector3(1.f, 1.f, 1.f));
+        }
+    });
+}
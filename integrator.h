@@ -0,0 +1,124 @@
+#ifndef __BCOSTA_INTEGRATOR__
+#define __BCOSTA_INTEGRATOR__
+
+#include <vector>
+#include "aligned.h"
+#include "soa.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    // Motion state of particles and rigid bodies, one aligned float stream per component.
+    // Steps are straight loops over the streams, split across threads with Parallel::For.
+    //
+    // Every element has position, velocity, inverse mass and a force accumulator that steps
+    // consume and clear. Rigid bodies also use orientation and world-space angular velocity;
+    // particle-only users simply never call IntegrateRotations.
+    class Integrator
+    {
+    public:
+
+        Integrator()
+            : count(0)
+        { }
+
+        unsigned int Size() const
+        { return count; }
+
+        // New elements are at rest at the origin, unit mass, identity orientation.
+        void Resize(const unsigned int n);
+
+        void Reserve(const unsigned int n);
+
+        void Clear()
+        { Resize(0); }
+
+        // Append an element at rest in the Verlet sense (previous position = position).
+        unsigned int Add(const Vector3 &position, const Vector3 &velocity = Vector3::origin,
+                         const float inverse_mass = 1.f, const Quaternion &orientation = Quaternion(),
+                         const Vector3 &angular_velocity = Vector3::origin);
+
+        // Streams of Size() elements. Views are invalidated by Resize, Reserve and Add.
+        Vector3SoA Positions()
+        { return position.View(); }
+
+        Vector3SoA PreviousPositions()
+        { return previous.View(); }
+
+        Vector3SoA Velocities()
+        { return velocity.View(); }
+
+        Vector3SoA Forces()
+        { return force.View(); }
+
+        Vector3SoA AngularVelocities()
+        { return angular_velocity.View(); }
+
+        QuaternionSoA Orientations()
+        {
+            QuaternionSoA v = {orientation[0].data(), orientation[1].data(), orientation[2].data(),
+                               orientation[3].data()};
+            return v;
+        }
+
+        // 0 marks static elements, which neither gravity nor forces move.
+        float *InverseMasses()
+        { return inverse_mass.data(); }
+
+        // Semi-implicit Euler: v += (g + f / m) dt, v *= 1 - damping, p += v dt.
+        void StepEuler(const float dt, const Vector3 &gravity, const float damping = 0.f);
+
+        // Position Verlet: p' = p + (p - p_prev)(1 - damping) + (g + f / m) dt^2. Velocities
+        // are refreshed from the displacement so both steps can be mixed.
+        void StepVerlet(const float dt, const Vector3 &gravity, const float damping = 0.f);
+
+        // Restart Verlet from the current velocities: p_prev = p - v dt. Needed after
+        // velocities are written directly or when dt changes.
+        void SyncPrevious(const float dt);
+
+        // q += dt / 2 (w, 0) q, then one Newton step towards unit length in place of a square
+        // root and division. Keeps |q| within float precision of 1 as long as |w| dt stays
+        // well under a radian per step.
+        void IntegrateRotations(const float dt);
+
+        // out[i] = Matrix4::Compose(p, orientation, identity), as a batch.
+        void WorldMatrices(Matrix4 *out) const;
+
+    private:
+
+        typedef std::vector<float, AlignedAllocator<float> > Stream;
+
+        struct Stream3
+        {
+            Stream x, y, z;
+
+            Vector3SoA View()
+            {
+                Vector3SoA v = {x.data(), y.data(), z.data()};
+                return v;
+            }
+
+            void Resize(const unsigned int n)
+            {
+                x.resize(n, 0.f);
+                y.resize(n, 0.f);
+                z.resize(n, 0.f);
+            }
+
+            void Reserve(const unsigned int n)
+            {
+                x.reserve(n);
+                y.reserve(n);
+                z.reserve(n);
+            }
+        };
+
+        unsigned int count;
+
+        Stream3 position, previous, velocity, force, angular_velocity;
+        Stream orientation[4];
+        Stream inverse_mass;
+    };
+}
+#endif // __BCOSTA_INTEGRATOR__
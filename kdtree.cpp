@@ -0,0 +1,266 @@
+#include <algorithm>
+#include "kdtree.h"
+#include "parallel.h"
+
+using namespace BCosta;
+
+// Start of the point range of node 'j' (counted from the left of its level) at 'level',
+// for a tree over 'n' points. Ranges of a level partition [0, n) evenly, and the end of a
+// left child is where its parent splits.
+static unsigned int RangeStart(const unsigned int n, const unsigned int j, const unsigned int level)
+{ return (unsigned int) (((unsigned long long) n * j) >> level); }
+
+struct KdTree::Neighbors
+{
+    unsigned int k;
+    unsigned int found;
+    unsigned int *indices;
+    float *dist2;
+    float limit;
+
+    float Worst() const
+    { return found < k ? limit : dist2[k - 1]; }
+
+    void Insert(const float d2, const unsigned int id)
+    {
+        unsigned int i = found < k ? found++ : k - 1;
+        while (i > 0 && dist2[i - 1] > d2) {
+            dist2[i] = dist2[i - 1];
+            indices[i] = indices[i - 1];
+            i--;
+        }
+        dist2[i] = d2;
+        indices[i] = id;
+    }
+};
+
+void KdTree::Build(const Vector3 *points, const unsigned int _count, const unsigned int leaf_size)
+{
+    const unsigned int leaf = leaf_size < 1 ? 1 : (leaf_size > max_leaf_size ? max_leaf_size : leaf_size);
+
+    // Split while the largest range is over the leaf size and the smallest still has two
+    // points, so every internal node has two non-empty children.
+    count = _count;
+    depth = 0;
+    while (depth < 31 && ((count + (1ull << depth) - 1) >> depth) > leaf && (count >> depth) >= 2) {
+        depth++;
+    }
+
+    std::vector<unsigned int> order(count);
+    for (unsigned int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+
+    const unsigned int internal = (1u << depth) - 1;
+    split_values.resize(internal);
+    split_axes.resize(internal);
+
+    for (unsigned int level = 0; level < depth; level++) {
+        const unsigned int level_first = (1u << level) - 1;
+
+        Parallel::For(1u << level, 1, [&](unsigned int first, unsigned int end) {
+            for (unsigned int j = first; j < end; j++) {
+                const unsigned int b = RangeStart(count, j, level);
+                const unsigned int e = RangeStart(count, j + 1, level);
+                const unsigned int mid = RangeStart(count, 2 * j + 1, level + 1);
+
+                // Split along the widest axis of the range.
+                Vector3 lo(3.4e38f), hi(-3.4e38f);
+                for (unsigned int i = b; i < e; i++) {
+                    const Vector3 &p = points[order[i]];
+                    lo.Set(p.x < lo.x ? p.x : lo.x, p.y < lo.y ? p.y : lo.y, p.z < lo.z ? p.z : lo.z);
+                    hi.Set(p.x > hi.x ? p.x : hi.x, p.y > hi.y ? p.y : hi.y, p.z > hi.z ? p.z : hi.z);
+                }
+                const float ex = hi.x - lo.x, ey = hi.y - lo.y, ez = hi.z - lo.z;
+                const unsigned char axis = ex >= ey && ex >= ez ? 0 : (ey >= ez ? 1 : 2);
+
+                unsigned int *o = order.data();
+                std::nth_element(o + b, o + mid, o + e, [&](unsigned int l, unsigned int r) {
+                    return (&points[l].x)[axis] < (&points[r].x)[axis];
+                });
+
+                split_axes[level_first + j] = axis;
+                // An empty right half (not produced by the depth above) gets the range's upper
+                // bound, which still separates the points on the left.
+                split_values[level_first + j] = mid < e ? (&points[o[mid]].x)[axis] : (&hi.x)[axis];
+            }
+        });
+    }
+
+    xs.resize(count);
+    ys.resize(count);
+    zs.resize(count);
+    ids.swap(order);
+    for (unsigned int i = 0; i < count; i++) {
+        const Vector3 &p = points[ids[i]];
+        xs[i] = p.x;
+        ys[i] = p.y;
+        zs[i] = p.z;
+    }
+}
+
+void KdTree::Search(const float q[3], const unsigned int node, const unsigned int begin, const unsigned int end,
+                    const unsigned int level, Neighbors &best) const
+{
+    if (level == depth) {
+        // Leaf bucket: distances first in a flat loop, then the few candidate inserts.
+        float d2[max_leaf_size];
+        const unsigned int n = end - begin;
+        const float *x = &xs[begin], *y = &ys[begin], *z = &zs[begin];
+        for (unsigned int i = 0; i < n; i++) {
+            const float dx = x[i] - q[0], dy = y[i] - q[1], dz = z[i] - q[2];
+            d2[i] = dx * dx + dy * dy + dz * dz;
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            if (d2[i] < best.Worst()) {
+                best.Insert(d2[i], ids[begin + i]);
+            }
+        }
+        return;
+    }
+
+    const unsigned int j = node - ((1u << level) - 1);
+    const unsigned int mid = RangeStart(count, 2 * j + 1, level + 1);
+    const float diff = q[split_axes[node]] - split_values[node];
+
+    if (diff < 0.f) {
+        Search(q, 2 * node + 1, begin, mid, level + 1, best);
+        if (diff * diff < best.Worst()) {
+            Search(q, 2 * node + 2, mid, end, level + 1, best);
+        }
+    } else {
+        Search(q, 2 * node + 2, mid, end, level + 1, best);
+        if (diff * diff < best.Worst()) {
+            Search(q, 2 * node + 1, begin, mid, level + 1, best);
+        }
+    }
+}
+
+template<typename F>
+void KdTree::Within(const float q[3], const float r2, const unsigned int node, const unsigned int begin,
+                    const unsigned int end, const unsigned int level, F &visit) const
+{
+    if (level == depth) {
+        const unsigned int n = end - begin;
+        const float *x = &xs[begin], *y = &ys[begin], *z = &zs[begin];
+        for (unsigned int i = 0; i < n; i++) {
+            const float dx = x[i] - q[0], dy = y[i] - q[1], dz = z[i] - q[2];
+            if (dx * dx + dy * dy + dz * dz <= r2) {
+                visit(ids[begin + i]);
+            }
+        }
+        return;
+    }
+
+    const unsigned int j = node - ((1u << level) - 1);
+    const unsigned int mid = RangeStart(count, 2 * j + 1, level + 1);
+    const float diff = q[split_axes[node]] - split_values[node];
+
+    if (diff <= 0.f || diff * diff <= r2) {
+        Within(q, r2, 2 * node + 1, begin, mid, level + 1, visit);
+    }
+    if (diff >= 0.f || diff * diff <= r2) {
+        Within(q, r2, 2 * node + 2, mid, end, level + 1, visit);
+    }
+}
+
+unsigned int KdTree::Nearest(const Vector3 &query, const unsigned int k, unsigned int *indices, float *dist2,
+                             const float max_dist) const
+{
+    if (!k || !count) {
+        return 0;
+    }
+    Neighbors best = {k, 0, indices, dist2, max_dist * max_dist};
+    const float q[3] = {query.x, query.y, query.z};
+    Search(q, 0, 0, count, 0, best);
+    return best.found;
+}
+
+namespace
+{
+    struct AppendVisitor
+    {
+        std::vector<unsigned int> *out;
+
+        void operator ()(const unsigned int id)
+        { out->push_back(id); }
+    };
+
+    struct CountVisitor
+    {
+        unsigned int n;
+
+        void operator ()(const unsigned int)
+        { n++; }
+    };
+
+    struct FillVisitor
+    {
+        unsigned int *out;
+
+        void operator ()(const unsigned int id)
+        { *out++ = id; }
+    };
+}
+
+unsigned int KdTree::Radius(const Vector3 &query, const float radius, std::vector<unsigned int> &indices) const
+{
+    if (!count) {
+        return 0;
+    }
+    const size_t before = indices.size();
+    AppendVisitor visit = {&indices};
+    const float q[3] = {query.x, query.y, query.z};
+    Within(q, radius * radius, 0, 0, count, 0, visit);
+    return (unsigned int) (indices.size() - before);
+}
+
+void KdTree::NearestBatch(const Vector3 *queries, const unsigned int query_count, const unsigned int k,
+                          unsigned int *indices, float *dist2, unsigned int *found, const float max_dist) const
+{
+    Parallel::For(query_count, 256, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const unsigned int n = Nearest(queries[i], k, indices + (size_t) i * k, dist2 + (size_t) i * k, max_dist);
+            for (unsigned int m = n; m < k; m++) {
+                indices[(size_t) i * k + m] = 0xffffffff;
+                dist2[(size_t) i * k + m] = 3.4e38f;
+            }
+            if (found) {
+                found[i] = n;
+            }
+        }
+    });
+}
+
+void KdTree::RadiusBatch(const Vector3 *queries, const unsigned int query_count, const float radius,
+                         std::vector<unsigned int> &offsets, std::vector<unsigned int> &indices) const
+{
+    const float r2 = radius * radius;
+    offsets.assign(query_count + 1, 0);
+
+    // Count, scan, then fill each query's slice: no shared output, no locking.
+    Parallel::For(query_count, 256, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            CountVisitor visit = {0};
+            const float q[3] = {queries[i].x, queries[i].y, queries[i].z};
+            if (count) {
+                Within(q, r2, 0, 0, count, 0, visit);
+            }
+            offsets[i + 1] = visit.n;
+        }
+    });
+    for (unsigned int i = 0; i < query_count; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    indices.resize(offsets[query_count]);
+
+    Parallel::For(query_count, 256, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            FillVisitor visit = {indices.data() + offsets[i]};
+            const float q[3] = {queries[i].x, queries[i].y, queries[i].z};
+            if (count) {
+                Within(q, r2, 0, 0, count, 0, visit);
+            }
+        }
+    });
+}
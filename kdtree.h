@@ -0,0 +1,73 @@
+#ifndef __BCOSTA_KDTREE__
+#define __BCOSTA_KDTREE__
+
+#include <vector>
+#include "vector.h"
+
+namespace BCosta
+{
+    // Static k-d tree over a point set, for nearest-neighbor and radius queries.
+    //
+    // The tree is implicit: every node splits its point range at the median index, so node
+    // i has children 2i + 1 and 2i + 2 and point ranges follow from the depth alone. Only a
+    // split value and axis are stored per internal node. Points are copied in SoA leaf
+    // order, so a leaf bucket is scanned with one flat distance loop.
+    class KdTree
+    {
+    public:
+
+        static const unsigned int max_leaf_size = 64;
+
+        KdTree()
+            : count(0), depth(0)
+        { }
+
+        // Build over 'points' (copied). Levels are split in parallel. A leaf size of 1 may
+        // leave two points in some leaves: nodes are never split into an empty half.
+        void Build(const Vector3 *points, const unsigned int count, const unsigned int leaf_size = 16);
+
+        unsigned int Size() const
+        { return count; }
+
+        // The k nearest points within 'max_dist', sorted by increasing distance. Writes the
+        // original point indices and squared distances, and returns how many were found.
+        unsigned int Nearest(const Vector3 &query, const unsigned int k, unsigned int *indices, float *dist2,
+                             const float max_dist = 3.4e38f) const;
+
+        // Append the indices of every point within 'radius' of 'query' (unordered) and
+        // return how many were appended.
+        unsigned int Radius(const Vector3 &query, const float radius, std::vector<unsigned int> &indices) const;
+
+        // Nearest for each query, in parallel. Results of query i start at i * k; slots past
+        // the returned counts hold index 0xffffffff.
+        void NearestBatch(const Vector3 *queries, const unsigned int query_count, const unsigned int k,
+                          unsigned int *indices, float *dist2, unsigned int *found = 0,
+                          const float max_dist = 3.4e38f) const;
+
+        // Radius for each query, in parallel. Results of query i are
+        // indices[offsets[i], offsets[i + 1]).
+        void RadiusBatch(const Vector3 *queries, const unsigned int query_count, const float radius,
+                         std::vector<unsigned int> &offsets, std::vector<unsigned int> &indices) const;
+
+    private:
+
+        struct Neighbors;
+
+        void Search(const float q[3], const unsigned int node, const unsigned int begin, const unsigned int end,
+                    const unsigned int level, Neighbors &best) const;
+
+        template<typename F>
+        void Within(const float q[3], const float r2, const unsigned int node, const unsigned int begin,
+                    const unsigned int end, const unsigned int level, F &visit) const;
+
+        unsigned int count;
+        unsigned int depth;
+
+        std::vector<float> xs, ys, zs;
+        std::vector<unsigned int> ids;
+
+        std::vector<float> split_values;
+        std::vector<unsigned char> split_axes;
+    };
+}
+#endif // __BCOSTA_KDTREE__
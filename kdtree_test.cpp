@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "kdtree.h"
+
+using namespace BCosta;
+
+// Checks KdTree nearest and radius queries against brute force over small and large clouds,
+// for leaf sizes down to 1. Returns nonzero on failure.
+
+namespace
+{
+    unsigned int failures = 0;
+
+    void Check(const bool ok, const char *what, const unsigned int leaf, const unsigned int n)
+    {
+        if (!ok) {
+            if (failures < 20) {
+                printf("FAIL %s: leaf %u, %u points\n", what, leaf, n);
+            }
+            failures++;
+        }
+    }
+
+    float Distance2(const Vector3 &p, const Vector3 &q)
+    {
+        const float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    void CheckCloud(std::mt19937 &engine, const unsigned int n, const unsigned int leaf)
+    {
+        // Away from the origin, so a split value of 0 could not pass for a real one.
+        std::uniform_real_distribution<float> uniform(99.f, 101.f);
+        std::vector<Vector3> points(n);
+        for (unsigned int i = 0; i < n; i++) {
+            points[i].Set(uniform(engine), uniform(engine), uniform(engine));
+        }
+        KdTree tree;
+        tree.Build(points.data(), n, leaf);
+
+        const unsigned int k = 4;
+        const float radius = .5f;
+        for (unsigned int s = 0; s < 16; s++) {
+            const Vector3 q(uniform(engine), uniform(engine), uniform(engine));
+
+            std::vector<float> all(n);
+            std::vector<unsigned int> inside;
+            for (unsigned int i = 0; i < n; i++) {
+                all[i] = Distance2(points[i], q);
+                if (all[i] <= radius * radius) {
+                    inside.push_back(i);
+                }
+            }
+            std::sort(all.begin(), all.end());
+
+            // Distances rather than indices, so ties may come out in either order.
+            unsigned int indices[k];
+            float dist2[k];
+            const unsigned int found = tree.Nearest(q, k, indices, dist2);
+            bool ok = found == (n < k ? n : k);
+            for (unsigned int i = 0; ok && i < found; i++) {
+                ok = dist2[i] == all[i] && dist2[i] == Distance2(points[indices[i]], q);
+            }
+            Check(ok, "nearest", leaf, n);
+
+            std::vector<unsigned int> within;
+            tree.Radius(q, radius, within);
+            std::sort(within.begin(), within.end());
+            Check(within == inside, "radius", leaf, n);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 engine(7);
+    const unsigned int leaves[] = {1, 2, 4, 16};
+    for (unsigned int l = 0; l < 4; l++) {
+        for (unsigned int n = 1; n < 200; n++) {
+            CheckCloud(engine, n, leaves[l]);
+        }
+        CheckCloud(engine, 5000, leaves[l]);
+    }
+
+    if (failures) {
+        printf("%u failures\n", failures);
+        return 1;
+    }
+    printf("KdTree: all queries match brute force\n");
+    return 0;
+}
@@ -6,20 +6,7 @@ using namespace BCosta;
 using namespace BCosta::Math;
 
 void Matrix3::Multiply(Matrix3 *b)
-{
-    Matrix3 r(0, 0, 0, 0, 0, 0, 0, 0, 0);
-
-    for (int k = 0; k < 3; k++) {
-        for (int j = 0; j < 3; j++) {
-            for (int i = 0; i < 3; i++) {
-                r.m[3 * j + k] += m[3 * j + i] * b->m[3 * i + k];
-            }
-        }
-    }
-    for (int i = 0; i < 9; i++) {
-        m[i] = r.m[i];
-    }
-}
+{ *this = Mat3f::operator *(*b); }
 
 Matrix3 Matrix3::Translation(const float x, const float y)
 { return Matrix3(1, 0, 0, 0, 1, 0, x, y, 1); }
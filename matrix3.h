@@ -2,6 +2,7 @@
 #define __BCOSTA_MATRIX3__
 
 #include "math.h"
+#include "vec.h"
 
 namespace BCosta
 {
@@ -9,15 +10,18 @@ namespace BCosta
     class Vector3;
     class Matrix4;
 
-    class Matrix3
+    // Mat<float, 3, 3> under its historical interface.
+    class Matrix3 : public Mat3f
     {
     public:
 
-        float m[9];
-
         Matrix3()
         { }
 
+        Matrix3(const Mat3f &b)
+            : Mat3f(b)
+        { }
+
         Matrix3(
                 float m0, float m1, float m2,
                 float m3, float m4, float m5,
@@ -36,7 +40,7 @@ namespace BCosta
         }
 
         void LoadIdentity()
-        { Set(1, 0, 0, 0, 1, 0, 0, 0, 1); }
+        { *this = Identity(); }
 
         void Set(
                 float m0, float m1, float m2,
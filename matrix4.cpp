@@ -1,4 +1,5 @@
 #include "matrix4.h"
+#include "decompose.h"
 #include "matrix3.h"
 #include "quaternion.h"
 
@@ -8,7 +9,7 @@ using namespace BCosta::Math;
 Matrix4 Matrix4::static_identity(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
 
 void Matrix4::LoadIdentity()
-{ Set(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1); }
+{ *this = Identity(); }
 
 void Matrix4::Set(
     float m0, float m1, float m2, float m3,
@@ -36,30 +37,10 @@ void Matrix4::Set(
 }
 
 const Matrix4 Matrix4::Transpose() const
-{
-    return Matrix4(
-        m[0], m[4], m[8], m[12],
-        m[1], m[5], m[9], m[13],
-        m[2], m[6], m[10], m[14],
-        m[3], m[7], m[11], m[15]
-    );
-}
+{ return Transposed(); }
 
 void Matrix4::Multiply(Matrix4 *b)
-{
-    Matrix4 r(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
-
-    for (int k = 0; k < 4; k++) {
-        for (int j = 0; j < 4; j++) {
-            for (int i = 0; i < 4; i++) {
-                r.m[4 * j + k] += m[4 * j + i] * b->m[4 * i + k];
-            }
-        }
-    }
-    for (int i = 0; i < 16; i++) {
-        m[i] = r.m[i];
-    }
-}
+{ *this = Mat4f::operator *(*b); }
 
 Matrix4 Matrix4::Translation(const float x, const float y, const float z)
 {
@@ -141,6 +122,22 @@ Matrix4 Matrix4::Transform(const Vector3 &translation, const Vector3 &rotation,
     return Matrix4(t * r * s);
 }
 
+Matrix4 Matrix4::Compose(const Vector3 &t, const Quaternion &r, const Vector3 &s)
+{
+    float l[9];
+    r.ToRotationScale(s, l);
+
+    return Matrix4(
+        l[0], l[1], l[2], t.x,
+        l[3], l[4], l[5], t.y,
+        l[6], l[7], l[8], t.z,
+        0, 0, 0, 1
+    );
+}
+
+void Matrix4::Decompose(Vector3 &t, Quaternion &r, Vector3 &s) const
+{ Decompose::Trs(this, 1, &t, &r, &s); }
+
 float Matrix4::Determinant()
 {
     return (
@@ -157,6 +154,7 @@ float Matrix4::Determinant()
 
 Matrix4 Matrix4::Inverse()
 {
+    BCOSTA_PROFILE_SCOPE(Op_Matrix4Inverse);
     Matrix4 dst;
     float tmp[12];
     float src[16];
@@ -2,6 +2,8 @@
 #define __BCOSTA_MATRIX4__
 
 #include "math.h"
+#include "profile.h"
+#include "vec.h"
 #include "vector.h"
 
 namespace BCosta
@@ -9,17 +11,21 @@ namespace BCosta
     class Quaternion;
 
     // A normal matrix is the inverse transpose of the upper-left 3x3 portion of the model-view matrix.
-    class Matrix4
+    //
+    // Mat<float, 4, 4> under its historical interface; products run on the Vec kernels.
+    class Matrix4 : public Mat4f
     {
     public:
 
         static Matrix4 static_identity;
 
-        float m[16];
-
         Matrix4()
         { }
 
+        Matrix4(const Mat4f &b)
+            : Mat4f(b)
+        { }
+
         Matrix4(
             float m0, float m1, float m2, float m3,
             float m4, float m5, float m6, float m7,
@@ -30,32 +36,16 @@ namespace BCosta
             Set(m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14, m15);
         }
 
+        // The Mat products (const, and times a Vector4) stay available next to this one.
+        using Mat4f::operator *;
+
         void operator *=(const Matrix4 &b)
         { *this = *this * b; }
 
         Matrix4 operator *(const Matrix4 &b)
         {
-            return Matrix4(
-                m[0] * b.m[0] + m[1] * b.m[4] + m[2] * b.m[8] + m[3] * b.m[12],
-                m[0] * b.m[1] + m[1] * b.m[5] + m[2] * b.m[9] + m[3] * b.m[13],
-                m[0] * b.m[2] + m[1] * b.m[6] + m[2] * b.m[10] + m[3] * b.m[14],
-                m[0] * b.m[3] + m[1] * b.m[7] + m[2] * b.m[11] + m[3] * b.m[15],
-
-                m[4] * b.m[0] + m[5] * b.m[4] + m[6] * b.m[8] + m[7] * b.m[12],
-                m[4] * b.m[1] + m[5] * b.m[5] + m[6] * b.m[9] + m[7] * b.m[13],
-                m[4] * b.m[2] + m[5] * b.m[6] + m[6] * b.m[10] + m[7] * b.m[14],
-                m[4] * b.m[3] + m[5] * b.m[7] + m[6] * b.m[11] + m[7] * b.m[15],
-
-                m[8] * b.m[0] + m[9] * b.m[4] + m[10] * b.m[8] + m[11] * b.m[12],
-                m[8] * b.m[1] + m[9] * b.m[5] + m[10] * b.m[9] + m[11] * b.m[13],
-                m[8] * b.m[2] + m[9] * b.m[6] + m[10] * b.m[10] + m[11] * b.m[14],
-                m[8] * b.m[3] + m[9] * b.m[7] + m[10] * b.m[11] + m[11] * b.m[15],
-
-                m[12] * b.m[0] + m[13] * b.m[4] + m[14] * b.m[8] + m[15] * b.m[12],
-                m[12] * b.m[1] + m[13] * b.m[5] + m[14] * b.m[9] + m[15] * b.m[13],
-                m[12] * b.m[2] + m[13] * b.m[6] + m[14] * b.m[10] + m[15] * b.m[14],
-                m[12] * b.m[3] + m[13] * b.m[7] + m[14] * b.m[11] + m[15] * b.m[15]
-            );
+            BCOSTA_PROFILE_SCOPE(Op_Matrix4Multiply);
+            return Mat4f::operator *(b);
         }
 
         void LoadIdentity();
@@ -96,6 +86,12 @@ namespace BCosta
         static Matrix4 Transform(Quaternion &rotation, Vector3 &translation, float scale);
 
         static Matrix4 Transform(const Vector3 &translation, const Vector3 &rotation, const Vector3 &scale);
+
+        // Closed form of Translation(t) * rotation * Scale(s), without the two 4x4 products.
+        static Matrix4 Compose(const Vector3 &t, const Quaternion &r, const Vector3 &s);
+
+        // Inverse of Compose for affine transforms; see Decompose::Trs for the sheared case.
+        void Decompose(Vector3 &t, Quaternion &r, Vector3 &s) const;
     };
 }
 #endif // __BCOSTA_MATRIX4__
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include <math.h>
+#include "math.h"
+#include "mesh.h"
+#include "parallel.h"
+
+using namespace BCosta;
+using namespace BCosta::Mesh;
+
+// Triangles or vertices per parallel range.
+static const unsigned int grain = 4096;
+
+// Interior angles of the triangle (p0, p1, p2), in corner order.
+static void CornerAngles(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2, float angles[3])
+{
+    Vector3 e01 = Vector3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z).normalize();
+    Vector3 e02 = Vector3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z).normalize();
+    Vector3 e12 = Vector3(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z).normalize();
+
+    const float d0 = Vector3::Dot(e01, e02);
+    const float d1 = -Vector3::Dot(e01, e12);
+    angles[0] = acosf(d0 < -1.f ? -1.f : (d0 > 1.f ? 1.f : d0));
+    angles[1] = acosf(d1 < -1.f ? -1.f : (d1 > 1.f ? 1.f : d1));
+    angles[2] = Math::pi - angles[0] - angles[1];
+}
+
+// Component of 'a' orthogonal to unit 'n', normalized (zero if 'a' is parallel to 'n').
+static Vector3 Orthogonalize(const Vector3 &a, const Vector3 &n)
+{
+    const float d = Vector3::Dot(a, n);
+    Vector3 r(a.x - n.x * d, a.y - n.y * d, a.z - n.z * d);
+    return r.normalize();
+}
+
+void TangentSpaceBuilder::SetTopology(const unsigned int *_indices, const unsigned int _triangle_count,
+                                      const unsigned int _vertex_count)
+{
+    indices = _indices;
+    triangle_count = _triangle_count;
+    vertex_count = _vertex_count;
+
+    const unsigned int corner_count = triangle_count * 3;
+
+    // Counting sort of corners by vertex.
+    offsets.assign(vertex_count + 1, 0);
+    for (unsigned int c = 0; c < corner_count; c++) {
+        offsets[indices[c] + 1]++;
+    }
+    for (unsigned int i = 0; i < vertex_count; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    corners.resize(corner_count);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (unsigned int c = 0; c < corner_count; c++) {
+        corners[fill[indices[c]]++] = c;
+    }
+
+    face_x.resize(triangle_count);
+    face_y.resize(triangle_count);
+    face_z.resize(triangle_count);
+    face_bx.resize(triangle_count);
+    face_by.resize(triangle_count);
+    face_bz.resize(triangle_count);
+    corner_weights.resize(corner_count);
+}
+
+void TangentSpaceBuilder::FaceNormals(const Vector3SoA &positions, const NormalWeighting weighting,
+                                      const unsigned int first, const unsigned int end)
+{
+    for (unsigned int t = first; t < end; t++) {
+        const Vector3 p0 = positions.Get(indices[t * 3]);
+        const Vector3 p1 = positions.Get(indices[t * 3 + 1]);
+        const Vector3 p2 = positions.Get(indices[t * 3 + 2]);
+
+        // Length of the cross product is twice the triangle area.
+        Vector3 n;
+        Vector3::Cross(n, Vector3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z), Vector3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z));
+
+        if (weighting == Weight_Angle) {
+            n.normalize();
+            CornerAngles(p0, p1, p2, &corner_weights[t * 3]);
+        } else {
+            corner_weights[t * 3] = corner_weights[t * 3 + 1] = corner_weights[t * 3 + 2] = 1.f;
+        }
+        face_x[t] = n.x;
+        face_y[t] = n.y;
+        face_z[t] = n.z;
+    }
+}
+
+void TangentSpaceBuilder::ComputeNormals(const Vector3SoA &positions, const Vector3SoA &normals,
+                                         const NormalWeighting weighting)
+{
+    Parallel::For(triangle_count, grain, [&](unsigned int first, unsigned int end) {
+        FaceNormals(positions, weighting, first, end);
+    });
+
+    Parallel::For(vertex_count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            float x = 0.f, y = 0.f, z = 0.f;
+            for (unsigned int k = offsets[i]; k < offsets[i + 1]; k++) {
+                const unsigned int c = corners[k];
+                const unsigned int t = c / 3;
+                const float w = corner_weights[c];
+                x += face_x[t] * w;
+                y += face_y[t] * w;
+                z += face_z[t] * w;
+            }
+            Vector3 n(x, y, z);
+            normals.Set(i, n.normalize());
+        }
+    });
+}
+
+void TangentSpaceBuilder::FaceTangents(const Vector3SoA &positions, const float *u, const float *v,
+                                       const unsigned int first, const unsigned int end)
+{
+    for (unsigned int t = first; t < end; t++) {
+        const unsigned int i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+        const Vector3 p0 = positions.Get(i0);
+        const Vector3 p1 = positions.Get(i1);
+        const Vector3 p2 = positions.Get(i2);
+
+        const float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+        const float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+        const float du1 = u[i1] - u[i0], dv1 = v[i1] - v[i0];
+        const float du2 = u[i2] - u[i0], dv2 = v[i2] - v[i0];
+
+        // Solve [e1 e2] = [T B] * [du1 du2; dv1 dv2]. The determinant sign carries the UV
+        // orientation, so it is kept rather than normalized away.
+        const float det = du1 * dv2 - du2 * dv1;
+        const float r = fabsf(det) > 1e-20f ? 1.f / det : 0.f;
+
+        face_x[t] = (e1x * dv2 - e2x * dv1) * r;
+        face_y[t] = (e1y * dv2 - e2y * dv1) * r;
+        face_z[t] = (e1z * dv2 - e2z * dv1) * r;
+        face_bx[t] = (e2x * du1 - e1x * du2) * r;
+        face_by[t] = (e2y * du1 - e1y * du2) * r;
+        face_bz[t] = (e2z * du1 - e1z * du2) * r;
+
+        CornerAngles(p0, p1, p2, &corner_weights[t * 3]);
+    }
+}
+
+void TangentSpaceBuilder::ComputeTangents(const Vector3SoA &positions, const float *u, const float *v,
+                                          const Vector3SoA &normals, const Vector3SoA &tangents, float *signs)
+{
+    Parallel::For(triangle_count, grain, [&](unsigned int first, unsigned int end) {
+        FaceTangents(positions, u, v, first, end);
+    });
+
+    Parallel::For(vertex_count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Vector3 n = normals.Get(i);
+            Vector3 tangent, bitangent;
+
+            for (unsigned int k = offsets[i]; k < offsets[i + 1]; k++) {
+                const unsigned int c = corners[k];
+                const unsigned int t = c / 3;
+                const float w = corner_weights[c];
+                tangent += Orthogonalize(Vector3(face_x[t], face_y[t], face_z[t]), n) * w;
+                bitangent += Orthogonalize(Vector3(face_bx[t], face_by[t], face_bz[t]), n) * w;
+            }
+
+            tangent = Orthogonalize(tangent, n);
+            if (tangent.Len2() == 0.f) {
+                // No usable UV gradient: any unit vector orthogonal to the normal.
+                tangent = Orthogonalize(fabsf(n.x) < 0.9f ? Vector3(1.f, 0.f, 0.f) : Vector3(0.f, 1.f, 0.f), n);
+            }
+            tangents.Set(i, tangent);
+
+            Vector3 nxt;
+            Vector3::Cross(nxt, n, tangent);
+            signs[i] = Vector3::Dot(nxt, bitangent) < 0.f ? -1.f : 1.f;
+        }
+    });
+}
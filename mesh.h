@@ -0,0 +1,75 @@
+#ifndef __BCOSTA_MESH__
+#define __BCOSTA_MESH__
+
+#include <vector>
+#include "soa.h"
+
+namespace BCosta
+{
+    namespace Mesh
+    {
+        enum NormalWeighting
+        {
+            Weight_Area = 0,
+            Weight_Angle
+        };
+    }
+
+    // Per-vertex normals and tangent frames for indexed triangle meshes, rebuilt every frame
+    // for deforming geometry.
+    //
+    // Instead of scattering face contributions into vertices (which conflicts as soon as two
+    // threads touch triangles sharing a vertex), work is done in two passes:
+    // - a face pass over triangle ranges writing per-face data only,
+    // - a vertex pass over vertex ranges, each vertex gathering from its incident corners
+    //   through a vertex -> corner adjacency built once per topology.
+    // Both passes write disjoint ranges and run on Parallel::For.
+    class TangentSpaceBuilder
+    {
+    public:
+
+        TangentSpaceBuilder()
+            : indices(0), triangle_count(0), vertex_count(0)
+        { }
+
+        // Build the adjacency. 'indices' (3 per triangle) must stay alive and unchanged
+        // while the builder is used.
+        void SetTopology(const unsigned int *indices, const unsigned int triangle_count, const unsigned int vertex_count);
+
+        // Unit normals, each face contributing its area (Weight_Area) or the angle of the
+        // incident corner (Weight_Angle). Vertices without faces get a zero normal.
+        void ComputeNormals(const Vector3SoA &positions, const Vector3SoA &normals,
+                            const Mesh::NormalWeighting weighting = Mesh::Weight_Angle);
+
+        // Unit tangents orthogonal to 'normals' and bitangent signs, following the
+        // MikkTSpace conventions: per-face tangents/bitangents from the UV gradients,
+        // projected on each vertex normal plane and averaged with corner-angle weights;
+        // bitangent = sign * cross(normal, tangent).
+        // Vertices are not split on tangent discontinuities, so results match MikkTSpace
+        // on meshes whose vertices are already split along UV seams and mirrored UVs.
+        void ComputeTangents(const Vector3SoA &positions, const float *u, const float *v,
+                             const Vector3SoA &normals, const Vector3SoA &tangents, float *signs);
+
+    private:
+
+        void FaceNormals(const Vector3SoA &positions, const Mesh::NormalWeighting weighting,
+                         const unsigned int first, const unsigned int end);
+
+        void FaceTangents(const Vector3SoA &positions, const float *u, const float *v,
+                          const unsigned int first, const unsigned int end);
+
+        const unsigned int *indices;
+        unsigned int triangle_count;
+        unsigned int vertex_count;
+
+        // Vertex i owns corners[offsets[i], offsets[i + 1]); a corner is triangle * 3 + k.
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> corners;
+
+        // Per-face vectors and per-corner weights, SoA.
+        std::vector<float> face_x, face_y, face_z;
+        std::vector<float> face_bx, face_by, face_bz;
+        std::vector<float> corner_weights;
+    };
+}
+#endif // __BCOSTA_MESH__
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <math.h>
+#include "matrix4.h"
+#include "occlusion.h"
+#include "parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace BCosta;
+
+// Binning tile size in pixels; both are multiples of the 8x8 depth blocks.
+static const unsigned int tile_width = 64;
+static const unsigned int tile_height = 32;
+
+static const unsigned int block_size = 8;
+
+static const unsigned int vertex_grain = 4096;
+static const unsigned int triangle_grain = 1024;
+static const unsigned int box_grain = 256;
+
+namespace
+{
+    // Homogeneous transform of a point.
+    Vector4 ToClip(const Mat4f &m, const Vector3 &p)
+    { return m * Vector4(p.x, p.y, p.z, 1.f); }
+
+    // Mesh holding element 'i', given the running element offsets of the meshes.
+    unsigned int MeshOf(const std::vector<unsigned int> &offsets, const unsigned int i)
+    { return (unsigned int) (std::upper_bound(offsets.begin(), offsets.end(), i) - offsets.begin()) - 1; }
+
+    // Signed distance to the near plane, z = -w.
+    float NearDistance(const float *v)
+    { return v[2] + v[3]; }
+
+    // Clip a triangle against the near plane; returns the vertex count of the result (0, 3
+    // or 4), written to 'out' in order.
+    unsigned int ClipNear(const float *v[3], float out[4][4])
+    {
+        unsigned int n = 0;
+        for (unsigned int i = 0; i < 3; i++) {
+            const float *a = v[i], *b = v[(i + 1) % 3];
+            const float da = NearDistance(a), db = NearDistance(b);
+            if (da >= 0.f) {
+                for (unsigned int k = 0; k < 4; k++) {
+                    out[n][k] = a[k];
+                }
+                n++;
+            }
+            if ((da >= 0.f) != (db >= 0.f)) {
+                const float t = da / (da - db);
+                for (unsigned int k = 0; k < 4; k++) {
+                    out[n][k] = a[k] + (b[k] - a[k]) * t;
+                }
+                n++;
+            }
+        }
+        return n;
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer(const unsigned int _width, const unsigned int _height)
+    : width(0), height(0)
+{
+    Resize(_width, _height);
+}
+
+void OcclusionBuffer::Resize(const unsigned int _width, const unsigned int _height)
+{
+    width = (_width + block_size - 1) / block_size * block_size;
+    height = (_height + block_size - 1) / block_size * block_size;
+
+    const unsigned int tiles = ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+    bins.resize(tiles);
+
+    depth.resize(width * height);
+    blocks.resize((width / block_size) * (height / block_size));
+    Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+    std::fill(depth.begin(), depth.end(), 1.f);
+    std::fill(blocks.begin(), blocks.end(), 1.f);
+}
+
+bool OcclusionBuffer::SetupTriangle(const float *v0, const float *v1, const float *v2, Triangle &t) const
+{
+    // Counter-clockwise in screen space, so the edge functions are positive inside.
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+    if (area < 0.f) {
+        const float *swap = v1;
+        v1 = v2;
+        v2 = swap;
+        area = -area;
+    }
+    if (!(area > 1e-8f)) {
+        return false;
+    }
+
+    const float min_x = fminf(v0[0], fminf(v1[0], v2[0])), max_x = fmaxf(v0[0], fmaxf(v1[0], v2[0]));
+    const float min_y = fminf(v0[1], fminf(v1[1], v2[1])), max_y = fmaxf(v0[1], fmaxf(v1[1], v2[1]));
+    t.min_x = (int) fmaxf(floorf(min_x), 0.f);
+    t.min_y = (int) fmaxf(floorf(min_y), 0.f);
+    t.max_x = (int) fminf(ceilf(max_x), (float) width);
+    t.max_y = (int) fminf(ceilf(max_y), (float) height);
+    if (t.min_x >= t.max_x || t.min_y >= t.max_y) {
+        return false;
+    }
+
+    // Edges shared by two triangles get exactly opposite functions (the constant is taken
+    // at the same end either way), so with inclusive tests no pixel falls between them.
+    const float *v[3] = {v0, v1, v2};
+    for (unsigned int i = 0; i < 3; i++) {
+        const float *a = v[i], *b = v[(i + 1) % 3];
+        const float *base = a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]) ? a : b;
+        t.a[i] = a[1] - b[1];
+        t.b[i] = b[0] - a[0];
+        t.c[i] = -(t.a[i] * base[0] + t.b[i] * base[1]);
+    }
+
+    const float dx1 = v1[0] - v0[0], dy1 = v1[1] - v0[1], dz1 = v1[2] - v0[2];
+    const float dx2 = v2[0] - v0[0], dy2 = v2[1] - v0[1], dz2 = v2[2] - v0[2];
+    t.zx = (dz1 * dy2 - dz2 * dy1) / area;
+    t.zy = (dz2 * dx1 - dz1 * dx2) / area;
+    t.z0 = v0[2] - t.zx * v0[0] - t.zy * v0[1];
+    return true;
+}
+
+void OcclusionBuffer::Rasterize(const Vector3 *vertices, const unsigned int vertex_count,
+                                const unsigned int *indices, const unsigned int triangle_count,
+                                const Matrix4 &view_projection)
+{
+    const OccluderMesh mesh = {vertices, vertex_count, indices, triangle_count, &view_projection};
+    Rasterize(&mesh, 1);
+}
+
+void OcclusionBuffer::Rasterize(const OccluderMesh *meshes, const unsigned int mesh_count)
+{
+    // Vertices and triangles of all meshes are numbered in one sequence each.
+    vertex_offsets.resize(mesh_count + 1);
+    triangle_offsets.resize(mesh_count + 1);
+    vertex_offsets[0] = triangle_offsets[0] = 0;
+    for (unsigned int i = 0; i < mesh_count; i++) {
+        vertex_offsets[i + 1] = vertex_offsets[i] + meshes[i].vertex_count;
+        triangle_offsets[i + 1] = triangle_offsets[i] + meshes[i].triangle_count;
+    }
+    const unsigned int vertex_count = vertex_offsets[mesh_count];
+    const unsigned int triangle_count = triangle_offsets[mesh_count];
+
+    clip.resize(vertex_count);
+    Parallel::For(vertex_count, vertex_grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int mesh = MeshOf(vertex_offsets, begin);
+        for (unsigned int i = begin; i < end; i++) {
+            while (i >= vertex_offsets[mesh + 1]) {
+                mesh++;
+            }
+            clip[i] = ToClip(*meshes[mesh].transform, meshes[mesh].vertices[i - vertex_offsets[mesh]]);
+        }
+    });
+
+    // Clip, project and set up; a triangle cut by the near plane becomes up to two.
+    triangles.resize((size_t) triangle_count * 2);
+    triangle_counts.resize(triangle_count);
+    const float sx = .5f * width, sy = .5f * height;
+
+    Parallel::For(triangle_count, triangle_grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int mesh = MeshOf(triangle_offsets, begin);
+        for (unsigned int i = begin; i < end; i++) {
+            while (i >= triangle_offsets[mesh + 1]) {
+                mesh++;
+            }
+            const unsigned int *index = meshes[mesh].indices + (size_t) (i - triangle_offsets[mesh]) * 3;
+            const Vector4 *base = &clip[vertex_offsets[mesh]];
+            const float *v[3] = {base[index[0]].Data(), base[index[1]].Data(), base[index[2]].Data()};
+            float polygon[4][4];
+            const unsigned int n = ClipNear(v, polygon);
+
+            float screen[4][3];
+            for (unsigned int k = 0; k < n; k++) {
+                const float w = 1.f / polygon[k][3];
+                screen[k][0] = (polygon[k][0] * w + 1.f) * sx;
+                screen[k][1] = (polygon[k][1] * w + 1.f) * sy;
+                screen[k][2] = fminf((polygon[k][2] * w + 1.f) * .5f, 1.f);
+            }
+
+            unsigned int count = 0;
+            for (unsigned int k = 2; k < n; k++) {
+                count += SetupTriangle(screen[0], screen[k - 1], screen[k], triangles[i * 2 + count]);
+            }
+            triangle_counts[i] = (unsigned char) count;
+        }
+    });
+
+    const unsigned int tiles_x = (width + tile_width - 1) / tile_width;
+    for (size_t b = 0; b < bins.size(); b++) {
+        bins[b].clear();
+    }
+    for (unsigned int i = 0; i < triangle_count; i++) {
+        for (unsigned int k = 0; k < triangle_counts[i]; k++) {
+            const Triangle &t = triangles[i * 2 + k];
+            for (unsigned int ty = t.min_y / tile_height; ty <= (t.max_y - 1) / tile_height; ty++) {
+                for (unsigned int tx = t.min_x / tile_width; tx <= (t.max_x - 1) / tile_width; tx++) {
+                    bins[ty * tiles_x + tx].push_back(i * 2 + k);
+                }
+            }
+        }
+    }
+
+    active_tiles.clear();
+    for (unsigned int tile = 0; tile < bins.size(); tile++) {
+        if (!bins[tile].empty()) {
+            active_tiles.push_back(tile);
+        }
+    }
+
+    // Tiles are disjoint, so each range of them is rasterized without locking.
+    Parallel::For((unsigned int) active_tiles.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            RasterizeTile(active_tiles[i]);
+        }
+    });
+}
+
+void OcclusionBuffer::RasterizeTile(const unsigned int tile)
+{
+    const unsigned int tiles_x = (width + tile_width - 1) / tile_width;
+    const int x0 = (int) ((tile % tiles_x) * tile_width), y0 = (int) ((tile / tiles_x) * tile_height);
+    const int x1 = x0 + (int) tile_width < (int) width ? x0 + (int) tile_width : (int) width;
+    const int y1 = y0 + (int) tile_height < (int) height ? y0 + (int) tile_height : (int) height;
+
+    // Pixels the triangles may have changed.
+    int touched_x0 = x1, touched_y0 = y1, touched_x1 = x0, touched_y1 = y0;
+
+    const std::vector<unsigned int> &bin = bins[tile];
+    for (size_t i = 0; i < bin.size(); i++) {
+        const Triangle &t = triangles[bin[i]];
+
+        // Spans start and end on 4-pixel boundaries; the extra pixels are still inside the
+        // tile and fail the edge tests unless covered.
+        const int min_x = (t.min_x > x0 ? t.min_x : x0) & ~3;
+        const int max_x = ((t.max_x < x1 ? t.max_x : x1) + 3) & ~3;
+        const int min_y = t.min_y > y0 ? t.min_y : y0;
+        const int max_y = t.max_y < y1 ? t.max_y : y1;
+        touched_x0 = min_x < touched_x0 ? min_x : touched_x0;
+        touched_y0 = min_y < touched_y0 ? min_y : touched_y0;
+        touched_x1 = max_x > touched_x1 ? max_x : touched_x1;
+        touched_y1 = max_y > touched_y1 ? max_y : touched_y1;
+
+        for (int y = min_y; y < max_y; y++) {
+            const float cy = y + .5f;
+            float *row = &depth[(size_t) y * width];
+            const float r0 = t.b[0] * cy + t.c[0], r1 = t.b[1] * cy + t.c[1], r2 = t.b[2] * cy + t.c[2];
+            const float rz = t.zy * cy + t.z0;
+#ifdef __SSE2__
+            const __m128 a0 = _mm_set1_ps(t.a[0]), a1 = _mm_set1_ps(t.a[1]), a2 = _mm_set1_ps(t.a[2]);
+            const __m128 e0 = _mm_set1_ps(r0), e1 = _mm_set1_ps(r1), e2 = _mm_set1_ps(r2);
+            const __m128 zx = _mm_set1_ps(t.zx), ez = _mm_set1_ps(rz), zero = _mm_setzero_ps();
+            __m128 cx = _mm_add_ps(_mm_set1_ps(min_x + .5f), _mm_set_ps(3.f, 2.f, 1.f, 0.f));
+            for (int x = min_x; x < max_x; x += 4) {
+                const __m128 inside = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, cx), e0), zero),
+                               _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, cx), e1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, cx), e2), zero));
+                const __m128 old = _mm_load_ps(row + x);
+                const __m128 nearer = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(zx, cx), ez));
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+                cx = _mm_add_ps(cx, _mm_set1_ps(4.f));
+            }
+#else
+            for (int x = min_x; x < max_x; x++) {
+                const float cx = x + .5f;
+                if (t.a[0] * cx + r0 >= 0.f && t.a[1] * cx + r1 >= 0.f && t.a[2] * cx + r2 >= 0.f) {
+                    row[x] = fminf(row[x], t.zx * cx + rz);
+                }
+            }
+#endif
+        }
+    }
+
+    // Farthest depth of each block the triangles touched.
+    const unsigned int blocks_x = width / block_size;
+    const int block_mask = ~((int) block_size - 1);
+    for (int by = touched_y0 & block_mask; by < touched_y1; by += block_size) {
+        for (int bx = touched_x0 & block_mask; bx < touched_x1; bx += block_size) {
+            float farthest = 0.f;
+            for (unsigned int y = 0; y < block_size; y++) {
+                const float *row = &depth[(size_t) (by + y) * width + bx];
+                for (unsigned int x = 0; x < block_size; x++) {
+                    farthest = fmaxf(farthest, row[x]);
+                }
+            }
+            blocks[(by / block_size) * blocks_x + bx / block_size] = farthest;
+        }
+    }
+}
+
+bool OcclusionBuffer::IsOccluded(const Aabb &box, const Matrix4 &view_projection) const
+{
+    const Mat4f &m = view_projection;
+
+    float min_x = (float) width, min_y = (float) height, max_x = 0.f, max_y = 0.f, nearest = 1.f;
+    for (unsigned int i = 0; i < 8; i++) {
+        const Vector3 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y,
+                             i & 4 ? box.max.z : box.min.z);
+        const Vector4 clipped = ToClip(m, corner);
+        const float *v = clipped.Data();
+        if (NearDistance(v) <= 0.f) {
+            return false;
+        }
+
+        const float w = 1.f / v[3];
+        const float x = (v[0] * w + 1.f) * .5f * width, y = (v[1] * w + 1.f) * .5f * height;
+        min_x = fminf(min_x, x);
+        max_x = fmaxf(max_x, x);
+        min_y = fminf(min_y, y);
+        max_y = fmaxf(max_y, y);
+        nearest = fminf(nearest, (v[2] * w + 1.f) * .5f);
+    }
+
+    // Every pixel the box's screen rectangle touches.
+    const int px0 = (int) fmaxf(floorf(min_x), 0.f), py0 = (int) fmaxf(floorf(min_y), 0.f);
+    const int px1 = (int) fminf(ceilf(max_x), (float) width), py1 = (int) fminf(ceilf(max_y), (float) height);
+    if (px0 >= px1 || py0 >= py1) {
+        return false;
+    }
+
+    // A block whose farthest occluder is nearer than the box hides its part of the box;
+    // the others are checked pixel by pixel.
+    const unsigned int blocks_x = width / block_size;
+    for (int by = py0 / (int) block_size; by <= (py1 - 1) / (int) block_size; by++) {
+        for (int bx = px0 / (int) block_size; bx <= (px1 - 1) / (int) block_size; bx++) {
+            if (nearest > blocks[by * blocks_x + bx]) {
+                continue;
+            }
+
+            const int x0 = bx * (int) block_size > px0 ? bx * (int) block_size : px0;
+            const int y0 = by * (int) block_size > py0 ? by * (int) block_size : py0;
+            const int x1 = (bx + 1) * (int) block_size < px1 ? (bx + 1) * (int) block_size : px1;
+            const int y1 = (by + 1) * (int) block_size < py1 ? (by + 1) * (int) block_size : py1;
+            for (int y = y0; y < y1; y++) {
+                const float *row = &depth[(size_t) y * width];
+                for (int x = x0; x < x1; x++) {
+                    if (!(nearest > row[x])) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionBuffer::TestAabbs(const Aabb *boxes, const unsigned int count, const Matrix4 &view_projection,
+                                unsigned char *occluded) const
+{
+    Parallel::For(count, box_grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            occluded[i] = IsOccluded(boxes[i], view_projection);
+        }
+    });
+}
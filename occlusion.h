@@ -0,0 +1,106 @@
+#ifndef __BCOSTA_OCCLUSION__
+#define __BCOSTA_OCCLUSION__
+
+#include <vector>
+#include "aligned.h"
+#include "bounds.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Occluder triangles as index triples into 'vertices'; 'transform' takes the vertices to
+    // clip space, usually the view-projection times the mesh's model matrix.
+    struct OccluderMesh
+    {
+        const Vector3 *vertices;
+        unsigned int vertex_count;
+        const unsigned int *indices;
+        unsigned int triangle_count;
+        const Matrix4 *transform;
+    };
+
+    // Low-resolution software depth buffer for CPU occlusion culling.
+    //
+    // Occluder triangles are transformed by a view-projection matrix (Math::persp and
+    // Math::lookAt conventions, depth in [-1, 1]), clipped against the near plane and binned
+    // into screen tiles; tiles are then rasterized in parallel, four pixels at a time on
+    // SSE2, keeping the nearest depth. Each 8x8 pixel block also keeps its farthest depth,
+    // so box queries reject most blocks without touching pixels. Only tiles with triangles
+    // are visited.
+    //
+    // Typical frame: Clear, one Rasterize with every occluder mesh, then TestAabbs. Each
+    // Rasterize call pays the setup, binning and thread start once, so batching meshes is
+    // much cheaper than one call per mesh.
+    class OcclusionBuffer
+    {
+    public:
+
+        // Sizes are rounded up to multiples of 8.
+        OcclusionBuffer(const unsigned int _width = 256, const unsigned int _height = 128);
+
+        void Resize(const unsigned int _width, const unsigned int _height);
+
+        // Reset every pixel to the far plane.
+        void Clear();
+
+        // Triangles given as index triples into 'vertices'. view_projection may include the
+        // occluder's model transform. Winding does not matter.
+        void Rasterize(const Vector3 *vertices, const unsigned int vertex_count, const unsigned int *indices,
+                       const unsigned int triangle_count, const Matrix4 &view_projection);
+
+        void Rasterize(const OccluderMesh *meshes, const unsigned int mesh_count);
+
+        // True when the box is certainly hidden behind rasterized occluders. Boxes crossing
+        // the near plane or outside the screen are reported as not occluded; frustum culling
+        // is a separate test.
+        bool IsOccluded(const Aabb &box, const Matrix4 &view_projection) const;
+
+        // occluded[i] = IsOccluded(boxes[i]), boxes split across threads.
+        void TestAabbs(const Aabb *boxes, const unsigned int count, const Matrix4 &view_projection,
+                       unsigned char *occluded) const;
+
+        unsigned int Width() const
+        { return width; }
+
+        unsigned int Height() const
+        { return height; }
+
+        // Row-major depths in [0, 1], row 0 at the bottom of the screen.
+        const float *Depths() const
+        { return depth.data(); }
+
+    private:
+
+        struct Triangle
+        {
+            // Edge functions a * x + b * y + c, non-negative inside.
+            float a[3], b[3], c[3];
+            // Depth plane z = zx * x + zy * y + z0.
+            float zx, zy, z0;
+            // Pixel bounds, max exclusive.
+            int min_x, min_y, max_x, max_y;
+        };
+
+        typedef std::vector<float, AlignedAllocator<float>> Stream;
+
+        unsigned int width, height;
+
+        Stream depth;
+
+        // Farthest depth of each 8x8 block.
+        std::vector<float> blocks;
+
+        // Scratch reused across Rasterize calls.
+        std::vector<Vector4, AlignedAllocator<Vector4>> clip;
+        std::vector<unsigned int> vertex_offsets, triangle_offsets;
+        std::vector<Triangle> triangles;
+        std::vector<unsigned char> triangle_counts;
+        std::vector<std::vector<unsigned int>> bins;
+        std::vector<unsigned int> active_tiles;
+
+        bool SetupTriangle(const float *v0, const float *v1, const float *v2, Triangle &t) const;
+
+        void RasterizeTile(const unsigned int tile);
+    };
+}
+#endif // __BCOSTA_OCCLUSION__
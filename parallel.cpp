@@ -0,0 +1,21 @@
+#include <atomic>
+#include "parallel.h"
+
+using namespace BCosta;
+
+static std::atomic<unsigned int> thread_count(0);
+
+unsigned int Parallel::ThreadCount()
+{
+    const unsigned int n = thread_count.load(std::memory_order_relaxed);
+    if (n) {
+        return n;
+    }
+    // Queried once: glibc reads sysfs on every call, which shows in code issuing many
+    // small For calls.
+    static const unsigned int hw = std::thread::hardware_concurrency();
+    return hw ? hw : 1;
+}
+
+void Parallel::SetThreadCount(const unsigned int n)
+{ thread_count.store(n, std::memory_order_relaxed); }
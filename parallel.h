@@ -0,0 +1,48 @@
+#ifndef __BCOSTA_PARALLEL__
+#define __BCOSTA_PARALLEL__
+
+#include <thread>
+#include <vector>
+
+namespace BCosta
+{
+    namespace Parallel
+    {
+        // Worker count used by For: hardware threads, or the value given to SetThreadCount.
+        unsigned int ThreadCount();
+
+        // 0 restores the hardware default, 1 makes every For run serially on the caller.
+        void SetThreadCount(const unsigned int n);
+
+        // Split [0, count) into contiguous ranges of at least 'grain' elements and call
+        // func(begin, end) on each, one range per thread, the calling thread included.
+        // Ranges are disjoint, so kernels that only write inside their range need no locking.
+        template<typename F>
+        void For(const unsigned int count, const unsigned int grain, const F &func)
+        {
+            const unsigned int max_ranges = grain ? (count + grain - 1) / grain : count;
+            const unsigned int ranges = max_ranges < ThreadCount() ? max_ranges : ThreadCount();
+
+            if (ranges <= 1) {
+                if (count) {
+                    func(0u, count);
+                }
+                return;
+            }
+
+            std::vector<std::thread> threads;
+            threads.reserve(ranges - 1);
+            for (unsigned int r = 1; r < ranges; r++) {
+                const unsigned int begin = (unsigned int) ((unsigned long long) count * r / ranges);
+                const unsigned int end = (unsigned int) ((unsigned long long) count * (r + 1) / ranges);
+                threads.push_back(std::thread(func, begin, end));
+            }
+            func(0u, (unsigned int) ((unsigned long long) count / ranges));
+
+            for (size_t i = 0; i < threads.size(); i++) {
+                threads[i].join();
+            }
+        }
+    }
+}
+#endif // __BCOSTA_PARALLEL__
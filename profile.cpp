@@ -0,0 +1,316 @@
+#include <string.h>
+#include <chrono>
+#include "profile.h"
+
+#ifdef BCOSTA_PROFILE
+#include <mutex>
+#include <vector>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace BCosta;
+using namespace BCosta::Profile;
+
+static const char *op_names[Op_Count] = {
+    "Matrix4::operator*",
+    "Matrix4::Inverse",
+    "Quaternion::Normalize",
+    "Quaternion::Slerp",
+    "Vector3::normalize"
+};
+
+// Multiplications, additions, divisions and square roots each count as one.
+static const unsigned int op_flops[Op_Count] = {
+    112, // 64 mul + 48 add
+    200, // cofactors, determinant and 16 scales
+    12,  // 4 mul + 3 add, sqrt, div, 4 mul
+    30,  // dot, trig on the slerp path, 8 mul + 4 add
+    9    // 3 mul + 2 add, sqrt, 3 div
+};
+
+unsigned long long Profile::Ticks()
+{
+    return (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef BCOSTA_PROFILE
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<ThreadCounters *> threads;
+        // Totals of threads that have exited.
+        unsigned long long retired[3][Op_Count];
+        // Totals at the last Reset.
+        unsigned long long baseline[3][Op_Count];
+        unsigned long long frames;
+
+        Registry()
+            : frames(0)
+        {
+            memset(retired, 0, sizeof(retired));
+            memset(baseline, 0, sizeof(baseline));
+        }
+    };
+
+    Registry &GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    // Owns the counters of one thread and folds them into the retired totals when the
+    // thread exits.
+    struct ThreadSlot
+    {
+        ThreadCounters counters;
+
+        ThreadSlot()
+        {
+            for (unsigned int i = 0; i < Op_Count; i++) {
+                counters.calls[i].store(0);
+                counters.sampled_calls[i].store(0);
+                counters.sampled_ticks[i].store(0);
+            }
+            Registry &r = GetRegistry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.threads.push_back(&counters);
+        }
+
+        ~ThreadSlot()
+        {
+            Registry &r = GetRegistry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (unsigned int i = 0; i < Op_Count; i++) {
+                r.retired[0][i] += counters.calls[i].load(std::memory_order_relaxed);
+                r.retired[1][i] += counters.sampled_calls[i].load(std::memory_order_relaxed);
+                r.retired[2][i] += counters.sampled_ticks[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < r.threads.size(); i++) {
+                if (r.threads[i] == &counters) {
+                    r.threads[i] = r.threads.back();
+                    r.threads.pop_back();
+                    break;
+                }
+            }
+        }
+    };
+
+    // Raw totals since startup, registry lock held by the caller.
+    void Totals(Registry &r, unsigned long long totals[3][Op_Count])
+    {
+        memcpy(totals, r.retired, sizeof(r.retired));
+        for (size_t t = 0; t < r.threads.size(); t++) {
+            const ThreadCounters &c = *r.threads[t];
+            for (unsigned int i = 0; i < Op_Count; i++) {
+                totals[0][i] += c.calls[i].load(std::memory_order_relaxed);
+                totals[1][i] += c.sampled_calls[i].load(std::memory_order_relaxed);
+                totals[2][i] += c.sampled_ticks[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+ThreadCounters &Profile::Local()
+{
+    static thread_local ThreadSlot slot;
+    return slot.counters;
+}
+
+void Profile::Collect(OpStats stats[Op_Count])
+{
+    Registry &r = GetRegistry();
+    unsigned long long totals[3][Op_Count];
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        Totals(r, totals);
+        for (unsigned int k = 0; k < 3; k++) {
+            for (unsigned int i = 0; i < Op_Count; i++) {
+                totals[k][i] -= r.baseline[k][i];
+            }
+        }
+    }
+    for (unsigned int i = 0; i < Op_Count; i++) {
+        stats[i].name = op_names[i];
+        stats[i].calls = totals[0][i];
+        stats[i].sampled_calls = totals[1][i];
+        stats[i].sampled_ticks = totals[2][i];
+        stats[i].flops = op_flops[i];
+    }
+}
+
+void Profile::EndFrame()
+{
+    Registry &r = GetRegistry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.frames++;
+}
+
+void Profile::Reset()
+{
+    Registry &r = GetRegistry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    Totals(r, r.baseline);
+    r.frames = 0;
+}
+
+void Profile::Print(FILE *out)
+{
+    OpStats stats[Op_Count];
+    Collect(stats);
+
+    unsigned long long frames;
+    {
+        Registry &r = GetRegistry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        frames = r.frames ? r.frames : 1;
+    }
+
+    fprintf(out, "%-24s %14s %14s %12s %16s %14s\n",
+            "operation", "calls", "calls/frame", "ticks/call", "ticks/frame", "Mflop/frame");
+    for (unsigned int i = 0; i < Op_Count; i++) {
+        const OpStats &s = stats[i];
+        const double per_call = s.sampled_calls ? (double) s.sampled_ticks / (double) s.sampled_calls : 0.0;
+        const double calls_per_frame = (double) s.calls / (double) frames;
+        fprintf(out, "%-24s %14llu %14.1f %12.1f %16.1f %14.3f\n",
+                s.name, s.calls, calls_per_frame, per_call, per_call * calls_per_frame,
+                calls_per_frame * s.flops * 1e-6);
+    }
+}
+
+#else
+
+void Profile::Collect(OpStats stats[Op_Count])
+{
+    for (unsigned int i = 0; i < Op_Count; i++) {
+        stats[i].name = op_names[i];
+        stats[i].calls = 0;
+        stats[i].sampled_calls = 0;
+        stats[i].sampled_ticks = 0;
+        stats[i].flops = op_flops[i];
+    }
+}
+
+void Profile::EndFrame()
+{ }
+
+void Profile::Reset()
+{ }
+
+void Profile::Print(FILE *out)
+{ fprintf(out, "cpp_math built without BCOSTA_PROFILE, no counters available\n"); }
+
+#endif
+
+// PerfCounters
+
+PerfCounters::PerfCounters()
+{
+    for (unsigned int i = 0; i < 4; i++) {
+        fds[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{ Close(); }
+
+#ifdef __linux__
+
+bool PerfCounters::Open()
+{
+    Close();
+
+    static const unsigned long long configs[4] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    for (unsigned int i = 0; i < 4; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // The first counter leads the group so all four run on the same schedule.
+        fds[i] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, i ? fds[0] : -1, 0);
+        if (fds[i] < 0) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PerfCounters::Close()
+{
+    for (unsigned int i = 0; i < 4; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+        fds[i] = -1;
+    }
+}
+
+void PerfCounters::Start()
+{
+    if (fds[0] >= 0) {
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void PerfCounters::Stop()
+{
+    if (fds[0] >= 0) {
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::Values PerfCounters::Read() const
+{
+    unsigned long long v[4] = {0, 0, 0, 0};
+    for (unsigned int i = 0; i < 4; i++) {
+        if (fds[i] >= 0 && read(fds[i], &v[i], sizeof(v[i])) != sizeof(v[i])) {
+            v[i] = 0;
+        }
+    }
+    Values values = {v[0], v[1], v[2], v[3]};
+    return values;
+}
+
+#else
+
+bool PerfCounters::Open()
+{ return false; }
+
+void PerfCounters::Close()
+{ }
+
+void PerfCounters::Start()
+{ }
+
+void PerfCounters::Stop()
+{ }
+
+PerfCounters::Values PerfCounters::Read() const
+{
+    Values values = {0, 0, 0, 0};
+    return values;
+}
+
+#endif
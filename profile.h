@@ -0,0 +1,172 @@
+#ifndef __BCOSTA_PROFILE__
+#define __BCOSTA_PROFILE__
+
+#include <stdio.h>
+
+#ifdef BCOSTA_PROFILE
+#include <atomic>
+#endif
+
+// Hot-path instrumentation, compiled in only when BCOSTA_PROFILE is defined (CMake option
+// CPP_MATH_PROFILE). Otherwise BCOSTA_PROFILE_SCOPE expands to nothing and instrumented
+// functions are unchanged.
+#ifdef BCOSTA_PROFILE
+#define BCOSTA_PROFILE_SCOPE(op) BCosta::Profile::Scope bcosta_profile_scope(BCosta::Profile::op)
+#else
+#define BCOSTA_PROFILE_SCOPE(op)
+#endif
+
+#ifdef BCOSTA_PROFILE
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BCOSTA_PROFILE_RDTSC 1
+#endif
+#endif
+
+namespace BCosta
+{
+    namespace Profile
+    {
+        enum Op
+        {
+            Op_Matrix4Multiply = 0,
+            Op_Matrix4Inverse,
+            Op_QuaternionNormalize,
+            Op_QuaternionSlerp,
+            Op_Vector3Normalize,
+            Op_Count
+        };
+
+        // One call in 'sample_period' is timed; the others are only counted.
+        const unsigned int sample_period = 64;
+
+        struct OpStats
+        {
+            const char *name;
+            unsigned long long calls;
+            unsigned long long sampled_calls;
+            unsigned long long sampled_ticks;
+            // Rough floating-point operation count of one call.
+            unsigned int flops;
+        };
+
+        // Counters summed over every thread that ever ran an instrumented operation.
+        void Collect(OpStats stats[Op_Count]);
+
+        // Mark a frame boundary; Print reports per-frame figures over the frames since the
+        // last Reset.
+        void EndFrame();
+
+        void Reset();
+
+        // Per-op calls, estimated flops and time (in timer ticks: TSC cycles on x86,
+        // nanoseconds elsewhere), in total and per frame.
+        void Print(FILE *out);
+
+        // Raw timer used by the sampled timers.
+        unsigned long long Ticks();
+
+#ifdef BCOSTA_PROFILE
+        // Only the owning thread writes its counters; relaxed load/store pairs keep the
+        // increments as cheap as plain adds while letting Collect read them safely.
+        struct ThreadCounters
+        {
+            std::atomic<unsigned long long> calls[Op_Count];
+            std::atomic<unsigned long long> sampled_calls[Op_Count];
+            std::atomic<unsigned long long> sampled_ticks[Op_Count];
+        };
+
+        inline unsigned long long Add(std::atomic<unsigned long long> &counter, const unsigned long long v)
+        {
+            const unsigned long long old = counter.load(std::memory_order_relaxed);
+            counter.store(old + v, std::memory_order_relaxed);
+            return old;
+        }
+
+        // Counters of the calling thread, registered for Collect on first use.
+        ThreadCounters &Local();
+
+#ifdef BCOSTA_PROFILE_RDTSC
+        inline unsigned long long FastTicks()
+        { return __rdtsc(); }
+#else
+        inline unsigned long long FastTicks()
+        { return Ticks(); }
+#endif
+
+        class Scope
+        {
+        public:
+
+            Scope(const Op _op)
+                : counters(Local()), op(_op), start(0)
+            {
+                if (Add(counters.calls[op], 1) % sample_period == 0) {
+                    start = FastTicks();
+                }
+            }
+
+            ~Scope()
+            {
+                if (start) {
+                    Add(counters.sampled_ticks[op], FastTicks() - start);
+                    Add(counters.sampled_calls[op], 1);
+                }
+            }
+
+        private:
+
+            ThreadCounters &counters;
+            const Op op;
+            unsigned long long start;
+        };
+#endif
+
+        // Hardware counters through Linux perf_event_open, meant for benchmark harnesses
+        // rather than shipping builds. Open returns false (and the counters stay at zero)
+        // where perf events are unavailable or not permitted.
+        class PerfCounters
+        {
+        public:
+
+            struct Values
+            {
+                unsigned long long cycles;
+                unsigned long long instructions;
+                unsigned long long cache_references;
+                unsigned long long cache_misses;
+
+                double Ipc() const
+                { return cycles ? (double) instructions / (double) cycles : 0.0; }
+            };
+
+            PerfCounters();
+
+            ~PerfCounters();
+
+            // Count events of the calling thread.
+            bool Open();
+
+            void Close();
+
+            void Start();
+
+            void Stop();
+
+            Values Read() const;
+
+        private:
+
+            PerfCounters(const PerfCounters &);
+
+            PerfCounters &operator =(const PerfCounters &);
+
+            int fds[4];
+        };
+    }
+}
+#endif // __BCOSTA_PROFILE__
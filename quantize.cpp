@@ -0,0 +1,405 @@
+#include <math.h>
+#include <string.h>
+#include "half.h"
+#include "matrix4.h"
+#include "parallel.h"
+#include "quantize.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 8192;
+
+// Half-float points converted per staging block.
+static const unsigned int half_block = 256;
+
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Quantize reads Vector3 arrays as packed floats");
+static_assert(sizeof(HalfVector3) == 3 * sizeof(unsigned short), "HalfVector3 must be packed");
+static_assert(sizeof(FixedVector3) == 3 * sizeof(unsigned short), "FixedVector3 must be packed");
+
+namespace
+{
+    float Sqrt(const float a)
+    { return sqrtf(a); }
+
+    float Abs(const float a)
+    { return fabsf(a); }
+
+    float Max(const float a, const float b)
+    { return a > b ? a : b; }
+
+    float Min(const float a, const float b)
+    { return a < b ? a : b; }
+
+    float Select(const bool mask, const float a, const float b)
+    { return mask ? a : b; }
+
+    // Octahedral fold of (x, y, z) to grid coordinates in [0, scale] plus one half, ready
+    // for truncation.
+    template<typename F>
+    void Fold(const F &x, const F &y, const F &z, const float scale, F &u, F &v)
+    {
+        const F zero(0.f), one(1.f);
+        const F inv = one / Max(Abs(x) + Abs(y) + Abs(z), F(1e-30f));
+        const F px = x * inv, py = y * inv;
+
+        // Lower hemisphere: reflect across the diagonals.
+        const auto lower = z < zero;
+        const F fx = Select(lower, (one - Abs(py)) * Select(px < zero, F(-1.f), one), px);
+        const F fy = Select(lower, (one - Abs(px)) * Select(py < zero, F(-1.f), one), py);
+
+        const F half_scale(.5f * scale);
+        u = fx * half_scale + half_scale + F(.5f);
+        v = fy * half_scale + half_scale + F(.5f);
+    }
+
+    // Grid coordinates back to a unit vector.
+    template<typename F>
+    void Unfold(const F &u, const F &v, const float scale, F &x, F &y, F &z)
+    {
+        const F zero(0.f), one(1.f), to_unit(2.f / scale);
+        const F fx = u * to_unit - one, fy = v * to_unit - one;
+        const F fz = one - Abs(fx) - Abs(fy);
+        const F t = Max(-fz, zero);
+        const F ux = fx + Select(fx < zero, t, -t), uy = fy + Select(fy < zero, t, -t);
+        const F inv = one / Sqrt(ux * ux + uy * uy + fz * fz);
+        x = ux * inv;
+        y = uy * inv;
+        z = fz * inv;
+    }
+
+    // Top three rows of a point transform.
+    struct Affine
+    {
+        float m[12];
+    };
+
+    Affine FromMatrix(const Matrix4 &m)
+    {
+        Affine a;
+        memcpy(a.m, m.m, sizeof(a.m));
+        return a;
+    }
+
+    // m applied to origin + q * step.
+    Affine FromFrame(const Matrix4 &m, const FixedFrame &frame)
+    {
+        Affine a;
+        const float *s = &frame.step.x, *o = &frame.origin.x;
+        for (unsigned int r = 0; r < 3; r++) {
+            const float *row = m.m + r * 4;
+            for (unsigned int k = 0; k < 3; k++) {
+                a.m[r * 4 + k] = row[k] * s[k];
+            }
+            a.m[r * 4 + 3] = row[0] * o[0] + row[1] * o[1] + row[2] * o[2] + row[3];
+        }
+        return a;
+    }
+
+    template<typename F>
+    void Apply(const float *m, const F &x, const F &y, const F &z, const F &w, F &ox, F &oy, F &oz)
+    {
+        ox = F(m[0]) * x + F(m[1]) * y + F(m[2]) * z + F(m[3]) * w;
+        oy = F(m[4]) * x + F(m[5]) * y + F(m[6]) * z + F(m[7]) * w;
+        oz = F(m[8]) * x + F(m[9]) * y + F(m[10]) * z + F(m[11]) * w;
+    }
+
+    unsigned int GetCode(const void *in, const unsigned int i, const unsigned int bits)
+    {
+        const unsigned char *p = (const unsigned char *) in + (size_t) i * (bits / 8);
+        unsigned int code = 0;
+        for (unsigned int b = 0; b < bits / 8; b++) {
+            code |= (unsigned int) p[b] << (b * 8);
+        }
+        return code;
+    }
+
+    void PutCode(void *out, const unsigned int i, const unsigned int bits, const unsigned int code)
+    {
+        unsigned char *p = (unsigned char *) out + (size_t) i * (bits / 8);
+        for (unsigned int b = 0; b < bits / 8; b++) {
+            p[b] = (unsigned char) (code >> (b * 8));
+        }
+    }
+
+    float AxisScale(const unsigned int bits)
+    { return (float) ((1u << (bits / 2)) - 1); }
+
+    unsigned int Pack(const float u, const float v, const unsigned int bits)
+    { return (unsigned int) u | ((unsigned int) v << (bits / 2)); }
+
+    // Unit vector of octahedral code 'code'.
+    void Unpack(const unsigned int code, const unsigned int bits, float &x, float &y, float &z)
+    {
+        const unsigned int mask = (1u << (bits / 2)) - 1;
+        Unfold((float) (code & mask), (float) (code >> (bits / 2)), AxisScale(bits), x, y, z);
+    }
+
+    // Points of 'in' (three floats each, in cache) through the affine transform.
+    void ApplyPoints(const Affine &a, const float *in, const unsigned int count, Vector3 *out)
+    {
+        unsigned int i = 0;
+#ifdef __SSE2__
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, z, r0, r1, r2;
+            Sse::Deinterleave3(_mm_loadu_ps(in + i * 3), _mm_loadu_ps(in + i * 3 + 4), _mm_loadu_ps(in + i * 3 + 8),
+                               x, y, z);
+            Sse::Float4 ox, oy, oz;
+            Apply(a.m, Sse::Float4(x), Sse::Float4(y), Sse::Float4(z), Sse::Float4(1.f), ox, oy, oz);
+            Sse::Interleave3(ox.v, oy.v, oz.v, r0, r1, r2);
+            _mm_storeu_ps(&out[i].x, r0);
+            _mm_storeu_ps(&out[i].x + 4, r1);
+            _mm_storeu_ps(&out[i].x + 8, r2);
+        }
+#endif
+        for (; i < count; i++) {
+            float ox, oy, oz;
+            Apply(a.m, in[i * 3], in[i * 3 + 1], in[i * 3 + 2], 1.f, ox, oy, oz);
+            out[i].Set(ox, oy, oz);
+        }
+    }
+
+    void FixedPoints(const FixedVector3 *in, const unsigned int count, const Affine &a, Vector3 *out)
+    {
+        Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+            unsigned int i = begin;
+#ifdef __SSE2__
+            // Four points are 12 shorts: widen them to the three registers of interleaved floats.
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 4 <= end; i += 4) {
+                const __m128i lo = _mm_loadu_si128((const __m128i *) (in + i));
+                const __m128i hi = _mm_loadl_epi64((const __m128i *) ((const unsigned short *) (in + i) + 8));
+                const __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+                const __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+                const __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+
+                __m128 x, y, z, r0, r1, r2;
+                Sse::Deinterleave3(f0, f1, f2, x, y, z);
+                Sse::Float4 ox, oy, oz;
+                Apply(a.m, Sse::Float4(x), Sse::Float4(y), Sse::Float4(z), Sse::Float4(1.f), ox, oy, oz);
+                Sse::Interleave3(ox.v, oy.v, oz.v, r0, r1, r2);
+                _mm_storeu_ps(&out[i].x, r0);
+                _mm_storeu_ps(&out[i].x + 4, r1);
+                _mm_storeu_ps(&out[i].x + 8, r2);
+            }
+#endif
+            for (; i < end; i++) {
+                float ox, oy, oz;
+                Apply(a.m, (float) in[i].x, (float) in[i].y, (float) in[i].z, 1.f, ox, oy, oz);
+                out[i].Set(ox, oy, oz);
+            }
+        });
+    }
+
+    // Octahedral codes [begin, end) decoded, then handed to 'emit' as four lanes or one.
+    template<typename E>
+    void Directions(const void *in, const unsigned int begin, const unsigned int end, const unsigned int bits,
+                    const E &emit)
+    {
+        const float scale = AxisScale(bits);
+        unsigned int i = begin;
+#ifdef __SSE2__
+        const __m128i mask = _mm_set1_epi32((int) scale);
+        for (; i + 4 <= end; i += 4) {
+            const __m128i codes = _mm_set_epi32((int) GetCode(in, i + 3, bits), (int) GetCode(in, i + 2, bits),
+                                                (int) GetCode(in, i + 1, bits), (int) GetCode(in, i, bits));
+            const Sse::Float4 u = _mm_cvtepi32_ps(_mm_and_si128(codes, mask));
+            const Sse::Float4 v = _mm_cvtepi32_ps(_mm_srli_epi32(codes, (int) (bits / 2)));
+            Sse::Float4 x, y, z;
+            Unfold(u, v, scale, x, y, z);
+            emit(i, x, y, z);
+        }
+#endif
+        for (; i < end; i++) {
+            float x, y, z;
+            Unpack(GetCode(in, i, bits), bits, x, y, z);
+            emit(i, x, y, z);
+        }
+    }
+
+    void Store(Vector3 *out, const unsigned int i, const float x, const float y, const float z)
+    { out[i].Set(x, y, z); }
+
+#ifdef __SSE2__
+    void Store(Vector3 *out, const unsigned int i, const Sse::Float4 &x, const Sse::Float4 &y, const Sse::Float4 &z)
+    {
+        __m128 r0, r1, r2;
+        Sse::Interleave3(x.v, y.v, z.v, r0, r1, r2);
+        _mm_storeu_ps(&out[i].x, r0);
+        _mm_storeu_ps(&out[i].x + 4, r1);
+        _mm_storeu_ps(&out[i].x + 8, r2);
+    }
+#endif
+
+    struct StoreDirection
+    {
+        Vector3 *out;
+
+        template<typename F>
+        void operator()(const unsigned int i, const F &x, const F &y, const F &z) const
+        { Store(out, i, x, y, z); }
+    };
+
+    struct TransformDirection
+    {
+        const float *m;
+        Vector3 *out;
+
+        template<typename F>
+        void operator()(const unsigned int i, const F &x, const F &y, const F &z) const
+        {
+            F ox, oy, oz;
+            Apply(m, x, y, z, F(0.f), ox, oy, oz);
+            const F inv = F(1.f) / Sqrt(Max(ox * ox + oy * oy + oz * oz, F(1e-30f)));
+            Store(out, i, ox * inv, oy * inv, oz * inv);
+        }
+    };
+}
+
+FixedFrame FixedFrame::Fit(const Aabb &box)
+{
+    FixedFrame frame;
+    frame.origin = box.min;
+    frame.step = Vector3((box.max.x - box.min.x) / 65535.f, (box.max.y - box.min.y) / 65535.f,
+                         (box.max.z - box.min.z) / 65535.f);
+    return frame;
+}
+
+unsigned int Quantize::EncodeOctahedral(const Vector3 &unit, const OctahedralBits bits)
+{
+    float u, v;
+    Fold(unit.x, unit.y, unit.z, AxisScale(bits), u, v);
+    return Pack(u, v, bits);
+}
+
+Vector3 Quantize::DecodeOctahedral(const unsigned int code, const OctahedralBits bits)
+{
+    float x, y, z;
+    Unpack(code, bits, x, y, z);
+    return Vector3(x, y, z);
+}
+
+void Quantize::EncodeOctahedral(const Vector3 *in, const unsigned int count, const OctahedralBits bits, void *out)
+{
+    const float scale = AxisScale(bits);
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int i = begin;
+#ifdef __SSE2__
+        for (; i + 4 <= end; i += 4) {
+            __m128 x, y, z;
+            Sse::Deinterleave3(_mm_loadu_ps(&in[i].x), _mm_loadu_ps(&in[i].x + 4), _mm_loadu_ps(&in[i].x + 8), x, y, z);
+            Sse::Float4 u, v;
+            Fold(Sse::Float4(x), Sse::Float4(y), Sse::Float4(z), scale, u, v);
+
+            alignas(16) unsigned int codes[4];
+            _mm_store_si128((__m128i *) codes, _mm_or_si128(_mm_cvttps_epi32(u.v),
+                                                            _mm_slli_epi32(_mm_cvttps_epi32(v.v), (int) (bits / 2))));
+            for (unsigned int k = 0; k < 4; k++) {
+                PutCode(out, i + k, bits, codes[k]);
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            float u, v;
+            Fold(in[i].x, in[i].y, in[i].z, scale, u, v);
+            PutCode(out, i, bits, Pack(u, v, bits));
+        }
+    });
+}
+
+void Quantize::DecodeOctahedral(const void *in, const unsigned int count, const OctahedralBits bits, Vector3 *out)
+{
+    const StoreDirection emit = {out};
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        Directions(in, begin, end, bits, emit);
+    });
+}
+
+void Quantize::EncodeHalf(const Vector3 *in, const unsigned int count, HalfVector3 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        Half::FromFloats(&in[begin].x, (end - begin) * 3, &out[begin].x);
+    });
+}
+
+void Quantize::DecodeHalf(const HalfVector3 *in, const unsigned int count, Vector3 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        Half::ToFloats(&in[begin].x, (end - begin) * 3, &out[begin].x);
+    });
+}
+
+void Quantize::EncodeFixed(const Vector3 *in, const unsigned int count, const FixedFrame &frame, FixedVector3 *out)
+{
+    const float *o = &frame.origin.x, *s = &frame.step.x;
+    const float inv[3] = {s[0] > 0.f ? 1.f / s[0] : 0.f, s[1] > 0.f ? 1.f / s[1] : 0.f, s[2] > 0.f ? 1.f / s[2] : 0.f};
+
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        unsigned int i = begin;
+#ifdef __SSE2__
+        // Grid coordinates are rounded, clamped, then packed as signed shorts around 32768
+        // and flipped back to unsigned.
+        const __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]);
+        const __m128 ix = _mm_set1_ps(inv[0]), iy = _mm_set1_ps(inv[1]), iz = _mm_set1_ps(inv[2]);
+        const __m128 half = _mm_set1_ps(.5f), top = _mm_set1_ps(65535.f);
+        const __m128i bias = _mm_set1_epi32(32768), flip = _mm_set1_epi16((short) 0x8000);
+        for (; i + 4 <= end; i += 4) {
+            __m128 x, y, z, r0, r1, r2;
+            Sse::Deinterleave3(_mm_loadu_ps(&in[i].x), _mm_loadu_ps(&in[i].x + 4), _mm_loadu_ps(&in[i].x + 8), x, y, z);
+            x = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, ox), ix), half), half), top);
+            y = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(y, oy), iy), half), half), top);
+            z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(z, oz), iz), half), half), top);
+            Sse::Interleave3(x, y, z, r0, r1, r2);
+
+            const __m128i q0 = _mm_sub_epi32(_mm_cvttps_epi32(r0), bias);
+            const __m128i q1 = _mm_sub_epi32(_mm_cvttps_epi32(r1), bias);
+            const __m128i q2 = _mm_sub_epi32(_mm_cvttps_epi32(r2), bias);
+            _mm_storeu_si128((__m128i *) (out + i), _mm_xor_si128(_mm_packs_epi32(q0, q1), flip));
+            _mm_storel_epi64((__m128i *) ((unsigned short *) (out + i) + 8), _mm_xor_si128(_mm_packs_epi32(q2, q2), flip));
+        }
+#endif
+        for (; i < end; i++) {
+            const float *p = &in[i].x;
+            unsigned short *q = &out[i].x;
+            for (unsigned int k = 0; k < 3; k++) {
+                q[k] = (unsigned short) Min(Max((p[k] - o[k]) * inv[k] + .5f, .5f), 65535.f);
+            }
+        }
+    });
+}
+
+void Quantize::DecodeFixed(const FixedVector3 *in, const unsigned int count, const FixedFrame &frame, Vector3 *out)
+{
+    FixedPoints(in, count, FromFrame(Matrix4::static_identity, frame), out);
+}
+
+void Quantize::TransformPoints(const FixedVector3 *in, const unsigned int count, const FixedFrame &frame,
+                               const Matrix4 &m, Vector3 *out)
+{
+    FixedPoints(in, count, FromFrame(m, frame), out);
+}
+
+void Quantize::TransformPoints(const HalfVector3 *in, const unsigned int count, const Matrix4 &m, Vector3 *out)
+{
+    const Affine a = FromMatrix(m);
+
+    // Conversion through a block that stays in L1, not a float copy of the array.
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        alignas(16) float floats[half_block * 3];
+        for (unsigned int i = begin; i < end; i += half_block) {
+            const unsigned int n = end - i < half_block ? end - i : half_block;
+            Half::ToFloats(&in[i].x, n * 3, floats);
+            ApplyPoints(a, floats, n, out + i);
+        }
+    });
+}
+
+void Quantize::TransformDirections(const void *in, const unsigned int count, const OctahedralBits bits,
+                                   const Matrix4 &m, Vector3 *out)
+{
+    const TransformDirection emit = {m.m, out};
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        Directions(in, begin, end, bits, emit);
+    });
+}
@@ -2,6 +2,7 @@
 #include "quaternion.h"
 #include "matrix3.h"
 #include "matrix4.h"
+#include "profile.h"
 #include "vector.h"
 
 using namespace BCosta;
@@ -39,6 +40,7 @@ void Quaternion::Set(float _x, float _y, float _z, float _w)
 
 Quaternion Quaternion::Normalize()
 {
+    BCOSTA_PROFILE_SCOPE(Op_QuaternionNormalize);
     const float d = sqrt(x * x + y * y + z * z + w * w);
     const float k = 1.f / d;
     return Quaternion(x * k, y * k, z * k, w * k);
@@ -62,24 +64,15 @@ Quaternion Quaternion::Inverse()
 
 Matrix3 Quaternion::ToMatrix3()
 {
-    const float x_x = x * x,
-        x_y = x * y,
-        x_z = x * z,
-        x_w = x * w,
-        y_y = y * y,
-        y_z = y * z,
-        y_w = y * w,
-        z_z = z * z,
-        z_w = z * w;
-
-    return Matrix3(
-        1.f - 2.f * (y_y + z_z), 2.f * (x_y - z_w), 2.f * (x_z + y_w),
-        2.f * (x_y + z_w), 1.f - 2.f * (x_x + z_z), 2.f * (y_z - x_w),
-        2.f * (x_z - y_w), 2.f * (y_z + x_w), 1.f - 2.f * (x_x + y_y)
-    );
+    Matrix3 m;
+    ToRotationScale(Vector3(1.f, 1.f, 1.f), m.m);
+    return m;
 }
 
 Matrix4 Quaternion::ToMatrix4()
+{ return Matrix4::Compose(Vector3(0.f, 0.f, 0.f), *this, Vector3(1.f, 1.f, 1.f)); }
+
+void Quaternion::ToRotationScale(const Vector3 &s, float *out) const
 {
     const float x_x = x * x,
         x_y = x * y,
@@ -91,12 +84,15 @@ Matrix4 Quaternion::ToMatrix4()
         z_z = z * z,
         z_w = z * w;
 
-    return Matrix4(
-        1.f - 2.f * (y_y + z_z), 2.f * (x_y - z_w), 2.f * (x_z + y_w), 0,
-        2.f * (x_y + z_w), 1.f - 2.f * (x_x + z_z), 2.f * (y_z - x_w), 0,
-        2.f * (x_z - y_w), 2.f * (y_z + x_w), 1.f - 2.f * (x_x + y_y), 0,
-        0, 0, 0, 1
-    );
+    out[0] = (1.f - 2.f * (y_y + z_z)) * s.x;
+    out[1] = 2.f * (x_y - z_w) * s.y;
+    out[2] = 2.f * (x_z + y_w) * s.z;
+    out[3] = 2.f * (x_y + z_w) * s.x;
+    out[4] = (1.f - 2.f * (x_x + z_z)) * s.y;
+    out[5] = 2.f * (y_z - x_w) * s.z;
+    out[6] = 2.f * (x_z - y_w) * s.x;
+    out[7] = 2.f * (y_z + x_w) * s.y;
+    out[8] = (1.f - 2.f * (x_x + y_y)) * s.z;
 }
 
 void Quaternion::ToAxisAngle(Vector3 *axis, float *angle)
@@ -124,7 +120,7 @@ Quaternion Quaternion::FromMatrix3(const Matrix3 &m)
     const float trace = m.m[0] + m.m[4] + m.m[8];
 
     if (trace > 0.f) {
-        const float scale = 2.f * sqrt(trace);
+        const float scale = 2.f * sqrt(1.f + trace);
         _x = (m.m[5] - m.m[7]) / scale;
         _y = (m.m[6] - m.m[2]) / scale;
         _z = (m.m[1] - m.m[3]) / scale;
@@ -167,6 +163,7 @@ Quaternion Quaternion::FromEuler_ZYX(float pitch, float yaw, float roll)
 
 const Quaternion Quaternion::Slerp(Quaternion &a, Quaternion &b, float t)
 {
+    BCOSTA_PROFILE_SCOPE(Op_QuaternionSlerp);
     float cosQ = a.Dot(b);
 
     if (cosQ < 0.f) {
@@ -45,6 +45,10 @@ namespace BCosta
 
         Matrix4 ToMatrix4();
 
+        // Rotation matrix times a scale along each axis, row-major into out[9]; the 3x3 part
+        // of Matrix4::Compose.
+        void ToRotationScale(const Vector3 &s, float *out) const;
+
         void ToAxisAngle(Vector3 *axis, float *angle);
 
         // FromAxisAngle : convert axis-angle to quaternion.
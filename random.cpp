@@ -0,0 +1,364 @@
+#include <math.h>
+#include "parallel.h"
+#include "random.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+// In groups of four samples.
+static const unsigned int grain = 1024;
+
+static const unsigned int M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+static const unsigned int W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+static const float two_pi = 6.28318530717958647692f;
+
+namespace
+{
+    void Philox(unsigned int c[4], unsigned int k0, unsigned int k1)
+    {
+        for (unsigned int r = 0; r < 10; r++) {
+            const unsigned long long p0 = (unsigned long long) M0 * c[0];
+            const unsigned long long p1 = (unsigned long long) M1 * c[2];
+            const unsigned int c1 = c[1], c3 = c[3];
+            c[0] = (unsigned int) (p1 >> 32) ^ c1 ^ k0;
+            c[1] = (unsigned int) p1;
+            c[2] = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+            c[3] = (unsigned int) p0;
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+
+    // 24 high bits to [0, 1), exactly.
+    float ToUniform(const unsigned int r)
+    {
+        return (float) (r >> 8) * (1.f / 16777216.f);
+    }
+
+#ifndef __SSE2__
+    float Sqrt(const float a)
+    { return sqrtf(a); }
+
+    float Max(const float a, const float b)
+    { return a > b ? a : b; }
+
+    float Cbrt(const float a)
+    { return cbrtf(a); }
+
+    void SinCos(const float a, float &s, float &c)
+    {
+        s = sinf(a);
+        c = cosf(a);
+    }
+#else
+    // Exponent divided by three on the bits for a 5% guess, then three Newton steps.
+    // Arguments are in [0, 1].
+    Sse::Float4 Cbrt(const Sse::Float4 &a)
+    {
+        __m128i hi, lo;
+        Sse::MulHiLo(_mm_castps_si128(a.v), _mm_set1_epi32(0x55555556), hi, lo);
+        Sse::Float4 y = _mm_castsi128_ps(_mm_add_epi32(hi, _mm_set1_epi32(0x2a5119f2)));
+        for (unsigned int k = 0; k < 3; k++) {
+            y = (y + y + a / (y * y)) * (1.f / 3.f);
+        }
+        return y;
+    }
+
+    // Blocks first .. first + 3, one per lane, as four uniform vectors.
+    void Philox(const Random &random, const unsigned long long first, Sse::Float4 u[4])
+    {
+        __m128i c0 = _mm_set_epi32((int) (first + 3), (int) (first + 2), (int) (first + 1), (int) first);
+        __m128i c1 = _mm_set_epi32((int) ((first + 3) >> 32), (int) ((first + 2) >> 32),
+                                   (int) ((first + 1) >> 32), (int) (first >> 32));
+        __m128i c2 = _mm_set1_epi32((int) random.stream);
+        __m128i c3 = _mm_setzero_si128();
+        __m128i k0 = _mm_set1_epi32((int) random.key0), k1 = _mm_set1_epi32((int) random.key1);
+        const __m128i m0 = _mm_set1_epi32((int) M0), m1 = _mm_set1_epi32((int) M1);
+        const __m128i w0 = _mm_set1_epi32((int) W0), w1 = _mm_set1_epi32((int) W1);
+
+        for (unsigned int r = 0; r < 10; r++) {
+            __m128i hi0, lo0, hi1, lo1;
+            Sse::MulHiLo(m0, c0, hi0, lo0);
+            Sse::MulHiLo(m1, c2, hi1, lo1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), k0);
+            c1 = lo1;
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), k1);
+            c3 = lo0;
+            k0 = _mm_add_epi32(k0, w0);
+            k1 = _mm_add_epi32(k1, w1);
+        }
+
+        const __m128 scale = _mm_set1_ps(1.f / 16777216.f);
+        u[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(c0, 8)), scale);
+        u[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(c1, 8)), scale);
+        u[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(c2, 8)), scale);
+        u[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(c3, 8)), scale);
+    }
+#endif
+
+    // Orthonormal tangent and bitangent completing a unit normal (Duff et al., "Building
+    // an Orthonormal Basis, Revisited").
+    void Basis(const Vector3 &n, Vector3 &t, Vector3 &b)
+    {
+        const float sign = n.z >= 0.f ? 1.f : -1.f;
+        const float a = -1.f / (sign + n.z);
+        const float c = n.x * n.y * a;
+        t = Vector3(1.f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+        b = Vector3(c, sign + n.y * n.y * a, -n.y);
+    }
+
+    // Samplers map the four uniforms of a block to up to four output components.
+    struct UniformSampler
+    {
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        { out[0] = u[0]; }
+    };
+
+    struct SphereSampler
+    {
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            const F z = F(1.f) - u[0] * F(2.f);
+            const F r = Sqrt(Max(F(1.f) - z * z, F(0.f)));
+            F s, c;
+            SinCos(u[1] * F(two_pi), s, c);
+            out[0] = r * c;
+            out[1] = r * s;
+            out[2] = z;
+        }
+    };
+
+    // Local (x, y, z) around the z axis, mapped onto the frame (t, b, n) and offset.
+    struct Frame
+    {
+        Vector3 origin, t, b, n;
+
+        template<typename F>
+        void Map(const F &x, const F &y, const F &z, F out[4]) const
+        {
+            out[0] = F(origin.x) + x * F(t.x) + y * F(b.x) + z * F(n.x);
+            out[1] = F(origin.y) + x * F(t.y) + y * F(b.y) + z * F(n.y);
+            out[2] = F(origin.z) + x * F(t.z) + y * F(b.z) + z * F(n.z);
+        }
+    };
+
+    struct HemisphereSampler
+    {
+        Frame frame;
+
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            const F z = u[0];
+            const F r = Sqrt(Max(F(1.f) - z * z, F(0.f)));
+            F s, c;
+            SinCos(u[1] * F(two_pi), s, c);
+            frame.Map(r * c, r * s, z, out);
+        }
+    };
+
+    // Uniform on the unit disk, projected up onto the hemisphere (Malley's method).
+    struct CosineSampler
+    {
+        Frame frame;
+
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            const F r = Sqrt(u[0]);
+            F s, c;
+            SinCos(u[1] * F(two_pi), s, c);
+            frame.Map(r * c, r * s, Sqrt(Max(F(1.f) - u[0], F(0.f))), out);
+        }
+    };
+
+    struct DiskSampler
+    {
+        Frame frame;
+        float radius;
+
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            const F r = Sqrt(u[0]) * F(radius);
+            F s, c;
+            SinCos(u[1] * F(two_pi), s, c);
+            frame.Map(r * c, r * s, F(0.f), out);
+        }
+    };
+
+    struct BoxSampler
+    {
+        Aabb box;
+
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            out[0] = F(box.min.x) + u[0] * F(box.max.x - box.min.x);
+            out[1] = F(box.min.y) + u[1] * F(box.max.y - box.min.y);
+            out[2] = F(box.min.z) + u[2] * F(box.max.z - box.min.z);
+        }
+    };
+
+    // A direction scaled by the cube root of a uniform: volume grows with r^3.
+    struct BallSampler
+    {
+        BoundingSphere sphere;
+
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            SphereSampler()(u, out);
+            const F r = Cbrt(u[2]) * F(sphere.radius);
+            out[0] = F(sphere.center.x) + out[0] * r;
+            out[1] = F(sphere.center.y) + out[1] * r;
+            out[2] = F(sphere.center.z) + out[2] * r;
+        }
+    };
+
+    struct RotationSampler
+    {
+        template<typename F>
+        void operator()(const F u[4], F out[4]) const
+        {
+            const F r1 = Sqrt(Max(F(1.f) - u[0], F(0.f))), r2 = Sqrt(u[0]);
+            F s1, c1, s2, c2;
+            SinCos(u[1] * F(two_pi), s1, c1);
+            SinCos(u[2] * F(two_pi), s2, c2);
+            out[0] = r1 * s1;
+            out[1] = r1 * c1;
+            out[2] = r2 * s2;
+            out[3] = r2 * c2;
+        }
+    };
+
+    // Sample i from block first + i into outputs[0 .. channels). Every full or partial group of
+    // four takes the same path, so a sample never depends on how the batch was split.
+    template<typename S>
+    void Generate(Random &random, const unsigned int count, float *const *outputs, const unsigned int channels,
+                  const S &sampler)
+    {
+        const unsigned long long first = random.Take(count);
+        const unsigned int groups = (count + 3) / 4;
+
+        Parallel::For(groups, grain, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int g = begin; g < end; g++) {
+                const unsigned int i = g * 4;
+                const unsigned int n = count - i < 4 ? count - i : 4;
+#ifdef __SSE2__
+                Sse::Float4 u[4], out[4];
+                Philox(random, first + i, u);
+                sampler(u, out);
+                for (unsigned int c = 0; c < channels; c++) {
+                    if (n == 4) {
+                        _mm_storeu_ps(outputs[c] + i, out[c].v);
+                    } else {
+                        alignas(16) float lanes[4];
+                        _mm_store_ps(lanes, out[c].v);
+                        for (unsigned int k = 0; k < n; k++) {
+                            outputs[c][i + k] = lanes[k];
+                        }
+                    }
+                }
+#else
+                for (unsigned int k = 0; k < n; k++) {
+                    unsigned int block[4];
+                    random.Block(first + i + k, block);
+                    const float u[4] = {ToUniform(block[0]), ToUniform(block[1]), ToUniform(block[2]), ToUniform(block[3])};
+                    float out[4];
+                    sampler(u, out);
+                    for (unsigned int c = 0; c < channels; c++) {
+                        outputs[c][i + k] = out[c];
+                    }
+                }
+#endif
+            }
+        });
+    }
+
+    Frame MakeFrame(const Vector3 &origin, const Vector3 &normal)
+    {
+        Frame frame;
+        frame.origin = origin;
+        frame.n = normal;
+        Basis(normal, frame.t, frame.b);
+        return frame;
+    }
+}
+
+void Random::Block(const unsigned long long index, unsigned int out[4]) const
+{
+    out[0] = (unsigned int) index;
+    out[1] = (unsigned int) (index >> 32);
+    out[2] = stream;
+    out[3] = 0;
+    Philox(out, key0, key1);
+}
+
+unsigned int Random::Next()
+{
+    unsigned int block[4];
+    Block(position++, block);
+    return block[0];
+}
+
+float Random::Uniform()
+{
+    return ToUniform(Next());
+}
+
+void Sampling::Uniforms(Random &random, const unsigned int count, float *out)
+{
+    float *const outputs[] = {out};
+    Generate(random, count, outputs, 1, UniformSampler());
+}
+
+void Sampling::UnitVectors(Random &random, const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    Generate(random, count, outputs, 3, SphereSampler());
+}
+
+void Sampling::Hemisphere(Random &random, const Vector3 &normal, const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    const HemisphereSampler sampler = {MakeFrame(Vector3(0.f, 0.f, 0.f), normal)};
+    Generate(random, count, outputs, 3, sampler);
+}
+
+void Sampling::CosineHemisphere(Random &random, const Vector3 &normal, const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    const CosineSampler sampler = {MakeFrame(Vector3(0.f, 0.f, 0.f), normal)};
+    Generate(random, count, outputs, 3, sampler);
+}
+
+void Sampling::InAabb(Random &random, const Aabb &box, const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    const BoxSampler sampler = {box};
+    Generate(random, count, outputs, 3, sampler);
+}
+
+void Sampling::InSphere(Random &random, const BoundingSphere &sphere, const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    const BallSampler sampler = {sphere};
+    Generate(random, count, outputs, 3, sampler);
+}
+
+void Sampling::InDisk(Random &random, const Vector3 &center, const Vector3 &normal, const float radius,
+                      const unsigned int count, const Vector3SoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z};
+    const DiskSampler sampler = {MakeFrame(center, normal), radius};
+    Generate(random, count, outputs, 3, sampler);
+}
+
+void Sampling::Rotations(Random &random, const unsigned int count, const QuaternionSoA &out)
+{
+    float *const outputs[] = {out.x, out.y, out.z, out.w};
+    Generate(random, count, outputs, 4, RotationSampler());
+}
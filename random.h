@@ -0,0 +1,87 @@
+#ifndef __BCOSTA_RANDOM__
+#define __BCOSTA_RANDOM__
+
+#include "bounds.h"
+#include "soa.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Counter-based generator (Philox4x32-10). Block n of a generator is a pure function of
+    // (seed, stream, n), four 32-bit values, so any part of a sequence can be produced by any
+    // thread: batches give the same numbers however they are split, and distinct streams of
+    // one seed are independent sequences for separate systems.
+    //
+    // The sequential calls and the Sampling batches all draw blocks from 'position', which
+    // they advance.
+    class Random
+    {
+    public:
+
+        explicit Random(const unsigned long long seed = 0, const unsigned int _stream = 0)
+            : key0((unsigned int) seed), key1((unsigned int) (seed >> 32)), stream(_stream), position(0)
+        { }
+
+        // The four values of block 'index'.
+        void Block(const unsigned long long index, unsigned int out[4]) const;
+
+        // First value of the next block.
+        unsigned int Next();
+
+        // Next value in [0, 1) with 24 bits of randomness.
+        float Uniform();
+
+        unsigned long long Position() const
+        { return position; }
+
+        void Seek(const unsigned long long _position)
+        { position = _position; }
+
+        // Reserve 'count' blocks and return the index of the first.
+        unsigned long long Take(const unsigned long long count)
+        {
+            const unsigned long long first = position;
+            position += count;
+            return first;
+        }
+
+        unsigned int key0, key1;
+        unsigned int stream;
+
+    private:
+
+        unsigned long long position;
+    };
+
+    // Batched samplers writing straight into component streams. Sample i uses block
+    // Position() + i; four samples are generated per step on SSE2 and ranges are split
+    // across threads, with results independent of the split.
+    namespace Sampling
+    {
+        // Uniform in [0, 1).
+        void Uniforms(Random &random, const unsigned int count, float *out);
+
+        // Uniform on the unit sphere.
+        void UnitVectors(Random &random, const unsigned int count, const Vector3SoA &out);
+
+        // Uniform over the unit hemisphere around 'normal' (unit length).
+        void Hemisphere(Random &random, const Vector3 &normal, const unsigned int count, const Vector3SoA &out);
+
+        // Cosine-weighted over the hemisphere around 'normal', the importance sampling of
+        // diffuse lighting.
+        void CosineHemisphere(Random &random, const Vector3 &normal, const unsigned int count, const Vector3SoA &out);
+
+        void InAabb(Random &random, const Aabb &box, const unsigned int count, const Vector3SoA &out);
+
+        // Uniform inside the sphere's volume.
+        void InSphere(Random &random, const BoundingSphere &sphere, const unsigned int count, const Vector3SoA &out);
+
+        // Uniform on a disk of the given center, unit normal and radius.
+        void InDisk(Random &random, const Vector3 &center, const Vector3 &normal, const float radius,
+                    const unsigned int count, const Vector3SoA &out);
+
+        // Uniformly distributed unit quaternions (Shoemake's method).
+        void Rotations(Random &random, const unsigned int count, const QuaternionSoA &out);
+    }
+}
+#endif // __BCOSTA_RANDOM__
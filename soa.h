@@ -0,0 +1,43 @@
+#ifndef __BCOSTA_SOA__
+#define __BCOSTA_SOA__
+
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Structure-of-arrays views over caller-owned component streams, the layout batch
+    // kernels work on. Views don't own memory; each array holds at least as many elements
+    // as the kernel is asked to process.
+    struct Vector3SoA
+    {
+        float *x, *y, *z;
+
+        Vector3 Get(const unsigned int i) const
+        { return Vector3(x[i], y[i], z[i]); }
+
+        void Set(const unsigned int i, const Vector3 &v) const
+        {
+            x[i] = v.x;
+            y[i] = v.y;
+            z[i] = v.z;
+        }
+    };
+
+    struct QuaternionSoA
+    {
+        float *x, *y, *z, *w;
+
+        Quaternion Get(const unsigned int i) const
+        { return Quaternion(x[i], y[i], z[i], w[i]); }
+
+        void Set(const unsigned int i, const Quaternion &q) const
+        {
+            x[i] = q.x;
+            y[i] = q.y;
+            z[i] = q.z;
+            w[i] = q.w;
+        }
+    };
+}
+#endif // __BCOSTA_SOA__
@@ -0,0 +1,231 @@
+#include "spatial_hash.h"
+
+using namespace BCosta;
+
+static const unsigned int initial_slots = 64;
+
+SpatialHashGrid::SpatialHashGrid(const float _cell_size)
+    : cell_count(0), item_count(0)
+{
+    cell_size = _cell_size > 0.f ? _cell_size : 1.f;
+    inv_cell_size = 1.f / cell_size;
+
+    Slot empty = {0, 0, 0, none};
+    slots.assign(initial_slots, empty);
+    mask = initial_slots - 1;
+}
+
+void SpatialHashGrid::Clear(const float _cell_size)
+{
+    if (_cell_size > 0.f) {
+        cell_size = _cell_size;
+        inv_cell_size = 1.f / cell_size;
+    }
+    Slot empty = {0, 0, 0, none};
+    slots.assign(slots.size(), empty);
+    cell_count = 0;
+    items.clear();
+    item_count = 0;
+}
+
+void SpatialHashGrid::Reserve(const unsigned int n)
+{
+    items.reserve(n);
+    while (slots.size() < (size_t) n * 2) {
+        Grow();
+    }
+}
+
+unsigned int SpatialHashGrid::Find(const int x, const int y, const int z) const
+{
+    for (unsigned int i = Hash(x, y, z);; i = (i + 1) & mask) {
+        const Slot &s = slots[i];
+        if (s.head == none) {
+            return none;
+        }
+        if (s.x == x && s.y == y && s.z == z) {
+            return i;
+        }
+    }
+}
+
+unsigned int SpatialHashGrid::Acquire(const int x, const int y, const int z)
+{
+    // Keep the load factor under 1/2 so probe sequences stay short.
+    if ((cell_count + 1) * 2 > slots.size()) {
+        Grow();
+    }
+    unsigned int i = Hash(x, y, z);
+    for (; slots[i].head != none; i = (i + 1) & mask) {
+        if (slots[i].x == x && slots[i].y == y && slots[i].z == z) {
+            return i;
+        }
+    }
+    slots[i].x = x;
+    slots[i].y = y;
+    slots[i].z = z;
+    cell_count++;
+    return i;
+}
+
+void SpatialHashGrid::Release(unsigned int hole)
+{
+    slots[hole].head = none;
+    cell_count--;
+
+    // Backward shift: pull later entries of the probe run into the hole when the hole lies
+    // between their home slot and their current slot.
+    for (unsigned int j = (hole + 1) & mask; slots[j].head != none; j = (j + 1) & mask) {
+        const unsigned int home = Hash(slots[j].x, slots[j].y, slots[j].z);
+        const bool movable = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (movable) {
+            slots[hole] = slots[j];
+            slots[j].head = none;
+            hole = j;
+        }
+    }
+}
+
+void SpatialHashGrid::Grow()
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+
+    Slot empty = {0, 0, 0, none};
+    slots.assign(old.size() * 2, empty);
+    mask = (unsigned int) slots.size() - 1;
+
+    for (size_t k = 0; k < old.size(); k++) {
+        if (old[k].head == none) {
+            continue;
+        }
+        unsigned int i = Hash(old[k].x, old[k].y, old[k].z);
+        while (slots[i].head != none) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = old[k];
+    }
+}
+
+void SpatialHashGrid::Link(const unsigned int id)
+{
+    Item &item = items[id];
+    // The slot only counts as occupied once its head is set.
+    const unsigned int slot = Acquire(item.x, item.y, item.z);
+    const unsigned int head = slots[slot].head;
+
+    item.prev = none;
+    item.next = head;
+    if (head != none) {
+        items[head].prev = id;
+    }
+    slots[slot].head = id;
+}
+
+void SpatialHashGrid::Unlink(const unsigned int id)
+{
+    const Item &item = items[id];
+    if (item.next != none) {
+        items[item.next].prev = item.prev;
+    }
+    if (item.prev != none) {
+        items[item.prev].next = item.next;
+        return;
+    }
+    const unsigned int slot = Find(item.x, item.y, item.z);
+    if (item.next != none) {
+        slots[slot].head = item.next;
+    } else {
+        Release(slot);
+    }
+}
+
+void SpatialHashGrid::Insert(const unsigned int id, const Vector3 &p)
+{
+    if (id >= items.size()) {
+        Item dead;
+        dead.alive = false;
+        items.resize(id + 1, dead);
+    }
+    if (items[id].alive) {
+        Update(id, p);
+        return;
+    }
+    Item &item = items[id];
+    item.p = p;
+    item.x = Coord(p.x);
+    item.y = Coord(p.y);
+    item.z = Coord(p.z);
+    item.alive = true;
+    Link(id);
+    item_count++;
+}
+
+void SpatialHashGrid::Remove(const unsigned int id)
+{
+    if (!Contains(id)) {
+        return;
+    }
+    Unlink(id);
+    items[id].alive = false;
+    item_count--;
+}
+
+void SpatialHashGrid::Update(const unsigned int id, const Vector3 &p)
+{
+    if (!Contains(id)) {
+        Insert(id, p);
+        return;
+    }
+    Item &item = items[id];
+    item.p = p;
+    const int x = Coord(p.x), y = Coord(p.y), z = Coord(p.z);
+    if (x == item.x && y == item.y && z == item.z) {
+        return;
+    }
+    Unlink(id);
+    item.x = x;
+    item.y = y;
+    item.z = z;
+    Link(id);
+}
+
+void SpatialHashGrid::Query(const Vector3 &center, const float radius, std::vector<unsigned int> &ids) const
+{
+    Query(center, radius, [&](unsigned int id, const Vector3 &) {
+        ids.push_back(id);
+    });
+}
+
+unsigned int SpatialHashGrid::Weld(const Vector3 *points, const unsigned int count, const float tolerance,
+                                   unsigned int *remap)
+{
+    // With cells as wide as the tolerance, any match lies in the 27 cells around a point.
+    SpatialHashGrid grid(tolerance > 0.f ? tolerance : 1e-6f);
+    grid.Reserve(count);
+
+    unsigned int unique = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int match = none;
+        float match_d2 = 3.4e38f;
+        const Vector3 &p = points[i];
+
+        // Only representatives are in the grid; weld to the closest one.
+        grid.Query(p, tolerance, [&](unsigned int id, const Vector3 &q) {
+            const float dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+            const float d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 < match_d2 || (d2 == match_d2 && id < match)) {
+                match = id;
+                match_d2 = d2;
+            }
+        });
+
+        if (match != none) {
+            remap[i] = remap[match];
+        } else {
+            remap[i] = unique++;
+            grid.Insert(i, p);
+        }
+    }
+    return unique;
+}
@@ -0,0 +1,130 @@
+#ifndef __BCOSTA_SPATIAL_HASH__
+#define __BCOSTA_SPATIAL_HASH__
+
+#include <vector>
+#include "vector.h"
+
+namespace BCosta
+{
+    // Uniform grid over unbounded space, hashing occupied cells into an open-addressing
+    // table (linear probing, backward-shift deletion, so no tombstones build up under
+    // churn). Each cell heads an intrusive list of the items it contains.
+    //
+    // Items are identified by caller-chosen ids (typically the index of the point in the
+    // caller's arrays), and can be inserted, moved and removed at any time.
+    class SpatialHashGrid
+    {
+    public:
+
+        static const unsigned int none = 0xffffffff;
+
+        SpatialHashGrid(const float cell_size = 1.f);
+
+        float CellSize() const
+        { return cell_size; }
+
+        // Drop every item. 'cell_size' changes only take effect on an empty grid.
+        void Clear(const float cell_size = 0.f);
+
+        void Reserve(const unsigned int item_count);
+
+        unsigned int Size() const
+        { return item_count; }
+
+        void Insert(const unsigned int id, const Vector3 &p);
+
+        void Remove(const unsigned int id);
+
+        // Move an item; only relinks it when it changes cell.
+        void Update(const unsigned int id, const Vector3 &p);
+
+        bool Contains(const unsigned int id) const
+        { return id < items.size() && items[id].alive; }
+
+        // Call visit(id, position) for every item within 'radius' of 'center'.
+        template<typename F>
+        void Query(const Vector3 &center, const float radius, F visit) const
+        {
+            const int x0 = Coord(center.x - radius), x1 = Coord(center.x + radius);
+            const int y0 = Coord(center.y - radius), y1 = Coord(center.y + radius);
+            const int z0 = Coord(center.z - radius), z1 = Coord(center.z + radius);
+            const float r2 = radius * radius;
+
+            for (int z = z0; z <= z1; z++) {
+                for (int y = y0; y <= y1; y++) {
+                    for (int x = x0; x <= x1; x++) {
+                        const unsigned int slot = Find(x, y, z);
+                        if (slot == none) {
+                            continue;
+                        }
+                        for (unsigned int id = slots[slot].head; id != none; id = items[id].next) {
+                            const Vector3 &p = items[id].p;
+                            const float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+                            if (dx * dx + dy * dy + dz * dz <= r2) {
+                                visit(id, p);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Append the ids of the items within 'radius' of 'center'.
+        void Query(const Vector3 &center, const float radius, std::vector<unsigned int> &ids) const;
+
+        // Merge points closer than 'tolerance' in one linear pass. Point i becomes unique
+        // point remap[i]; unique point k is the first point mapped to k, so unique points
+        // keep the order of first appearance. Returns the unique point count.
+        static unsigned int Weld(const Vector3 *points, const unsigned int count, const float tolerance,
+                                 unsigned int *remap);
+
+    private:
+
+        struct Slot
+        {
+            int x, y, z;
+            unsigned int head;
+        };
+
+        // Items keep their cell coordinates rather than a slot index, since slots move
+        // when the table grows or a neighboring cell is released.
+        struct Item
+        {
+            Vector3 p;
+            int x, y, z;
+            unsigned int next, prev;
+            bool alive;
+        };
+
+        int Coord(const float v) const
+        { return (int) floorf(v * inv_cell_size); }
+
+        unsigned int Hash(const int x, const int y, const int z) const
+        { return ((unsigned int) x * 73856093u ^ (unsigned int) y * 19349663u ^ (unsigned int) z * 83492791u) & mask; }
+
+        // Slot of an occupied cell, or none.
+        unsigned int Find(const int x, const int y, const int z) const;
+
+        // Slot of the cell, created if needed.
+        unsigned int Acquire(const int x, const int y, const int z);
+
+        void Release(unsigned int slot);
+
+        void Grow();
+
+        void Link(const unsigned int id);
+
+        void Unlink(const unsigned int id);
+
+        float cell_size;
+        float inv_cell_size;
+
+        std::vector<Slot> slots;
+        unsigned int mask;
+        unsigned int cell_count;
+
+        std::vector<Item> items;
+        unsigned int item_count;
+    };
+}
+#endif // __BCOSTA_SPATIAL_HASH__
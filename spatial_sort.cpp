@@ -0,0 +1,271 @@
+#include <string.h>
+#include <vector>
+#include "spatial_sort.h"
+#include "matrix4.h"
+#include "parallel.h"
+
+using namespace BCosta;
+using namespace BCosta::SpatialSort;
+
+static const unsigned int grain = 16384;
+
+namespace
+{
+    // Maps positions of the box to integer cells [0, 2^bits - 1] per axis.
+    struct Quantizer
+    {
+        float min_x, min_y, min_z;
+        float scale_x, scale_y, scale_z;
+        float top;
+
+        Quantizer(const Vector3 &min, const Vector3 &max, const unsigned int bits)
+        {
+            top = (float) ((1u << bits) - 1);
+            min_x = min.x;
+            min_y = min.y;
+            min_z = min.z;
+            scale_x = max.x > min.x ? top / (max.x - min.x) : 0.f;
+            scale_y = max.y > min.y ? top / (max.y - min.y) : 0.f;
+            scale_z = max.z > min.z ? top / (max.z - min.z) : 0.f;
+        }
+
+        unsigned int Cell(const float v, const float min, const float scale) const
+        {
+            const float q = (v - min) * scale;
+            return (unsigned int) (q < 0.f ? 0.f : (q > top ? top : q));
+        }
+    };
+
+    // Skilling's transform of axes coordinates into the "transposed" Hilbert index, whose
+    // bits, interleaved x-first, give the Hilbert key.
+    template<typename T>
+    void AxesToTranspose(T X[3], const unsigned int bits)
+    {
+        const T M = (T) 1 << (bits - 1);
+
+        for (T Q = M; Q > 1; Q >>= 1) {
+            const T P = Q - 1;
+            for (unsigned int i = 0; i < 3; i++) {
+                if (X[i] & Q) {
+                    X[0] ^= P;
+                } else {
+                    const T t = (X[0] ^ X[i]) & P;
+                    X[0] ^= t;
+                    X[i] ^= t;
+                }
+            }
+        }
+
+        X[1] ^= X[0];
+        X[2] ^= X[1];
+
+        T t = 0;
+        for (T Q = M; Q > 1; Q >>= 1) {
+            if (X[2] & Q) {
+                t ^= Q - 1;
+            }
+        }
+        for (unsigned int i = 0; i < 3; i++) {
+            X[i] ^= t;
+        }
+    }
+
+    template<typename K>
+    void RadixSort(const K *codes, const unsigned int count, unsigned int *permutation)
+    {
+        const unsigned int radix = 256;
+        const unsigned int passes = sizeof(K);
+
+        unsigned int chunks = count / grain;
+        chunks = chunks < 1 ? 1 : (chunks > Parallel::ThreadCount() ? Parallel::ThreadCount() : chunks);
+
+        std::vector<K> keys(codes, codes + count), keys_tmp(count);
+        std::vector<unsigned int> values(count), values_tmp(count);
+        std::vector<unsigned int> offsets(chunks * radix);
+        for (unsigned int i = 0; i < count; i++) {
+            values[i] = i;
+        }
+
+        K *src_keys = keys.data(), *dst_keys = keys_tmp.data();
+        unsigned int *src_values = values.data(), *dst_values = values_tmp.data();
+
+        for (unsigned int pass = 0; pass < passes; pass++) {
+            const unsigned int shift = pass * 8;
+
+            // Per-chunk digit histograms.
+            Parallel::For(chunks, 1, [&](unsigned int first, unsigned int end) {
+                for (unsigned int c = first; c < end; c++) {
+                    unsigned int *hist = &offsets[c * radix];
+                    memset(hist, 0, radix * sizeof(unsigned int));
+                    const unsigned int b = (unsigned int) ((unsigned long long) count * c / chunks);
+                    const unsigned int e = (unsigned int) ((unsigned long long) count * (c + 1) / chunks);
+                    for (unsigned int i = b; i < e; i++) {
+                        hist[(src_keys[i] >> shift) & (radix - 1)]++;
+                    }
+                }
+            });
+
+            // Digit-major, chunk-minor exclusive scan gives each chunk its write cursors.
+            // A digit shared by every key means the pass would not move anything.
+            bool trivial = false;
+            unsigned int running = 0;
+            for (unsigned int d = 0; d < radix; d++) {
+                unsigned int digit_total = 0;
+                for (unsigned int c = 0; c < chunks; c++) {
+                    const unsigned int n = offsets[c * radix + d];
+                    offsets[c * radix + d] = running;
+                    running += n;
+                    digit_total += n;
+                }
+                if (digit_total == count) {
+                    trivial = true;
+                }
+            }
+            if (trivial) {
+                continue;
+            }
+
+            Parallel::For(chunks, 1, [&](unsigned int first, unsigned int end) {
+                for (unsigned int c = first; c < end; c++) {
+                    unsigned int *cursor = &offsets[c * radix];
+                    const unsigned int b = (unsigned int) ((unsigned long long) count * c / chunks);
+                    const unsigned int e = (unsigned int) ((unsigned long long) count * (c + 1) / chunks);
+                    for (unsigned int i = b; i < e; i++) {
+                        const unsigned int to = cursor[(src_keys[i] >> shift) & (radix - 1)]++;
+                        dst_keys[to] = src_keys[i];
+                        dst_values[to] = src_values[i];
+                    }
+                }
+            });
+
+            K *k = src_keys;
+            src_keys = dst_keys;
+            dst_keys = k;
+            unsigned int *v = src_values;
+            src_values = dst_values;
+            dst_values = v;
+        }
+
+        memcpy(permutation, src_values, count * sizeof(unsigned int));
+    }
+
+    template<typename T>
+    void ParallelGather(const T *src, const unsigned int *permutation, const unsigned int count, T *dst)
+    {
+        Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+            SpatialSort::Gather<T>(src, permutation + first, end - first, dst + first);
+        });
+    }
+}
+
+unsigned int SpatialSort::Hilbert30(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+    unsigned int X[3] = {x & 0x3ff, y & 0x3ff, z & 0x3ff};
+    AxesToTranspose(X, 10);
+    return (Spread10(X[0]) << 2) | (Spread10(X[1]) << 1) | Spread10(X[2]);
+}
+
+unsigned long long SpatialSort::Hilbert63(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+    unsigned long long X[3] = {x & 0x1fffffu, y & 0x1fffffu, z & 0x1fffffu};
+    AxesToTranspose(X, 21);
+    return (Spread21(X[0]) << 2) | (Spread21(X[1]) << 1) | Spread21(X[2]);
+}
+
+void SpatialSort::EncodeMorton30(const Vector3 *positions, const unsigned int count,
+                                 const Vector3 &min, const Vector3 &max, unsigned int *codes)
+{
+    const Quantizer q(min, max, 10);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Vector3 &p = positions[i];
+            codes[i] = Morton30(q.Cell(p.x, q.min_x, q.scale_x), q.Cell(p.y, q.min_y, q.scale_y),
+                                q.Cell(p.z, q.min_z, q.scale_z));
+        }
+    });
+}
+
+void SpatialSort::EncodeMorton30(const Vector3SoA &positions, const unsigned int count,
+                                 const Vector3 &min, const Vector3 &max, unsigned int *codes)
+{
+    const Quantizer q(min, max, 10);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        const float *x = positions.x, *y = positions.y, *z = positions.z;
+        for (unsigned int i = first; i < end; i++) {
+            codes[i] = Morton30(q.Cell(x[i], q.min_x, q.scale_x), q.Cell(y[i], q.min_y, q.scale_y),
+                                q.Cell(z[i], q.min_z, q.scale_z));
+        }
+    });
+}
+
+void SpatialSort::EncodeMorton63(const Vector3 *positions, const unsigned int count,
+                                 const Vector3 &min, const Vector3 &max, unsigned long long *codes)
+{
+    const Quantizer q(min, max, 21);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Vector3 &p = positions[i];
+            codes[i] = Morton63(q.Cell(p.x, q.min_x, q.scale_x), q.Cell(p.y, q.min_y, q.scale_y),
+                                q.Cell(p.z, q.min_z, q.scale_z));
+        }
+    });
+}
+
+void SpatialSort::EncodeHilbert30(const Vector3 *positions, const unsigned int count,
+                                  const Vector3 &min, const Vector3 &max, unsigned int *codes)
+{
+    const Quantizer q(min, max, 10);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Vector3 &p = positions[i];
+            codes[i] = Hilbert30(q.Cell(p.x, q.min_x, q.scale_x), q.Cell(p.y, q.min_y, q.scale_y),
+                                 q.Cell(p.z, q.min_z, q.scale_z));
+        }
+    });
+}
+
+void SpatialSort::EncodeHilbert63(const Vector3 *positions, const unsigned int count,
+                                  const Vector3 &min, const Vector3 &max, unsigned long long *codes)
+{
+    const Quantizer q(min, max, 21);
+    Parallel::For(count, grain, [&](unsigned int first, unsigned int end) {
+        for (unsigned int i = first; i < end; i++) {
+            const Vector3 &p = positions[i];
+            codes[i] = Hilbert63(q.Cell(p.x, q.min_x, q.scale_x), q.Cell(p.y, q.min_y, q.scale_y),
+                                 q.Cell(p.z, q.min_z, q.scale_z));
+        }
+    });
+}
+
+void SpatialSort::SortPermutation(const unsigned int *codes, const unsigned int count, unsigned int *permutation)
+{ RadixSort(codes, count, permutation); }
+
+void SpatialSort::SortPermutation(const unsigned long long *codes, const unsigned int count, unsigned int *permutation)
+{ RadixSort(codes, count, permutation); }
+
+void SpatialSort::Gather(const Vector3SoA &src, const unsigned int *permutation, const unsigned int count,
+                         const Vector3SoA &dst)
+{
+    ParallelGather(src.x, permutation, count, dst.x);
+    ParallelGather(src.y, permutation, count, dst.y);
+    ParallelGather(src.z, permutation, count, dst.z);
+}
+
+void SpatialSort::Gather(const QuaternionSoA &src, const unsigned int *permutation, const unsigned int count,
+                         const QuaternionSoA &dst)
+{
+    ParallelGather(src.x, permutation, count, dst.x);
+    ParallelGather(src.y, permutation, count, dst.y);
+    ParallelGather(src.z, permutation, count, dst.z);
+    ParallelGather(src.w, permutation, count, dst.w);
+}
+
+void SpatialSort::Gather(const Vector3 *src, const unsigned int *permutation, const unsigned int count, Vector3 *dst)
+{ ParallelGather(src, permutation, count, dst); }
+
+void SpatialSort::Gather(const Quaternion *src, const unsigned int *permutation, const unsigned int count,
+                         Quaternion *dst)
+{ ParallelGather(src, permutation, count, dst); }
+
+void SpatialSort::Gather(const Matrix4 *src, const unsigned int *permutation, const unsigned int count, Matrix4 *dst)
+{ ParallelGather(src, permutation, count, dst); }
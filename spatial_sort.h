@@ -0,0 +1,106 @@
+#ifndef __BCOSTA_SPATIAL_SORT__
+#define __BCOSTA_SPATIAL_SORT__
+
+#include "soa.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    // Space-filling curve keys and locality reordering of point arrays.
+    //
+    // Positions are quantized against a [min, max] box to 10 bits per axis (30-bit keys) or
+    // 21 bits per axis (63-bit keys). Morton keys interleave the axis bits, Hilbert keys
+    // follow a curve with no long jumps between consecutive cells, which is slightly better
+    // for locality at a higher encoding cost.
+    namespace SpatialSort
+    {
+        // Spread the low 10 (resp. 21) bits of 'v' so there are two zero bits between each.
+        inline unsigned int Spread10(unsigned int v)
+        {
+            v &= 0x3ff;
+            v = (v | (v << 16)) & 0x030000ff;
+            v = (v | (v << 8)) & 0x0300f00f;
+            v = (v | (v << 4)) & 0x030c30c3;
+            v = (v | (v << 2)) & 0x09249249;
+            return v;
+        }
+
+        inline unsigned long long Spread21(unsigned long long v)
+        {
+            v &= 0x1fffff;
+            v = (v | (v << 32)) & 0x1f00000000ffffULL;
+            v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+            v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+            v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+            v = (v | (v << 2)) & 0x1249249249249249ULL;
+            return v;
+        }
+
+        inline unsigned int Morton30(const unsigned int x, const unsigned int y, const unsigned int z)
+        { return Spread10(x) | (Spread10(y) << 1) | (Spread10(z) << 2); }
+
+        inline unsigned long long Morton63(const unsigned int x, const unsigned int y, const unsigned int z)
+        { return Spread21(x) | (Spread21(y) << 1) | (Spread21(z) << 2); }
+
+        unsigned int Hilbert30(const unsigned int x, const unsigned int y, const unsigned int z);
+
+        unsigned long long Hilbert63(const unsigned int x, const unsigned int y, const unsigned int z);
+
+        // Batch encoders. Points outside [min, max] are clamped to the boundary cells.
+        void EncodeMorton30(const Vector3 *positions, const unsigned int count,
+                            const Vector3 &min, const Vector3 &max, unsigned int *codes);
+
+        void EncodeMorton30(const Vector3SoA &positions, const unsigned int count,
+                            const Vector3 &min, const Vector3 &max, unsigned int *codes);
+
+        void EncodeMorton63(const Vector3 *positions, const unsigned int count,
+                            const Vector3 &min, const Vector3 &max, unsigned long long *codes);
+
+        void EncodeHilbert30(const Vector3 *positions, const unsigned int count,
+                             const Vector3 &min, const Vector3 &max, unsigned int *codes);
+
+        void EncodeHilbert63(const Vector3 *positions, const unsigned int count,
+                             const Vector3 &min, const Vector3 &max, unsigned long long *codes);
+
+        // Parallel LSD radix sort of the keys, producing 'permutation' such that
+        // codes[permutation[0]] <= codes[permutation[1]] <= ... The sort is stable and
+        // 'codes' is left untouched.
+        void SortPermutation(const unsigned int *codes, const unsigned int count, unsigned int *permutation);
+
+        void SortPermutation(const unsigned long long *codes, const unsigned int count, unsigned int *permutation);
+
+        // dst[i] = src[permutation[i]]: pulls elements into sorted order.
+        template<typename T>
+        void Gather(const T *src, const unsigned int *permutation, const unsigned int count, T *dst)
+        {
+            for (unsigned int i = 0; i < count; i++) {
+                dst[i] = src[permutation[i]];
+            }
+        }
+
+        // dst[permutation[i]] = src[i]: inverse of Gather, e.g. to bring results computed in
+        // sorted order back to the original order.
+        template<typename T>
+        void Scatter(const T *src, const unsigned int *permutation, const unsigned int count, T *dst)
+        {
+            for (unsigned int i = 0; i < count; i++) {
+                dst[permutation[i]] = src[i];
+            }
+        }
+
+        void Gather(const Vector3SoA &src, const unsigned int *permutation, const unsigned int count,
+                    const Vector3SoA &dst);
+
+        void Gather(const QuaternionSoA &src, const unsigned int *permutation, const unsigned int count,
+                    const QuaternionSoA &dst);
+
+        // Parallel gathers for the common array types.
+        void Gather(const Vector3 *src, const unsigned int *permutation, const unsigned int count, Vector3 *dst);
+
+        void Gather(const Quaternion *src, const unsigned int *permutation, const unsigned int count, Quaternion *dst);
+
+        void Gather(const Matrix4 *src, const unsigned int *permutation, const unsigned int count, Matrix4 *dst);
+    }
+}
+#endif // __BCOSTA_SPATIAL_SORT__
@@ -0,0 +1,196 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "parallel.h"
+#include "sprite.h"
+#include "sse_math.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 8192;
+
+// Sprites per culling chunk; chunks are compacted independently, then joined.
+static const unsigned int chunk = 4096;
+
+namespace
+{
+#ifdef __SSE2__
+    // Interleave the corners of four sprites into their vertex order: two vectors of two
+    // corners each per sprite.
+    void Interleave(const __m128 *cx, const __m128 *cy, __m128 quads[8])
+    {
+        const __m128 c0_lo = _mm_unpacklo_ps(cx[0], cy[0]), c0_hi = _mm_unpackhi_ps(cx[0], cy[0]);
+        const __m128 c1_lo = _mm_unpacklo_ps(cx[1], cy[1]), c1_hi = _mm_unpackhi_ps(cx[1], cy[1]);
+        const __m128 c2_lo = _mm_unpacklo_ps(cx[2], cy[2]), c2_hi = _mm_unpackhi_ps(cx[2], cy[2]);
+        const __m128 c3_lo = _mm_unpacklo_ps(cx[3], cy[3]), c3_hi = _mm_unpackhi_ps(cx[3], cy[3]);
+
+        quads[0] = _mm_movelh_ps(c0_lo, c1_lo);
+        quads[1] = _mm_movelh_ps(c2_lo, c3_lo);
+        quads[2] = _mm_movehl_ps(c1_lo, c0_lo);
+        quads[3] = _mm_movehl_ps(c3_lo, c2_lo);
+        quads[4] = _mm_movelh_ps(c0_hi, c1_hi);
+        quads[5] = _mm_movelh_ps(c2_hi, c3_hi);
+        quads[6] = _mm_movehl_ps(c1_hi, c0_hi);
+        quads[7] = _mm_movehl_ps(c3_hi, c2_hi);
+    }
+#endif
+
+    // Corners of sprite i: origin, origin + u, origin + u + w, origin + w, where u and w are
+    // the view-space images of the quad's scaled edges.
+    void Quad(const SpriteSoA &sprites, const unsigned int i, const Affine2 &view, float *out)
+    {
+        const float *v = view.m;
+        const float c = cosf(sprites.rotation[i]), s = sinf(sprites.rotation[i]);
+        const float a = c * sprites.scale_x[i], b = s * sprites.scale_x[i];
+        const float d = -s * sprites.scale_y[i], e = c * sprites.scale_y[i];
+
+        const float ux = a * v[0] + b * v[2], uy = a * v[1] + b * v[3];
+        const float wx = d * v[0] + e * v[2], wy = d * v[1] + e * v[3];
+        const float px = sprites.x[i] * v[0] + sprites.y[i] * v[2] + v[4];
+        const float py = sprites.x[i] * v[1] + sprites.y[i] * v[3] + v[5];
+        const float ox = px - sprites.pivot_x[i] * ux - sprites.pivot_y[i] * wx;
+        const float oy = py - sprites.pivot_x[i] * uy - sprites.pivot_y[i] * wy;
+
+        out[0] = ox;
+        out[1] = oy;
+        out[2] = ox + ux;
+        out[3] = oy + uy;
+        out[4] = ox + ux + wx;
+        out[5] = oy + uy + wy;
+        out[6] = ox + wx;
+        out[7] = oy + wy;
+    }
+
+    bool Overlaps(const float *q, const Rect &r)
+    {
+        const float min_x = fminf(fminf(q[0], q[2]), fminf(q[4], q[6]));
+        const float max_x = fmaxf(fmaxf(q[0], q[2]), fmaxf(q[4], q[6]));
+        const float min_y = fminf(fminf(q[1], q[3]), fminf(q[5], q[7]));
+        const float max_y = fmaxf(fmaxf(q[1], q[3]), fmaxf(q[5], q[7]));
+        return max_x >= r.min.x && min_x <= r.max.x && max_y >= r.min.y && min_y <= r.max.y;
+    }
+
+    // Sprites [begin, end) to out + begin * 8. With Cull, survivors are packed from there
+    // and counted; otherwise every sprite is written in place.
+    template<bool Cull>
+    unsigned int Run(const SpriteSoA &sprites, const unsigned int begin, const unsigned int end,
+                     const Affine2 &view, const Rect &cull, float *vertices, unsigned int *indices)
+    {
+        float *out = vertices + (size_t) begin * 8;
+        unsigned int *out_indices = indices ? indices + begin : 0;
+        unsigned int n = 0;
+        unsigned int i = begin;
+
+#ifdef __SSE2__
+        const __m128 v0 = _mm_set1_ps(view.m[0]), v1 = _mm_set1_ps(view.m[1]), v2 = _mm_set1_ps(view.m[2]);
+        const __m128 v3 = _mm_set1_ps(view.m[3]), v4 = _mm_set1_ps(view.m[4]), v5 = _mm_set1_ps(view.m[5]);
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 s, c;
+            Sse::SinCos(_mm_loadu_ps(sprites.rotation + i), s, c);
+            const __m128 scale_x = _mm_loadu_ps(sprites.scale_x + i), scale_y = _mm_loadu_ps(sprites.scale_y + i);
+            const __m128 a = _mm_mul_ps(c, scale_x), b = _mm_mul_ps(s, scale_x);
+            const __m128 d = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(s, scale_y)), e = _mm_mul_ps(c, scale_y);
+
+            const __m128 ux = _mm_add_ps(_mm_mul_ps(a, v0), _mm_mul_ps(b, v2));
+            const __m128 uy = _mm_add_ps(_mm_mul_ps(a, v1), _mm_mul_ps(b, v3));
+            const __m128 wx = _mm_add_ps(_mm_mul_ps(d, v0), _mm_mul_ps(e, v2));
+            const __m128 wy = _mm_add_ps(_mm_mul_ps(d, v1), _mm_mul_ps(e, v3));
+
+            const __m128 x = _mm_loadu_ps(sprites.x + i), y = _mm_loadu_ps(sprites.y + i);
+            const __m128 pivot_x = _mm_loadu_ps(sprites.pivot_x + i), pivot_y = _mm_loadu_ps(sprites.pivot_y + i);
+            const __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, v0), _mm_mul_ps(y, v2)), v4);
+            const __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, v1), _mm_mul_ps(y, v3)), v5);
+
+            __m128 cx[4], cy[4];
+            cx[0] = _mm_sub_ps(_mm_sub_ps(px, _mm_mul_ps(pivot_x, ux)), _mm_mul_ps(pivot_y, wx));
+            cy[0] = _mm_sub_ps(_mm_sub_ps(py, _mm_mul_ps(pivot_x, uy)), _mm_mul_ps(pivot_y, wy));
+            cx[1] = _mm_add_ps(cx[0], ux);
+            cy[1] = _mm_add_ps(cy[0], uy);
+            cx[2] = _mm_add_ps(cx[1], wx);
+            cy[2] = _mm_add_ps(cy[1], wy);
+            cx[3] = _mm_add_ps(cx[0], wx);
+            cy[3] = _mm_add_ps(cy[0], wy);
+
+            __m128 quads[8];
+            if (!Cull) {
+                Interleave(cx, cy, quads);
+                for (unsigned int k = 0; k < 8; k++) {
+                    _mm_storeu_ps(out + (i - begin) * 8 + k * 4, quads[k]);
+                }
+                continue;
+            }
+
+            const __m128 min_x = _mm_min_ps(_mm_min_ps(cx[0], cx[1]), _mm_min_ps(cx[2], cx[3]));
+            const __m128 max_x = _mm_max_ps(_mm_max_ps(cx[0], cx[1]), _mm_max_ps(cx[2], cx[3]));
+            const __m128 min_y = _mm_min_ps(_mm_min_ps(cy[0], cy[1]), _mm_min_ps(cy[2], cy[3]));
+            const __m128 max_y = _mm_max_ps(_mm_max_ps(cy[0], cy[1]), _mm_max_ps(cy[2], cy[3]));
+            const __m128 inside = _mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(max_x, _mm_set1_ps(cull.min.x)), _mm_cmple_ps(min_x, _mm_set1_ps(cull.max.x))),
+                _mm_and_ps(_mm_cmpge_ps(max_y, _mm_set1_ps(cull.min.y)), _mm_cmple_ps(min_y, _mm_set1_ps(cull.max.y))));
+            const int mask = _mm_movemask_ps(inside);
+            if (!mask) {
+                continue;
+            }
+
+            // Store every lane at the packed position and advance past the visible ones; n
+            // never exceeds the sprite index, so nothing unprocessed is overwritten.
+            Interleave(cx, cy, quads);
+            for (unsigned int k = 0; k < 4; k++) {
+                _mm_storeu_ps(out + n * 8, quads[k * 2]);
+                _mm_storeu_ps(out + n * 8 + 4, quads[k * 2 + 1]);
+                if (out_indices) {
+                    out_indices[n] = i + k;
+                }
+                n += (mask >> k) & 1;
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            float *q = out + (Cull ? n : i - begin) * 8;
+            Quad(sprites, i, view, q);
+            if (Cull && Overlaps(q, cull)) {
+                if (out_indices) {
+                    out_indices[n] = i;
+                }
+                n++;
+            }
+        }
+        return n;
+    }
+}
+
+void Sprites::Transform(const SpriteSoA &sprites, const unsigned int count, const Affine2 &view, float *vertices)
+{
+    const Rect none = {};
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        Run<false>(sprites, begin, end, view, none, vertices, 0);
+    });
+}
+
+unsigned int Sprites::TransformCulled(const SpriteSoA &sprites, const unsigned int count, const Affine2 &view,
+                                      const Rect &cull, float *vertices, unsigned int *indices)
+{
+    const unsigned int chunks = (count + chunk - 1) / chunk;
+    std::vector<unsigned int> survivors(chunks);
+
+    Parallel::For(chunks, grain / chunk, [&](unsigned int first, unsigned int last) {
+        for (unsigned int c = first; c < last; c++) {
+            const unsigned int end = (c + 1) * chunk < count ? (c + 1) * chunk : count;
+            survivors[c] = Run<true>(sprites, c * chunk, end, view, cull, vertices, indices);
+        }
+    });
+
+    // Join the packed chunks; each moves left, so in order they never overlap a later one.
+    unsigned int total = 0;
+    for (unsigned int c = 0; c < chunks; c++) {
+        if (total != c * chunk) {
+            memmove(vertices + (size_t) total * 8, vertices + (size_t) c * chunk * 8, (size_t) survivors[c] * 8 * sizeof(float));
+            if (indices) {
+                memmove(indices + total, indices + c * chunk, survivors[c] * sizeof(unsigned int));
+            }
+        }
+        total += survivors[c];
+    }
+    return total;
+}
@@ -0,0 +1,43 @@
+#ifndef __BCOSTA_SPRITE__
+#define __BCOSTA_SPRITE__
+
+#include "affine2.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Sprite instances as component streams. A sprite is a unit quad scaled to
+    // (scale_x, scale_y), rotated counter-clockwise by 'rotation' radians about its pivot and
+    // placed with the pivot at (x, y). Pivots are in quad units: (0, 0) is a corner,
+    // (.5, .5) the center.
+    struct SpriteSoA
+    {
+        float *x, *y;
+        float *rotation;
+        float *scale_x, *scale_y;
+        float *pivot_x, *pivot_y;
+    };
+
+    struct Rect
+    {
+        Vector2 min, max;
+    };
+
+    // Quad corner generation for large sprite and UI batches. Each sprite becomes four
+    // (x, y) vertices, eight floats, in the order (0, 0), (1, 0), (1, 1), (0, 1) of the unit
+    // quad, transformed by the sprite and then by 'view'. Sprites are processed four at a
+    // time on SSE2, in parallel ranges.
+    namespace Sprites
+    {
+        // 'vertices' holds count * 8 floats.
+        void Transform(const SpriteSoA &sprites, const unsigned int count, const Affine2 &view, float *vertices);
+
+        // Same, dropping sprites whose transformed bounds miss 'cull' (in view space).
+        // Surviving sprites are packed at the start of 'vertices' in their original order,
+        // their indices written to 'indices' (may be null). Returns how many survived.
+        // 'vertices' and 'indices' still need room for all count sprites.
+        unsigned int TransformCulled(const SpriteSoA &sprites, const unsigned int count, const Affine2 &view,
+                                     const Rect &cull, float *vertices, unsigned int *indices);
+    }
+}
+#endif // __BCOSTA_SPRITE__
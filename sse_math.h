@@ -0,0 +1,158 @@
+#ifndef __BCOSTA_SSE_MATH__
+#define __BCOSTA_SSE_MATH__
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+namespace BCosta
+{
+    // Four-lane transcendental helpers shared by the SSE batch kernels.
+    namespace Sse
+    {
+        // Sine and cosine: octant reduction by pi / 4 in three parts, then the minimax
+        // polynomials of the Cephes library. About 1e-7 absolute error for |a| < 8192.
+        inline void SinCos(const __m128 a, __m128 &sin_out, __m128 &cos_out)
+        {
+            const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32((int) 0x80000000));
+            __m128 sign_sin = _mm_and_ps(a, sign_mask);
+            __m128 x = _mm_andnot_ps(sign_mask, a);
+
+            // Octant, rounded up to even.
+            __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+            j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+            const __m128 y = _mm_cvtepi32_ps(j);
+
+            const __m128 swap_sin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+            const __m128 use_sin_poly = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)),
+                                                                         _mm_setzero_si128()));
+            const __m128 sign_cos = _mm_castsi128_ps(
+                _mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+            sign_sin = _mm_xor_ps(sign_sin, swap_sin);
+
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+            const __m128 z = _mm_mul_ps(x, x);
+
+            __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z),
+                                  _mm_set1_ps(-1.388731625493765e-3f));
+            c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+            c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+            c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(.5f))), _mm_set1_ps(1.f));
+
+            __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+            s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+            s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+            // Octants 1 and 2 (mod 4) swap the two polynomials.
+            const __m128 sin_value = _mm_or_ps(_mm_and_ps(use_sin_poly, s), _mm_andnot_ps(use_sin_poly, c));
+            const __m128 cos_value = _mm_or_ps(_mm_and_ps(use_sin_poly, c), _mm_andnot_ps(use_sin_poly, s));
+            sin_out = _mm_xor_ps(sin_value, sign_sin);
+            cos_out = _mm_xor_ps(cos_value, sign_cos);
+        }
+
+        // High and low 32 bits of the unsigned products a * b, lane by lane.
+        inline void MulHiLo(const __m128i a, const __m128i b, __m128i &hi, __m128i &lo)
+        {
+            const __m128i even = _mm_mul_epu32(a, b);
+            const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+            hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                                    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+        }
+
+        // Four (x, y, z) triples stored contiguously, as three registers, to one register
+        // per component.
+        inline void Deinterleave3(const __m128 a, const __m128 b, const __m128 c, __m128 &x, __m128 &y, __m128 &z)
+        {
+            x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+            y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+            z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        // Inverse of Deinterleave3.
+        inline void Interleave3(const __m128 x, const __m128 y, const __m128 z, __m128 &a, __m128 &b, __m128 &c)
+        {
+            a = _mm_shuffle_ps(_mm_unpacklo_ps(x, y), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+            b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+            c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        // Four lanes behind the operators and function names of plain float, so kernels
+        // written as templates over the element type run unchanged on one value or four.
+        // Comparisons give lane masks, consumed by Select and Any.
+        struct Float4
+        {
+            __m128 v;
+
+            Float4()
+                : v(_mm_setzero_ps())
+            { }
+
+            Float4(const __m128 _v)
+                : v(_v)
+            { }
+
+            Float4(const float a)
+                : v(_mm_set1_ps(a))
+            { }
+        };
+
+        inline Float4 operator +(const Float4 &a, const Float4 &b)
+        { return _mm_add_ps(a.v, b.v); }
+
+        inline Float4 operator -(const Float4 &a, const Float4 &b)
+        { return _mm_sub_ps(a.v, b.v); }
+
+        inline Float4 operator -(const Float4 &a)
+        { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+
+        inline Float4 operator *(const Float4 &a, const Float4 &b)
+        { return _mm_mul_ps(a.v, b.v); }
+
+        inline Float4 operator /(const Float4 &a, const Float4 &b)
+        { return _mm_div_ps(a.v, b.v); }
+
+        inline Float4 operator <(const Float4 &a, const Float4 &b)
+        { return _mm_cmplt_ps(a.v, b.v); }
+
+        inline Float4 operator >(const Float4 &a, const Float4 &b)
+        { return _mm_cmpgt_ps(a.v, b.v); }
+
+        inline Float4 operator <=(const Float4 &a, const Float4 &b)
+        { return _mm_cmple_ps(a.v, b.v); }
+
+        // Mask intersection.
+        inline Float4 And(const Float4 &a, const Float4 &b)
+        { return _mm_and_ps(a.v, b.v); }
+
+        // mask ? a : b, per lane.
+        inline Float4 Select(const Float4 &mask, const Float4 &a, const Float4 &b)
+        { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+
+        inline bool Any(const Float4 &mask)
+        { return _mm_movemask_ps(mask.v) != 0; }
+
+        inline Float4 Sqrt(const Float4 &a)
+        { return _mm_sqrt_ps(a.v); }
+
+        inline Float4 Abs(const Float4 &a)
+        { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+
+        inline Float4 Min(const Float4 &a, const Float4 &b)
+        { return _mm_min_ps(a.v, b.v); }
+
+        inline Float4 Max(const Float4 &a, const Float4 &b)
+        { return _mm_max_ps(a.v, b.v); }
+
+        inline void SinCos(const Float4 &a, Float4 &sin_out, Float4 &cos_out)
+        { SinCos(a.v, sin_out.v, cos_out.v); }
+    }
+}
+#endif
+#endif // __BCOSTA_SSE_MATH__
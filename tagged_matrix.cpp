@@ -0,0 +1,357 @@
+#include <math.h>
+#include "tagged_matrix.h"
+
+using namespace BCosta;
+
+namespace
+{
+    void SetIdentity(float *m)
+    {
+        for (unsigned int i = 0; i < 16; i++) {
+            m[i] = i % 5 == 0 ? 1.f : 0.f;
+        }
+    }
+
+    // a * b for affine a and b: the upper 3x4 only, last row kept at 0 0 0 1.
+    void AffineProduct(const float *a, const float *b, float *out)
+    {
+        for (unsigned int i = 0; i < 12; i += 4) {
+            for (unsigned int j = 0; j < 4; j++) {
+                out[i + j] = a[i] * b[j] + a[i + 1] * b[4 + j] + a[i + 2] * b[8 + j];
+            }
+            out[i + 3] += a[i + 3];
+        }
+        out[12] = out[13] = out[14] = 0.f;
+        out[15] = 1.f;
+    }
+
+    float Determinant3(const float *m)
+    {
+        return m[0] * (m[5] * m[10] - m[6] * m[9]) - m[1] * (m[4] * m[10] - m[6] * m[8]) +
+               m[2] * (m[4] * m[9] - m[5] * m[8]);
+    }
+
+    // Laplace expansion over the 2x2 minors of the top and bottom row pairs.
+    float Determinant4(const float *m)
+    {
+        const float s0 = m[0] * m[5] - m[1] * m[4],
+            s1 = m[0] * m[6] - m[2] * m[4],
+            s2 = m[0] * m[7] - m[3] * m[4],
+            s3 = m[1] * m[6] - m[2] * m[5],
+            s4 = m[1] * m[7] - m[3] * m[5],
+            s5 = m[2] * m[7] - m[3] * m[6],
+            c5 = m[10] * m[15] - m[11] * m[14],
+            c4 = m[9] * m[15] - m[11] * m[13],
+            c3 = m[9] * m[14] - m[10] * m[13],
+            c2 = m[8] * m[15] - m[11] * m[12],
+            c1 = m[8] * m[14] - m[10] * m[12],
+            c0 = m[8] * m[13] - m[9] * m[12];
+        return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    }
+
+    Vector3 Linear(const float *m, const Vector3 &v)
+    {
+        return Vector3(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z,
+            m[4] * v.x + m[5] * v.y + m[6] * v.z,
+            m[8] * v.x + m[9] * v.y + m[10] * v.z
+        );
+    }
+
+    bool Near(const float a, const float b, const float epsilon)
+    { return fabsf(a - b) <= epsilon; }
+}
+
+TaggedMatrix4::TaggedMatrix4()
+    : kind(Kind_Identity)
+{
+    SetIdentity(matrix.m);
+}
+
+TaggedMatrix4 TaggedMatrix4::Translation(const Vector3 &t)
+{ return TaggedMatrix4(Matrix4::Translation(t), Kind_Translation); }
+
+TaggedMatrix4 TaggedMatrix4::Scale(const Vector3 &s)
+{ return TaggedMatrix4(Matrix4::Scale(s), Kind_Scale); }
+
+TaggedMatrix4 TaggedMatrix4::RotationXAxis(const float a)
+{ return TaggedMatrix4(Matrix4::RotationXAxis(a), Kind_Rotation); }
+
+TaggedMatrix4 TaggedMatrix4::RotationYAxis(const float a)
+{ return TaggedMatrix4(Matrix4::RotationYAxis(a), Kind_Rotation); }
+
+TaggedMatrix4 TaggedMatrix4::RotationZAxis(const float a)
+{ return TaggedMatrix4(Matrix4::RotationZAxis(a), Kind_Rotation); }
+
+TaggedMatrix4 TaggedMatrix4::Rotation(const Quaternion &r)
+{ return TaggedMatrix4(Matrix4::Compose(Vector3(0.f, 0.f, 0.f), r, Vector3(1.f, 1.f, 1.f)), Kind_Rotation); }
+
+TaggedMatrix4 TaggedMatrix4::Compose(const Vector3 &t, const Quaternion &r, const Vector3 &s)
+{
+    const bool unit = s.x == 1.f && s.y == 1.f && s.z == 1.f;
+    return TaggedMatrix4(Matrix4::Compose(t, r, s), unit ? Kind_Rigid : Kind_Affine);
+}
+
+TaggedMatrix4 TaggedMatrix4::Classify(const Matrix4 &m, const float epsilon)
+{
+    const float *a = m.m;
+
+    if (!Near(a[12], 0.f, epsilon) || !Near(a[13], 0.f, epsilon) || !Near(a[14], 0.f, epsilon) ||
+        !Near(a[15], 1.f, epsilon)) {
+        return TaggedMatrix4(m, Kind_Projective);
+    }
+
+    const bool translated = !Near(a[3], 0.f, epsilon) || !Near(a[7], 0.f, epsilon) || !Near(a[11], 0.f, epsilon);
+    const bool diagonal = Near(a[1], 0.f, epsilon) && Near(a[2], 0.f, epsilon) && Near(a[4], 0.f, epsilon) &&
+                          Near(a[6], 0.f, epsilon) && Near(a[8], 0.f, epsilon) && Near(a[9], 0.f, epsilon);
+    const bool unit = Near(a[0], 1.f, epsilon) && Near(a[5], 1.f, epsilon) && Near(a[10], 1.f, epsilon);
+
+    if (diagonal && unit) {
+        return TaggedMatrix4(m, translated ? Kind_Translation : Kind_Identity);
+    }
+    if (diagonal && !translated) {
+        return TaggedMatrix4(m, Kind_Scale);
+    }
+
+    // Orthonormal rows and a positive determinant make a proper rotation.
+    bool orthonormal = Determinant3(a) > 0.f;
+    for (unsigned int i = 0; i < 3 && orthonormal; i++) {
+        for (unsigned int j = i; j < 3 && orthonormal; j++) {
+            const float d = a[i * 4] * a[j * 4] + a[i * 4 + 1] * a[j * 4 + 1] + a[i * 4 + 2] * a[j * 4 + 2];
+            orthonormal = Near(d, i == j ? 1.f : 0.f, epsilon);
+        }
+    }
+    if (orthonormal) {
+        return TaggedMatrix4(m, translated ? Kind_Rigid : Kind_Rotation);
+    }
+    return TaggedMatrix4(m, Kind_Affine);
+}
+
+TaggedMatrix4::Kind TaggedMatrix4::Combine(const Kind a, const Kind b)
+{
+    if (a == Kind_Identity || a == b) {
+        return b;
+    }
+    if (b == Kind_Identity) {
+        return a;
+    }
+    if (a == Kind_Projective || b == Kind_Projective) {
+        return Kind_Projective;
+    }
+    const bool rigid_a = a == Kind_Translation || a == Kind_Rotation || a == Kind_Rigid;
+    const bool rigid_b = b == Kind_Translation || b == Kind_Rotation || b == Kind_Rigid;
+    return rigid_a && rigid_b ? Kind_Rigid : Kind_Affine;
+}
+
+TaggedMatrix4 TaggedMatrix4::operator *(const TaggedMatrix4 &b) const
+{
+    if (kind == Kind_Identity) {
+        return b;
+    }
+    if (b.kind == Kind_Identity) {
+        return *this;
+    }
+
+    TaggedMatrix4 r(b.matrix, Combine(kind, b.kind));
+    const float *x = matrix.m, *y = b.matrix.m;
+    float *o = r.matrix.m;
+
+    if (kind == Kind_Translation) {
+        // Adds t times the last row of b to each of its rows.
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 4; j++) {
+                o[i * 4 + j] += x[i * 4 + 3] * y[12 + j];
+            }
+        }
+    } else if (kind == Kind_Scale) {
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 4; j++) {
+                o[i * 4 + j] *= x[i * 5];
+            }
+        }
+    } else if (b.kind == Kind_Translation) {
+        // Moves the last column by the first three columns applied to t.
+        r.matrix = matrix;
+        for (unsigned int i = 0; i < 4; i++) {
+            o[i * 4 + 3] += x[i * 4] * y[3] + x[i * 4 + 1] * y[7] + x[i * 4 + 2] * y[11];
+        }
+    } else if (b.kind == Kind_Scale) {
+        r.matrix = matrix;
+        for (unsigned int i = 0; i < 4; i++) {
+            o[i * 4] *= y[0];
+            o[i * 4 + 1] *= y[5];
+            o[i * 4 + 2] *= y[10];
+        }
+    } else if (kind == Kind_Rotation && b.kind == Kind_Rotation) {
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 3; j++) {
+                o[i * 4 + j] = x[i * 4] * y[j] + x[i * 4 + 1] * y[4 + j] + x[i * 4 + 2] * y[8 + j];
+            }
+        }
+    } else if (r.kind != Kind_Projective) {
+        AffineProduct(x, y, o);
+    } else {
+        Matrix4 a = matrix;
+        r.matrix = a * b.matrix;
+    }
+    return r;
+}
+
+TaggedMatrix4 TaggedMatrix4::Inverse() const
+{
+    TaggedMatrix4 r(matrix, kind);
+    const float *x = matrix.m;
+    float *o = r.matrix.m;
+
+    switch (kind) {
+    case Kind_Identity:
+        break;
+    case Kind_Translation:
+        o[3] = -x[3];
+        o[7] = -x[7];
+        o[11] = -x[11];
+        break;
+    case Kind_Scale:
+        o[0] = 1.f / x[0];
+        o[5] = 1.f / x[5];
+        o[10] = 1.f / x[10];
+        break;
+    case Kind_Rotation:
+    case Kind_Rigid:
+        // Transposed rotation, translation rotated back.
+        for (unsigned int i = 0; i < 3; i++) {
+            for (unsigned int j = 0; j < 3; j++) {
+                o[i * 4 + j] = x[j * 4 + i];
+            }
+            o[i * 4 + 3] = -(x[i] * x[3] + x[4 + i] * x[7] + x[8 + i] * x[11]);
+        }
+        break;
+    case Kind_Affine:
+    {
+        // Adjugate of the linear part over its determinant.
+        const float d = 1.f / Determinant3(x);
+        o[0] = (x[5] * x[10] - x[6] * x[9]) * d;
+        o[1] = (x[2] * x[9] - x[1] * x[10]) * d;
+        o[2] = (x[1] * x[6] - x[2] * x[5]) * d;
+        o[4] = (x[6] * x[8] - x[4] * x[10]) * d;
+        o[5] = (x[0] * x[10] - x[2] * x[8]) * d;
+        o[6] = (x[2] * x[4] - x[0] * x[6]) * d;
+        o[8] = (x[4] * x[9] - x[5] * x[8]) * d;
+        o[9] = (x[1] * x[8] - x[0] * x[9]) * d;
+        o[10] = (x[0] * x[5] - x[1] * x[4]) * d;
+        for (unsigned int i = 0; i < 3; i++) {
+            o[i * 4 + 3] = -(o[i * 4] * x[3] + o[i * 4 + 1] * x[7] + o[i * 4 + 2] * x[11]);
+        }
+        break;
+    }
+    case Kind_Projective:
+    {
+        Matrix4 a = matrix;
+        r.matrix = a.Inverse();
+        break;
+    }
+    }
+    return r;
+}
+
+float TaggedMatrix4::Determinant() const
+{
+    const float *x = matrix.m;
+
+    switch (kind) {
+    case Kind_Identity:
+    case Kind_Translation:
+    case Kind_Rotation:
+    case Kind_Rigid:
+        return 1.f;
+    case Kind_Scale:
+        return x[0] * x[5] * x[10];
+    case Kind_Affine:
+        return Determinant3(x);
+    default:
+        return Determinant4(x);
+    }
+}
+
+Vector3 TaggedMatrix4::TransformPoint(const Vector3 &p) const
+{
+    const float *x = matrix.m;
+
+    switch (kind) {
+    case Kind_Identity:
+        return p;
+    case Kind_Translation:
+        return Vector3(p.x + x[3], p.y + x[7], p.z + x[11]);
+    case Kind_Scale:
+        return Vector3(p.x * x[0], p.y * x[5], p.z * x[10]);
+    case Kind_Rotation:
+        return Linear(x, p);
+    case Kind_Rigid:
+    case Kind_Affine:
+    {
+        const Vector3 l = Linear(x, p);
+        return Vector3(l.x + x[3], l.y + x[7], l.z + x[11]);
+    }
+    default:
+    {
+        const Vector3 l = Linear(x, p);
+        const float w = 1.f / (x[12] * p.x + x[13] * p.y + x[14] * p.z + x[15]);
+        return Vector3((l.x + x[3]) * w, (l.y + x[7]) * w, (l.z + x[11]) * w);
+    }
+    }
+}
+
+Vector3 TaggedMatrix4::TransformVector(const Vector3 &v) const
+{
+    const float *x = matrix.m;
+
+    switch (kind) {
+    case Kind_Identity:
+    case Kind_Translation:
+        return v;
+    case Kind_Scale:
+        return Vector3(v.x * x[0], v.y * x[5], v.z * x[10]);
+    default:
+        return Linear(x, v);
+    }
+}
+
+void TaggedMatrix4::TransformPoints(const Vector3 *in, const unsigned int count, Vector3 *out) const
+{
+    const float *x = matrix.m;
+
+    switch (kind) {
+    case Kind_Identity:
+        for (unsigned int i = 0; i < count; i++) {
+            out[i] = in[i];
+        }
+        break;
+    case Kind_Translation:
+        for (unsigned int i = 0; i < count; i++) {
+            out[i].Set(in[i].x + x[3], in[i].y + x[7], in[i].z + x[11]);
+        }
+        break;
+    case Kind_Scale:
+        for (unsigned int i = 0; i < count; i++) {
+            out[i].Set(in[i].x * x[0], in[i].y * x[5], in[i].z * x[10]);
+        }
+        break;
+    case Kind_Rotation:
+    case Kind_Rigid:
+    case Kind_Affine:
+        for (unsigned int i = 0; i < count; i++) {
+            const Vector3 p = in[i];
+            out[i].Set(
+                x[0] * p.x + x[1] * p.y + x[2] * p.z + x[3],
+                x[4] * p.x + x[5] * p.y + x[6] * p.z + x[7],
+                x[8] * p.x + x[9] * p.y + x[10] * p.z + x[11]
+            );
+        }
+        break;
+    default:
+        for (unsigned int i = 0; i < count; i++) {
+            out[i] = TransformPoint(in[i]);
+        }
+        break;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef __BCOSTA_TAGGED_MATRIX__
+#define __BCOSTA_TAGGED_MATRIX__
+
+#include "matrix4.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Matrix4 that remembers how it was built. Matrices from the factories below carry their
+    // structure, products derive it from their operands, and multiply, inverse, determinant
+    // and point transforms pick the cheapest kernel for it: a translation inverse is a
+    // negation, a rigid inverse a transpose, an affine product skips the last row.
+    //
+    // Kinds are ordered from most to least specific. A rotation is assumed proper and
+    // orthonormal, so wrapping a matrix with a kind it does not have gives wrong results;
+    // Classify derives the kind from the values instead.
+    class TaggedMatrix4
+    {
+    public:
+
+        enum Kind
+        {
+            Kind_Identity = 0,
+            Kind_Translation,
+            Kind_Scale,
+            Kind_Rotation,
+            // Rotation then translation.
+            Kind_Rigid,
+            // Last row 0 0 0 1.
+            Kind_Affine,
+            Kind_Projective
+        };
+
+        Matrix4 matrix;
+        Kind kind;
+
+        // Identity.
+        TaggedMatrix4();
+
+        // Wrap a dense matrix whose structure is known to the caller.
+        explicit TaggedMatrix4(const Matrix4 &m, const Kind _kind = Kind_Projective)
+            : matrix(m), kind(_kind)
+        { }
+
+        static TaggedMatrix4 Translation(const Vector3 &t);
+
+        static TaggedMatrix4 Scale(const Vector3 &s);
+
+        static TaggedMatrix4 RotationXAxis(const float a);
+
+        static TaggedMatrix4 RotationYAxis(const float a);
+
+        static TaggedMatrix4 RotationZAxis(const float a);
+
+        // From a unit quaternion.
+        static TaggedMatrix4 Rotation(const Quaternion &r);
+
+        // Translation(t) * Rotation(r) * Scale(s), rigid when s is one.
+        static TaggedMatrix4 Compose(const Vector3 &t, const Quaternion &r, const Vector3 &s);
+
+        // Most specific kind m has within epsilon.
+        static TaggedMatrix4 Classify(const Matrix4 &m, const float epsilon = 1e-5f);
+
+        // Kind of a * b.
+        static Kind Combine(const Kind a, const Kind b);
+
+        TaggedMatrix4 operator *(const TaggedMatrix4 &b) const;
+
+        void operator *=(const TaggedMatrix4 &b)
+        { *this = *this * b; }
+
+        TaggedMatrix4 Inverse() const;
+
+        float Determinant() const;
+
+        // Point (w = 1), divided by w for projective matrices.
+        Vector3 TransformPoint(const Vector3 &p) const;
+
+        // Direction (w = 0): the linear part only.
+        Vector3 TransformVector(const Vector3 &v) const;
+
+        // Array form with the kind dispatched once for the whole batch.
+        void TransformPoints(const Vector3 *in, const unsigned int count, Vector3 *out) const;
+    };
+}
+#endif // __BCOSTA_TAGGED_MATRIX__
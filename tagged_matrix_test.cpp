@@ -0,0 +1,296 @@
+#include <math.h>
+#include <stdio.h>
+#include <random>
+#include "tagged_matrix.h"
+
+using namespace BCosta;
+
+// Checks every TaggedMatrix4 kernel against dense double precision results, for every pair
+// of kinds. Returns nonzero on failure.
+
+namespace
+{
+    typedef TaggedMatrix4::Kind Kind;
+
+    static const char *kind_names[] = {
+        "Identity", "Translation", "Scale", "Rotation", "Rigid", "Affine", "Projective"
+    };
+
+    static const unsigned int kind_count = 7;
+    static const unsigned int samples = 64;
+
+    unsigned int failures = 0;
+
+    void Check(const bool ok, const char *what, const Kind a, const Kind b, const double error)
+    {
+        if (!ok) {
+            if (failures < 20) {
+                printf("FAIL %s: %s * %s, error %g\n", what, kind_names[a], kind_names[b], error);
+            }
+            failures++;
+        }
+    }
+
+    // Dense reference: plain row-major products in double.
+    struct Dense
+    {
+        double m[16];
+
+        explicit Dense(const Matrix4 &a)
+        {
+            for (unsigned int i = 0; i < 16; i++) {
+                m[i] = a.m[i];
+            }
+        }
+
+        Dense()
+        { }
+
+        Dense operator *(const Dense &b) const
+        {
+            Dense out;
+            for (unsigned int i = 0; i < 4; i++) {
+                for (unsigned int j = 0; j < 4; j++) {
+                    double s = 0.0;
+                    for (unsigned int k = 0; k < 4; k++) {
+                        s += m[i * 4 + k] * b.m[k * 4 + j];
+                    }
+                    out.m[i * 4 + j] = s;
+                }
+            }
+            return out;
+        }
+
+        // Gauss-Jordan elimination with partial pivoting; the determinant falls out of the
+        // pivots, independent of Matrix4::Determinant.
+        bool Inverse(Dense &out, double &determinant) const
+        {
+            double a[4][8];
+            for (unsigned int i = 0; i < 4; i++) {
+                for (unsigned int j = 0; j < 4; j++) {
+                    a[i][j] = m[i * 4 + j];
+                    a[i][j + 4] = i == j ? 1.0 : 0.0;
+                }
+            }
+            determinant = 1.0;
+            for (unsigned int c = 0; c < 4; c++) {
+                unsigned int pivot = c;
+                for (unsigned int r = c + 1; r < 4; r++) {
+                    if (fabs(a[r][c]) > fabs(a[pivot][c])) {
+                        pivot = r;
+                    }
+                }
+                if (a[pivot][c] == 0.0) {
+                    determinant = 0.0;
+                    return false;
+                }
+                if (pivot != c) {
+                    for (unsigned int k = 0; k < 8; k++) {
+                        const double t = a[c][k];
+                        a[c][k] = a[pivot][k];
+                        a[pivot][k] = t;
+                    }
+                    determinant = -determinant;
+                }
+                const double p = a[c][c];
+                determinant *= p;
+                for (unsigned int k = 0; k < 8; k++) {
+                    a[c][k] /= p;
+                }
+                for (unsigned int r = 0; r < 4; r++) {
+                    if (r != c) {
+                        const double f = a[r][c];
+                        for (unsigned int k = 0; k < 8; k++) {
+                            a[r][k] -= f * a[c][k];
+                        }
+                    }
+                }
+            }
+            for (unsigned int i = 0; i < 4; i++) {
+                for (unsigned int j = 0; j < 4; j++) {
+                    out.m[i * 4 + j] = a[i][j + 4];
+                }
+            }
+            return true;
+        }
+
+        void Point(const Vector3 &p, double out[3]) const
+        {
+            double h[4];
+            for (unsigned int i = 0; i < 4; i++) {
+                h[i] = m[i * 4] * p.x + m[i * 4 + 1] * p.y + m[i * 4 + 2] * p.z + m[i * 4 + 3];
+            }
+            for (unsigned int i = 0; i < 3; i++) {
+                out[i] = h[i] / h[3];
+            }
+        }
+    };
+
+    double Error(const Matrix4 &a, const Dense &b)
+    {
+        double error = 0.0;
+        for (unsigned int i = 0; i < 16; i++) {
+            error = fmax(error, fabs(a.m[i] - b.m[i]) / (1.0 + fabs(b.m[i])));
+        }
+        return error;
+    }
+
+    // Whether every matrix of kind 'found' is also of kind 'tagged'.
+    bool Within(const Kind found, const Kind tagged)
+    {
+        static const bool table[kind_count][kind_count] = {
+            // Identity, Translation, Scale, Rotation, Rigid, Affine, Projective
+            { true, true, true, true, true, true, true },
+            { false, true, false, false, true, true, true },
+            { false, false, true, false, false, true, true },
+            { false, false, false, true, true, true, true },
+            { false, false, false, false, true, true, true },
+            { false, false, false, false, false, true, true },
+            { false, false, false, false, false, false, true }
+        };
+        return table[found][tagged];
+    }
+
+    class Generator
+    {
+    public:
+
+        explicit Generator(const unsigned int seed)
+            : engine(seed)
+        { }
+
+        float Uniform(const float a, const float b)
+        { return std::uniform_real_distribution<float>(a, b)(engine); }
+
+        Vector3 Vector(const float a, const float b)
+        { return Vector3(Uniform(a, b), Uniform(a, b), Uniform(a, b)); }
+
+        Quaternion UnitQuaternion()
+        {
+            Quaternion q(Uniform(-1.f, 1.f), Uniform(-1.f, 1.f), Uniform(-1.f, 1.f), Uniform(-1.f, 1.f));
+            return q.Normalize();
+        }
+
+        // Random matrix of the kind, well conditioned so inverses stay accurate.
+        TaggedMatrix4 Make(const Kind kind)
+        {
+            switch (kind) {
+            case TaggedMatrix4::Kind_Identity:
+                return TaggedMatrix4();
+            case TaggedMatrix4::Kind_Translation:
+                return TaggedMatrix4::Translation(Vector(-5.f, 5.f));
+            case TaggedMatrix4::Kind_Scale:
+                return TaggedMatrix4::Scale(Vector3(Scale(), Scale(), Scale()));
+            case TaggedMatrix4::Kind_Rotation:
+                switch (engine() % 4) {
+                case 0:
+                    return TaggedMatrix4::RotationXAxis(Uniform(-3.f, 3.f));
+                case 1:
+                    return TaggedMatrix4::RotationYAxis(Uniform(-3.f, 3.f));
+                case 2:
+                    return TaggedMatrix4::RotationZAxis(Uniform(-3.f, 3.f));
+                default:
+                    return TaggedMatrix4::Rotation(UnitQuaternion());
+                }
+            case TaggedMatrix4::Kind_Rigid:
+                return TaggedMatrix4::Compose(Vector(-5.f, 5.f), UnitQuaternion(), Vector3(1.f, 1.f, 1.f));
+            case TaggedMatrix4::Kind_Affine:
+                if (engine() % 2) {
+                    return TaggedMatrix4::Compose(Vector(-5.f, 5.f), UnitQuaternion(), Vector3(Scale(), Scale(), Scale()));
+                } else {
+                    // Sheared.
+                    Matrix4 m = Matrix4::static_identity;
+                    for (unsigned int i = 0; i < 12; i++) {
+                        m.m[i] += Uniform(-.4f, .4f) + (i % 4 == 3 ? Uniform(-5.f, 5.f) : 0.f);
+                    }
+                    return TaggedMatrix4(m, TaggedMatrix4::Kind_Affine);
+                }
+            default:
+                {
+                    Matrix4 m = Matrix4::static_identity;
+                    for (unsigned int i = 0; i < 16; i++) {
+                        m.m[i] = m.m[i] * 2.f + Uniform(-.4f, .4f);
+                    }
+                    return TaggedMatrix4(m, TaggedMatrix4::Kind_Projective);
+                }
+            }
+        }
+
+    private:
+
+        std::mt19937 engine;
+
+        // Either sign, away from zero.
+        float Scale()
+        { return (engine() % 2 ? 1.f : -1.f) * Uniform(.5f, 2.f); }
+    };
+
+    void CheckPair(Generator &generator, const Kind ka, const Kind kb)
+    {
+        const double tolerance = 1e-4;
+        for (unsigned int s = 0; s < samples; s++) {
+            const TaggedMatrix4 a = generator.Make(ka), b = generator.Make(kb);
+            const TaggedMatrix4 ab = a * b;
+            const Dense dense = Dense(a.matrix) * Dense(b.matrix);
+
+            double error = Error(ab.matrix, dense);
+            Check(error <= tolerance, "product", ka, kb, error);
+            Check(ab.kind == TaggedMatrix4::Combine(ka, kb), "product kind", ka, kb, 0.0);
+
+            // The propagated kind must hold for the values; Classify may find a narrower
+            // one (a rotation times its inverse is the identity).
+            const Kind found = TaggedMatrix4::Classify(ab.matrix, 1e-4f).kind;
+            Check(Within(found, ab.kind), "classify", ka, kb, (double) found);
+
+            Dense inverse;
+            double determinant;
+            dense.Inverse(inverse, determinant);
+            const double scale = fabs(determinant) > 1.0 ? fabs(determinant) : 1.0;
+            error = fabs(ab.Determinant() - determinant) / scale;
+            Check(error <= tolerance, "determinant", ka, kb, error);
+
+            error = Error(ab.Inverse().matrix, inverse);
+            Check(error <= tolerance, "inverse", ka, kb, error);
+
+            Vector3 points[8], transformed[8];
+            for (unsigned int k = 0; k < 8; k++) {
+                points[k] = generator.Vector(-1.f, 1.f);
+            }
+            ab.TransformPoints(points, 8, transformed);
+            for (unsigned int k = 0; k < 8; k++) {
+                double expected[3];
+                dense.Point(points[k], expected);
+                const Vector3 single = ab.TransformPoint(points[k]);
+                const float got[3] = { single.x, single.y, single.z };
+                const float batch[3] = { transformed[k].x, transformed[k].y, transformed[k].z };
+                for (unsigned int c = 0; c < 3; c++) {
+                    error = fabs(got[c] - expected[c]) / (1.0 + fabs(expected[c]));
+                    Check(error <= tolerance, "point", ka, kb, error);
+                    Check(batch[c] == got[c], "points batch", ka, kb, fabs(batch[c] - got[c]));
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    Generator generator(1234);
+    for (unsigned int a = 0; a < kind_count; a++) {
+        // Each generator must stay within the kind it is tagged with.
+        for (unsigned int s = 0; s < samples; s++) {
+            const TaggedMatrix4 m = generator.Make((Kind) a);
+            Check(Within(TaggedMatrix4::Classify(m.matrix, 1e-4f).kind, m.kind), "tag", (Kind) a, (Kind) a, 0.0);
+        }
+        for (unsigned int b = 0; b < kind_count; b++) {
+            CheckPair(generator, (Kind) a, (Kind) b);
+        }
+    }
+
+    if (failures) {
+        printf("%u failures\n", failures);
+        return 1;
+    }
+    printf("TaggedMatrix4: all kernels match dense results\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+#include <stdlib.h>
+#include <string.h>
+#include "transform_file.h"
+#include "matrix3.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include "vector.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <malloc.h>
+#endif
+
+using namespace BCosta;
+using namespace BCosta::TransformFormat;
+
+static const unsigned int endian_mark = 0x01020304;
+
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be tightly packed");
+static_assert(sizeof(Quaternion) == 4 * sizeof(float), "Quaternion must be tightly packed");
+static_assert(sizeof(Matrix3) == 9 * sizeof(float), "Matrix3 must be tightly packed");
+static_assert(sizeof(Matrix4) == 16 * sizeof(float), "Matrix4 must be tightly packed");
+static_assert(sizeof(Header) == alignment, "Header must fill one alignment block");
+
+unsigned int TransformFormat::ElementSize(const ElementType type)
+{
+    switch (type) {
+        case Type_Float:
+            return sizeof(float);
+        case Type_Vector3:
+            return sizeof(Vector3);
+        case Type_Quaternion:
+            return sizeof(Quaternion);
+        case Type_Matrix3:
+            return sizeof(Matrix3);
+        case Type_Matrix4:
+            return sizeof(Matrix4);
+    }
+    return 0;
+}
+
+unsigned int TransformFormat::Adler32(unsigned int sum, const void *data, const unsigned long long size)
+{
+    const unsigned int mod = 65521;
+    // Largest block for which the 32-bit sums cannot overflow before the modulo.
+    const unsigned long long block = 5552;
+
+    const unsigned char *p = (const unsigned char *) data;
+    unsigned int a = sum & 0xffff, b = sum >> 16;
+    unsigned long long left = size;
+
+    while (left) {
+        const unsigned long long n = left < block ? left : block;
+        for (unsigned long long i = 0; i < n; i++) {
+            a += p[i];
+            b += a;
+        }
+        a %= mod;
+        b %= mod;
+        p += n;
+        left -= n;
+    }
+    return (b << 16) | a;
+}
+
+// TransformFileWriter
+
+bool TransformFileWriter::Open(const char *path)
+{
+    Close();
+    file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    offset = 0;
+    checksum = 1;
+    open_chunk = false;
+    chunks.clear();
+
+    // Placeholder, rewritten by Close.
+    Header header;
+    memset(&header, 0, sizeof(header));
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        file = 0;
+        return false;
+    }
+    offset = sizeof(header);
+    return true;
+}
+
+bool TransformFileWriter::Write(const void *data, const unsigned long long size)
+{
+    if (size && fwrite(data, 1, (size_t) size, file) != size) {
+        return false;
+    }
+    checksum = Adler32(checksum, data, size);
+    offset += size;
+    return true;
+}
+
+bool TransformFileWriter::Pad()
+{
+    static const unsigned char zeros[alignment] = {0};
+    const unsigned long long pad = (alignment - offset % alignment) % alignment;
+    return Write(zeros, pad);
+}
+
+bool TransformFileWriter::BeginChunk(const unsigned int id, const ElementType type)
+{
+    if (!file || !Pad()) {
+        return false;
+    }
+    ChunkEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = id;
+    entry.type = type;
+    entry.element_size = ElementSize(type);
+    entry.offset = offset;
+    chunks.push_back(entry);
+    open_chunk = true;
+    return true;
+}
+
+bool TransformFileWriter::Append(const void *elements, const unsigned long long count)
+{
+    if (!file || !open_chunk) {
+        return false;
+    }
+    ChunkEntry &entry = chunks.back();
+    if (!Write(elements, count * entry.element_size)) {
+        return false;
+    }
+    entry.count += count;
+    return true;
+}
+
+bool TransformFileWriter::Close()
+{
+    if (!file) {
+        return false;
+    }
+    bool ok = Pad();
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = magic;
+    header.version = version;
+    header.endian = endian_mark;
+    header.chunk_count = (unsigned int) chunks.size();
+    header.table_offset = offset;
+
+    ok = ok && Write(chunks.data(), chunks.size() * sizeof(ChunkEntry));
+    header.file_size = offset;
+    header.checksum = checksum;
+
+    ok = ok && fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    file = 0;
+    open_chunk = false;
+    chunks.clear();
+    return ok;
+}
+
+// TransformFile
+
+bool TransformFile::Open(const char *path)
+{
+    Close();
+
+#ifndef _WIN32
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    base = (const unsigned char *) p;
+    size = (unsigned long long) st.st_size;
+#else
+    // No mapping: load the whole file into an aligned block instead.
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *p = len >= (long) sizeof(Header) ? _aligned_malloc((size_t) len, alignment) : 0;
+    if (!p || fread(p, 1, (size_t) len, f) != (size_t) len) {
+        _aligned_free(p);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    base = (const unsigned char *) p;
+    size = (unsigned long long) len;
+#endif
+
+    const Header *h = (const Header *) base;
+    if (h->magic != magic || h->version != version || h->endian != endian_mark || h->file_size != size ||
+        h->table_offset > size || (size - h->table_offset) / sizeof(ChunkEntry) < h->chunk_count) {
+        Close();
+        return false;
+    }
+    const ChunkEntry *t = (const ChunkEntry *) (base + h->table_offset);
+    for (unsigned int i = 0; i < h->chunk_count; i++) {
+        const unsigned int element_size = ElementSize((ElementType) t[i].type);
+        if (!element_size || element_size != t[i].element_size || t[i].offset % alignment ||
+            t[i].offset > h->table_offset || t[i].count > (h->table_offset - t[i].offset) / element_size) {
+            Close();
+            return false;
+        }
+    }
+    header = h;
+    table = t;
+    return true;
+}
+
+bool TransformFile::Verify() const
+{
+    if (!header) {
+        return false;
+    }
+    return Adler32(1, base + sizeof(Header), size - sizeof(Header)) == header->checksum;
+}
+
+void TransformFile::Close()
+{
+    if (base) {
+#ifndef _WIN32
+        munmap((void *) base, (size_t) size);
+#else
+        _aligned_free((void *) base);
+#endif
+    }
+    base = 0;
+    size = 0;
+    header = 0;
+    table = 0;
+}
+
+TransformFile::Chunk TransformFile::ChunkAt(const unsigned int i) const
+{
+    Chunk c;
+    c.id = table[i].id;
+    c.type = (ElementType) table[i].type;
+    c.count = table[i].count;
+    c.data = base + table[i].offset;
+    return c;
+}
+
+TransformFile::Chunk TransformFile::Find(const unsigned int id) const
+{
+    for (unsigned int i = 0; i < ChunkCount(); i++) {
+        if (table[i].id == id) {
+            return ChunkAt(i);
+        }
+    }
+    Chunk c = {id, Type_Float, 0, 0};
+    return c;
+}
@@ -0,0 +1,193 @@
+#ifndef __BCOSTA_TRANSFORM_FILE__
+#define __BCOSTA_TRANSFORM_FILE__
+
+#include <stdio.h>
+#include <vector>
+
+namespace BCosta
+{
+    class Matrix3;
+    class Matrix4;
+    class Quaternion;
+    class Vector3;
+
+    // Binary container of contiguous math arrays (scene transforms, animation tracks...).
+    //
+    // Layout : [header][chunk data, each aligned to 64 bytes]...[chunk table]
+    // The table sits at the end so chunks can be streamed out without knowing their count
+    // or size up front. The header records the table offset and an Adler-32 checksum of
+    // everything after the header.
+    // Files are written in native little-endian layout and mapped back as-is: the arrays
+    // returned by TransformFile point straight into the mapping.
+    namespace TransformFormat
+    {
+        enum ElementType
+        {
+            Type_Float = 1,
+            Type_Vector3,
+            Type_Quaternion,
+            Type_Matrix3,
+            Type_Matrix4
+        };
+
+        const unsigned int magic = 0x46544342; // "BCTF"
+        const unsigned int version = 1;
+        const unsigned int alignment = 64;
+
+        struct Header
+        {
+            unsigned int magic;
+            unsigned int version;
+            unsigned int endian; // 0x01020304 as written by the producer
+            unsigned int chunk_count;
+            unsigned long long file_size;
+            unsigned long long table_offset;
+            unsigned int checksum;
+            unsigned int reserved[7];
+        };
+
+        struct ChunkEntry
+        {
+            unsigned int id;
+            unsigned int type;
+            unsigned int element_size;
+            unsigned int reserved;
+            unsigned long long count;
+            unsigned long long offset;
+        };
+
+        template<typename T>
+        struct TypeOf;
+
+        template<>
+        struct TypeOf<float>
+        { static const ElementType value = Type_Float; };
+
+        template<>
+        struct TypeOf<Vector3>
+        { static const ElementType value = Type_Vector3; };
+
+        template<>
+        struct TypeOf<Quaternion>
+        { static const ElementType value = Type_Quaternion; };
+
+        template<>
+        struct TypeOf<Matrix3>
+        { static const ElementType value = Type_Matrix3; };
+
+        template<>
+        struct TypeOf<Matrix4>
+        { static const ElementType value = Type_Matrix4; };
+
+        unsigned int ElementSize(const ElementType type);
+
+        // Running Adler-32, start with 'sum' = 1.
+        unsigned int Adler32(unsigned int sum, const void *data, const unsigned long long size);
+    }
+
+    // Streaming writer. Chunks are written one after the other; a chunk can be appended
+    // to in several calls as long as no other chunk was started in between.
+    class TransformFileWriter
+    {
+    public:
+
+        TransformFileWriter()
+            : file(0), offset(0), checksum(1), open_chunk(false)
+        { }
+
+        ~TransformFileWriter()
+        { Close(); }
+
+        bool Open(const char *path);
+
+        // Start a chunk identified by a caller-defined 'id'.
+        bool BeginChunk(const unsigned int id, const TransformFormat::ElementType type);
+
+        bool Append(const void *elements, const unsigned long long count);
+
+        template<typename T>
+        bool WriteChunk(const unsigned int id, const T *elements, const unsigned long long count)
+        { return BeginChunk(id, TransformFormat::TypeOf<T>::value) && Append(elements, count); }
+
+        // Write the chunk table and finalize the header. Return false on any I/O failure.
+        bool Close();
+
+    private:
+
+        TransformFileWriter(const TransformFileWriter &);
+
+        TransformFileWriter &operator =(const TransformFileWriter &);
+
+        bool Write(const void *data, const unsigned long long size);
+
+        bool Pad();
+
+        FILE *file;
+        unsigned long long offset;
+        unsigned int checksum;
+        bool open_chunk;
+        std::vector<TransformFormat::ChunkEntry> chunks;
+    };
+
+    // Read-only memory mapping of a container written by TransformFileWriter.
+    class TransformFile
+    {
+    public:
+
+        struct Chunk
+        {
+            unsigned int id;
+            TransformFormat::ElementType type;
+            unsigned long long count;
+            const void *data;
+        };
+
+        TransformFile()
+            : base(0), size(0), header(0), table(0)
+        { }
+
+        ~TransformFile()
+        { Close(); }
+
+        // Map the file and check its header and table. Checksum verification touches every
+        // page of the file so it is left to Verify.
+        bool Open(const char *path);
+
+        bool Verify() const;
+
+        void Close();
+
+        unsigned int ChunkCount() const
+        { return header ? header->chunk_count : 0; }
+
+        Chunk ChunkAt(const unsigned int i) const;
+
+        // Return the first chunk with this id, or a chunk with null data.
+        Chunk Find(const unsigned int id) const;
+
+        // Typed access: null if the chunk is missing or holds another element type.
+        template<typename T>
+        const T *Get(const unsigned int id, unsigned long long *count) const
+        {
+            const Chunk c = Find(id);
+            if (!c.data || c.type != TransformFormat::TypeOf<T>::value) {
+                *count = 0;
+                return 0;
+            }
+            *count = c.count;
+            return (const T *) c.data;
+        }
+
+    private:
+
+        TransformFile(const TransformFile &);
+
+        TransformFile &operator =(const TransformFile &);
+
+        const unsigned char *base;
+        unsigned long long size;
+        const TransformFormat::Header *header;
+        const TransformFormat::ChunkEntry *table;
+    };
+}
+#endif // __BCOSTA_TRANSFORM_FILE__
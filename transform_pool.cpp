@@ -0,0 +1,104 @@
+#include "transform_pool.h"
+
+using namespace BCosta;
+
+const TransformHandle TransformHandle::invalid = {0xffffffff, 0};
+
+TransformHandle TransformPool::Create(const Vector3 &translation, const Quaternion &rotation, const Vector3 &scale)
+{
+    unsigned int index;
+    if (free_head != no_slot) {
+        index = free_head;
+        free_head = slots[index].dense;
+    } else {
+        index = (unsigned int) slots.size();
+        Slot slot = {0, 1};
+        slots.push_back(slot);
+    }
+
+    slots[index].dense = Size();
+    dense_to_slot.push_back(index);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    world.push_back(Matrix4::Compose(translation, rotation, scale));
+
+    TransformHandle h = {index, slots[index].generation};
+    return h;
+}
+
+bool TransformPool::Destroy(const TransformHandle h)
+{
+    if (!IsValid(h)) {
+        return false;
+    }
+    const unsigned int dense = slots[h.index].dense;
+    const unsigned int last = Size() - 1;
+
+    // Swap-remove: move the last entry into the hole.
+    if (dense != last) {
+        const unsigned int moved = dense_to_slot[last];
+        dense_to_slot[dense] = moved;
+        translations[dense] = translations[last];
+        rotations[dense] = rotations[last];
+        scales[dense] = scales[last];
+        world[dense] = world[last];
+        slots[moved].dense = dense;
+    }
+    dense_to_slot.pop_back();
+    translations.pop_back();
+    rotations.pop_back();
+    scales.pop_back();
+    world.pop_back();
+
+    // Bumping the generation invalidates every outstanding handle to this slot.
+    slots[h.index].generation++;
+    slots[h.index].dense = free_head;
+    free_head = h.index;
+    return true;
+}
+
+void TransformPool::Clear()
+{
+    for (unsigned int i = 0; i < Size(); i++) {
+        const unsigned int index = dense_to_slot[i];
+        slots[index].generation++;
+        slots[index].dense = free_head;
+        free_head = index;
+    }
+    dense_to_slot.clear();
+    translations.clear();
+    rotations.clear();
+    scales.clear();
+    world.clear();
+}
+
+void TransformPool::Reserve(const unsigned int n)
+{
+    slots.reserve(n);
+    dense_to_slot.reserve(n);
+    translations.reserve(n);
+    rotations.reserve(n);
+    scales.reserve(n);
+    world.reserve(n);
+}
+
+TransformHandle TransformPool::HandleAt(const unsigned int dense) const
+{
+    const unsigned int index = dense_to_slot[dense];
+    TransformHandle h = {index, slots[index].generation};
+    return h;
+}
+
+void TransformPool::UpdateWorldMatrices(const unsigned int first, const unsigned int n)
+{
+    const Vector3 *t = translations.data();
+    const Quaternion *r = rotations.data();
+    const Vector3 *s = scales.data();
+    Matrix4 *w = world.data();
+
+    const unsigned int end = first + n;
+    for (unsigned int i = first; i < end; i++) {
+        w[i] = Matrix4::Compose(t[i], r[i], s[i]);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __BCOSTA_TRANSFORM_POOL__
+#define __BCOSTA_TRANSFORM_POOL__
+
+#include <vector>
+#include "aligned.h"
+#include "matrix4.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    // Stable reference to a pool entry. A handle goes stale as soon as its entry is
+    // destroyed, even if the slot gets reused later.
+    struct TransformHandle
+    {
+        unsigned int index;
+        unsigned int generation;
+
+        bool operator ==(const TransformHandle &b) const
+        { return index == b.index && generation == b.generation; }
+
+        bool operator !=(const TransformHandle &b) const
+        { return index != b.index || generation != b.generation; }
+
+        static const TransformHandle invalid;
+    };
+
+    // Slot map of TRS transforms. Handles point to slots, slots point into dense arrays which
+    // are kept packed by swap-remove, so batch loops always run over [0, Size()) whatever the
+    // creation/destruction history. Dense arrays are cache-line aligned.
+    class TransformPool
+    {
+    public:
+
+        TransformPool()
+            : free_head(no_slot)
+        { }
+
+        TransformHandle Create(const Vector3 &translation = Vector3::origin,
+                               const Quaternion &rotation = Quaternion(),
+                               const Vector3 &scale = Vector3::identity);
+
+        // Return false if the handle was already stale.
+        bool Destroy(const TransformHandle h);
+
+        bool IsValid(const TransformHandle h) const
+        { return h.index < slots.size() && slots[h.index].generation == h.generation; }
+
+        void Clear();
+
+        void Reserve(const unsigned int n);
+
+        unsigned int Size() const
+        { return (unsigned int) dense_to_slot.size(); }
+
+        // Position of a live entry in the dense arrays. Only valid until the next Destroy.
+        unsigned int DenseIndex(const TransformHandle h) const
+        { return slots[h.index].dense; }
+
+        TransformHandle HandleAt(const unsigned int dense) const;
+
+        // Dense arrays, all of Size() elements.
+        Vector3 *Translations()
+        { return translations.data(); }
+
+        Quaternion *Rotations()
+        { return rotations.data(); }
+
+        Vector3 *Scales()
+        { return scales.data(); }
+
+        Matrix4 *WorldMatrices()
+        { return world.data(); }
+
+        // Rebuild world matrices of the dense range [first, first + n) from their TRS.
+        // Disjoint ranges can be updated from different threads.
+        void UpdateWorldMatrices(const unsigned int first, const unsigned int n);
+
+        void UpdateWorldMatrices()
+        { UpdateWorldMatrices(0, Size()); }
+
+    private:
+
+        static const unsigned int no_slot = 0xffffffff;
+
+        struct Slot
+        {
+            // Dense index while alive, next free slot while dead.
+            unsigned int dense;
+            unsigned int generation;
+        };
+
+        std::vector<Slot> slots;
+        unsigned int free_head;
+
+        std::vector<unsigned int> dense_to_slot;
+        std::vector<Vector3, AlignedAllocator<Vector3> > translations;
+        std::vector<Quaternion, AlignedAllocator<Quaternion> > rotations;
+        std::vector<Vector3, AlignedAllocator<Vector3> > scales;
+        std::vector<Matrix4, AlignedAllocator<Matrix4> > world;
+    };
+}
+#endif // __BCOSTA_TRANSFORM_POOL__
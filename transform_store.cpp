@@ -0,0 +1,75 @@
+#include <string.h>
+#include "transform_store.h"
+
+using namespace BCosta;
+
+TransformStore::TransformStore(const unsigned int _count, const unsigned int _range_size)
+    : count(_count),
+      range_size(_range_size ? _range_size : 1),
+      shared_index(1),
+      write_index(0),
+      frame(1),
+      read_index(2)
+{
+    range_frames.assign((count + range_size - 1) / range_size, 0);
+    for (unsigned int i = 0; i < 3; i++) {
+        buffers[i].data.assign(count, Matrix4::static_identity);
+        buffers[i].frame = 0;
+    }
+}
+
+void TransformStore::Write(const unsigned int index, const Matrix4 &m)
+{
+    buffers[write_index].data[index] = m;
+    range_frames[index / range_size] = frame;
+}
+
+void TransformStore::MarkDirty(const unsigned int first, const unsigned int n)
+{
+    if (!n) {
+        return;
+    }
+    const unsigned int last = (first + n - 1) / range_size;
+    for (unsigned int r = first / range_size; r <= last; r++) {
+        range_frames[r] = frame;
+    }
+}
+
+void TransformStore::Publish()
+{
+    const unsigned int published = write_index;
+    buffers[published].frame = frame;
+
+    write_index = shared_index.exchange(published | fresh_bit, std::memory_order_acq_rel) & index_mask;
+
+    // The buffer just published is only ever read from now on, so it can serve as the
+    // copy source while the reader uses it.
+    Buffer &dst = buffers[write_index];
+    const Buffer &src = buffers[published];
+    const unsigned int range_count = (unsigned int) range_frames.size();
+
+    for (unsigned int r = 0; r < range_count; r++) {
+        if (range_frames[r] <= dst.frame) {
+            continue;
+        }
+        // Coalesce consecutive stale ranges into one copy.
+        unsigned int end = r + 1;
+        while (end < range_count && range_frames[end] > dst.frame) {
+            end++;
+        }
+        const unsigned int first = r * range_size;
+        const unsigned int last = end * range_size < count ? end * range_size : count;
+        memcpy(&dst.data[first], &src.data[first], (last - first) * sizeof(Matrix4));
+        r = end;
+    }
+    dst.frame = frame;
+    frame++;
+}
+
+const Matrix4 *TransformStore::Acquire()
+{
+    if (shared_index.load(std::memory_order_relaxed) & fresh_bit) {
+        read_index = shared_index.exchange(read_index, std::memory_order_acq_rel) & index_mask;
+    }
+    return buffers[read_index].data.data();
+}
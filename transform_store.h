@@ -0,0 +1,85 @@
+#ifndef __BCOSTA_TRANSFORM_STORE__
+#define __BCOSTA_TRANSFORM_STORE__
+
+#include <atomic>
+#include <vector>
+#include "matrix4.h"
+
+namespace BCosta
+{
+    // Triple-buffered array of world matrices shared by one writer thread (simulation)
+    // and one reader thread (render). Neither side ever waits on the other: the writer
+    // publishes a whole buffer with a single atomic exchange and the reader picks up the
+    // latest published buffer the same way.
+    // Writes are tracked per range of 'range_size' matrices so that, when the writer gets
+    // a stale buffer back after a publish, only the ranges modified since are copied.
+    class TransformStore
+    {
+    public:
+
+        TransformStore(const unsigned int count, const unsigned int range_size = 64);
+
+        unsigned int Count() const
+        { return count; }
+
+        unsigned int RangeSize() const
+        { return range_size; }
+
+        // Writer side.
+        // Write : set one matrix of the current write buffer.
+        // WriteBuffer / MarkDirty : direct access for bulk writes; the caller flags the
+        // modified span itself.
+        // Publish : make the write buffer visible to the reader and bring the next write
+        // buffer up to date.
+        void Write(const unsigned int index, const Matrix4 &m);
+
+        Matrix4 *WriteBuffer()
+        { return buffers[write_index].data.data(); }
+
+        void MarkDirty(const unsigned int first, const unsigned int n);
+
+        void Publish();
+
+        // Reader side.
+        // Acquire : return the most recently published buffer. The pointer stays valid and
+        // unchanged until the next call to Acquire.
+        // AcquiredFrame : frame number of the buffer returned by the last Acquire.
+        const Matrix4 *Acquire();
+
+        unsigned long long AcquiredFrame() const
+        { return buffers[read_index].frame; }
+
+    private:
+
+        struct Buffer
+        {
+            std::vector<Matrix4> data;
+            unsigned long long frame;
+        };
+
+        static const unsigned int fresh_bit = 4;
+        static const unsigned int index_mask = 3;
+
+        TransformStore(const TransformStore &);
+
+        TransformStore &operator =(const TransformStore &);
+
+        unsigned int count;
+        unsigned int range_size;
+
+        Buffer buffers[3];
+
+        // Index of the buffer handed over between the two threads, plus 'fresh_bit' when it
+        // holds a publish the reader has not picked up yet.
+        std::atomic<unsigned int> shared_index;
+
+        // Owned by the writer.
+        unsigned int write_index;
+        unsigned long long frame;
+        std::vector<unsigned long long> range_frames;
+
+        // Owned by the reader.
+        unsigned int read_index;
+    };
+}
+#endif // __BCOSTA_TRANSFORM_STORE__
@@ -0,0 +1,575 @@
+#ifndef __BCOSTA_VEC__
+#define __BCOSTA_VEC__
+
+#include <stddef.h>
+#include <math.h>
+#include "half.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace BCosta
+{
+    // Element-wise kernels behind Vec, unrolled at compile time: each level does the last
+    // element and leaves the first N - 1 to the level below, so a Vec<float, 3> operation is
+    // three straight-line statements whatever the optimizer's unrolling limits. Dot adds left
+    // to right, like the hand-written classes did.
+    template<typename T, unsigned int N>
+    struct VecUnrolled
+    {
+        static void Add(const T *a, const T *b, T *r)
+        {
+            VecUnrolled<T, N - 1>::Add(a, b, r);
+            r[N - 1] = a[N - 1] + b[N - 1];
+        }
+
+        static void Sub(const T *a, const T *b, T *r)
+        {
+            VecUnrolled<T, N - 1>::Sub(a, b, r);
+            r[N - 1] = a[N - 1] - b[N - 1];
+        }
+
+        static void Mul(const T *a, const T *b, T *r)
+        {
+            VecUnrolled<T, N - 1>::Mul(a, b, r);
+            r[N - 1] = a[N - 1] * b[N - 1];
+        }
+
+        static void Div(const T *a, const T *b, T *r)
+        {
+            VecUnrolled<T, N - 1>::Div(a, b, r);
+            r[N - 1] = a[N - 1] / b[N - 1];
+        }
+
+        static void Scale(const T *a, const T k, T *r)
+        {
+            VecUnrolled<T, N - 1>::Scale(a, k, r);
+            r[N - 1] = a[N - 1] * k;
+        }
+
+        // r = a + b * k
+        static void MulAdd(const T *a, const T *b, const T k, T *r)
+        {
+            VecUnrolled<T, N - 1>::MulAdd(a, b, k, r);
+            r[N - 1] = a[N - 1] + b[N - 1] * k;
+        }
+
+        static T Dot(const T *a, const T *b)
+        { return VecUnrolled<T, N - 1>::Dot(a, b) + a[N - 1] * b[N - 1]; }
+    };
+
+    template<typename T>
+    struct VecUnrolled<T, 1>
+    {
+        static void Add(const T *a, const T *b, T *r)
+        { r[0] = a[0] + b[0]; }
+
+        static void Sub(const T *a, const T *b, T *r)
+        { r[0] = a[0] - b[0]; }
+
+        static void Mul(const T *a, const T *b, T *r)
+        { r[0] = a[0] * b[0]; }
+
+        static void Div(const T *a, const T *b, T *r)
+        { r[0] = a[0] / b[0]; }
+
+        static void Scale(const T *a, const T k, T *r)
+        { r[0] = a[0] * k; }
+
+        static void MulAdd(const T *a, const T *b, const T k, T *r)
+        { r[0] = a[0] + b[0] * k; }
+
+        static T Dot(const T *a, const T *b)
+        { return a[0] * b[0]; }
+    };
+
+    // The kernels Vec and Mat call. Sizes that fill a SIMD register have intrinsic
+    // specializations below, which every Vec of that shape and every Mat with rows of that
+    // shape picks up automatically; the rest are unrolled.
+    template<typename T, unsigned int N>
+    struct VecOps : VecUnrolled<T, N>
+    {
+    };
+
+#ifdef __SSE2__
+    template<>
+    struct VecOps<float, 4>
+    {
+        static void Add(const float *a, const float *b, float *r)
+        { _mm_storeu_ps(r, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+        static void Sub(const float *a, const float *b, float *r)
+        { _mm_storeu_ps(r, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+        static void Mul(const float *a, const float *b, float *r)
+        { _mm_storeu_ps(r, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+        static void Div(const float *a, const float *b, float *r)
+        { _mm_storeu_ps(r, _mm_div_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+        static void Scale(const float *a, const float k, float *r)
+        { _mm_storeu_ps(r, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(k))); }
+
+        static void MulAdd(const float *a, const float *b, const float k, float *r)
+        { _mm_storeu_ps(r, _mm_add_ps(_mm_loadu_ps(a), _mm_mul_ps(_mm_loadu_ps(b), _mm_set1_ps(k)))); }
+
+        static float Dot(const float *a, const float *b)
+        {
+            const __m128 p = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+            const __m128 s = _mm_add_ps(p, _mm_movehl_ps(p, p));
+            return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+        }
+    };
+
+    template<>
+    struct VecOps<double, 2>
+    {
+        static void Add(const double *a, const double *b, double *r)
+        { _mm_storeu_pd(r, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+
+        static void Sub(const double *a, const double *b, double *r)
+        { _mm_storeu_pd(r, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+
+        static void Mul(const double *a, const double *b, double *r)
+        { _mm_storeu_pd(r, _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+
+        static void Div(const double *a, const double *b, double *r)
+        { _mm_storeu_pd(r, _mm_div_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+
+        static void Scale(const double *a, const double k, double *r)
+        { _mm_storeu_pd(r, _mm_mul_pd(_mm_loadu_pd(a), _mm_set1_pd(k))); }
+
+        static void MulAdd(const double *a, const double *b, const double k, double *r)
+        { _mm_storeu_pd(r, _mm_add_pd(_mm_loadu_pd(a), _mm_mul_pd(_mm_loadu_pd(b), _mm_set1_pd(k)))); }
+
+        static double Dot(const double *a, const double *b)
+        {
+            const __m128d p = _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b));
+            return _mm_cvtsd_f64(_mm_add_sd(p, _mm_unpackhi_pd(p, p)));
+        }
+    };
+#endif
+
+#ifdef __AVX__
+    template<>
+    struct VecOps<float, 8>
+    {
+        static void Add(const float *a, const float *b, float *r)
+        { _mm256_storeu_ps(r, _mm256_add_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+
+        static void Sub(const float *a, const float *b, float *r)
+        { _mm256_storeu_ps(r, _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+
+        static void Mul(const float *a, const float *b, float *r)
+        { _mm256_storeu_ps(r, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+
+        static void Div(const float *a, const float *b, float *r)
+        { _mm256_storeu_ps(r, _mm256_div_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+
+        static void Scale(const float *a, const float k, float *r)
+        { _mm256_storeu_ps(r, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_set1_ps(k))); }
+
+        static void MulAdd(const float *a, const float *b, const float k, float *r)
+        { _mm256_storeu_ps(r, _mm256_add_ps(_mm256_loadu_ps(a), _mm256_mul_ps(_mm256_loadu_ps(b), _mm256_set1_ps(k)))); }
+
+        static float Dot(const float *a, const float *b)
+        {
+            const __m256 p = _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+            const __m128 q = _mm_add_ps(_mm256_castps256_ps128(p), _mm256_extractf128_ps(p, 1));
+            const __m128 s = _mm_add_ps(q, _mm_movehl_ps(q, q));
+            return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+        }
+    };
+
+    template<>
+    struct VecOps<double, 4>
+    {
+        static void Add(const double *a, const double *b, double *r)
+        { _mm256_storeu_pd(r, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+
+        static void Sub(const double *a, const double *b, double *r)
+        { _mm256_storeu_pd(r, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+
+        static void Mul(const double *a, const double *b, double *r)
+        { _mm256_storeu_pd(r, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+
+        static void Div(const double *a, const double *b, double *r)
+        { _mm256_storeu_pd(r, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+
+        static void Scale(const double *a, const double k, double *r)
+        { _mm256_storeu_pd(r, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_set1_pd(k))); }
+
+        static void MulAdd(const double *a, const double *b, const double k, double *r)
+        { _mm256_storeu_pd(r, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_mul_pd(_mm256_loadu_pd(b), _mm256_set1_pd(k)))); }
+
+        static double Dot(const double *a, const double *b)
+        {
+            const __m256d p = _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+            const __m128d q = _mm_add_pd(_mm256_castpd256_pd128(p), _mm256_extractf128_pd(p, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(q, _mm_unpackhi_pd(q, q)));
+        }
+    };
+#endif
+
+    // 16 and 32 byte vectors get register alignment (capped at 16 bytes, what C++11
+    // allocators guarantee); other sizes keep the element alignment, so Vec<float, 2> and
+    // Vec<float, 3> stay as packed as Vector2 and Vector3.
+    template<typename T, unsigned int N>
+    struct VecAlign
+    {
+        static const size_t bytes = sizeof(T) * N;
+        static const size_t value = bytes == 16 || bytes == 32 ? 16 : alignof(T);
+    };
+
+    // Element storage of Vec. Two to four elements are named x, y, z, w and are contiguous;
+    // Data() is the array the kernels run on.
+    template<typename T, unsigned int N>
+    struct VecStorage
+    {
+        alignas(VecAlign<T, N>::value) T v[N];
+
+        T *Data()
+        { return v; }
+
+        const T *Data() const
+        { return v; }
+    };
+
+    template<typename T>
+    struct VecStorage<T, 2>
+    {
+        alignas(VecAlign<T, 2>::value) T x;
+        T y;
+
+        T *Data()
+        { return &x; }
+
+        const T *Data() const
+        { return &x; }
+    };
+
+    template<typename T>
+    struct VecStorage<T, 3>
+    {
+        alignas(VecAlign<T, 3>::value) T x;
+        T y, z;
+
+        T *Data()
+        { return &x; }
+
+        const T *Data() const
+        { return &x; }
+    };
+
+    template<typename T>
+    struct VecStorage<T, 4>
+    {
+        alignas(VecAlign<T, 4>::value) T x;
+        T y, z, w;
+
+        T *Data()
+        { return &x; }
+
+        const T *Data() const
+        { return &x; }
+    };
+
+    // Fixed-size vector of N elements of T (float, double, Float16...). Vector2 and Vector3
+    // are Vec<float, 2> and Vec<float, 3> with their historical method names on top.
+    template<typename T, unsigned int N>
+    class Vec : public VecStorage<T, N>
+    {
+    public:
+
+        using VecStorage<T, N>::Data;
+
+        Vec()
+        {
+            for (unsigned int i = 0; i < N; i++) {
+                Data()[i] = T(0);
+            }
+        }
+
+        explicit Vec(const T s)
+        {
+            for (unsigned int i = 0; i < N; i++) {
+                Data()[i] = s;
+            }
+        }
+
+        // Vec<float, 3>(x, y, z): one argument per element.
+        template<typename... A>
+        Vec(const T a0, const T a1, const A... rest)
+        {
+            static_assert(sizeof...(A) + 2 == N, "Vec: wrong number of elements");
+            const T e[N] = {a0, a1, T(rest)...};
+            for (unsigned int i = 0; i < N; i++) {
+                Data()[i] = e[i];
+            }
+        }
+
+        T &operator [](const unsigned int i)
+        { return Data()[i]; }
+
+        const T &operator [](const unsigned int i) const
+        { return Data()[i]; }
+
+        Vec operator +(const Vec &b) const
+        {
+            Vec r;
+            VecOps<T, N>::Add(Data(), b.Data(), r.Data());
+            return r;
+        }
+
+        Vec operator -(const Vec &b) const
+        {
+            Vec r;
+            VecOps<T, N>::Sub(Data(), b.Data(), r.Data());
+            return r;
+        }
+
+        Vec operator *(const Vec &b) const
+        {
+            Vec r;
+            VecOps<T, N>::Mul(Data(), b.Data(), r.Data());
+            return r;
+        }
+
+        Vec operator /(const Vec &b) const
+        {
+            Vec r;
+            VecOps<T, N>::Div(Data(), b.Data(), r.Data());
+            return r;
+        }
+
+        Vec operator *(const T k) const
+        {
+            Vec r;
+            VecOps<T, N>::Scale(Data(), k, r.Data());
+            return r;
+        }
+
+        Vec operator /(const T k) const
+        { return *this * (T(1) / k); }
+
+        Vec operator -() const
+        { return *this * T(-1); }
+
+        void operator +=(const Vec &b)
+        { VecOps<T, N>::Add(Data(), b.Data(), Data()); }
+
+        void operator -=(const Vec &b)
+        { VecOps<T, N>::Sub(Data(), b.Data(), Data()); }
+
+        void operator *=(const Vec &b)
+        { VecOps<T, N>::Mul(Data(), b.Data(), Data()); }
+
+        void operator /=(const Vec &b)
+        { VecOps<T, N>::Div(Data(), b.Data(), Data()); }
+
+        void operator *=(const T k)
+        { VecOps<T, N>::Scale(Data(), k, Data()); }
+
+        bool operator ==(const Vec &b) const
+        {
+            for (unsigned int i = 0; i < N; i++) {
+                if (!(Data()[i] == b.Data()[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator !=(const Vec &b) const
+        { return !(*this == b); }
+
+        T Len2() const
+        { return VecOps<T, N>::Dot(Data(), Data()); }
+
+        T Len() const
+        { return T(sqrt(Len2())); }
+
+        // Zero vectors come back unchanged.
+        Vec Normalized() const
+        {
+            const T len = Len();
+            return len > T(0) ? *this * (T(1) / len) : *this;
+        }
+
+        static T Dot(const Vec &a, const Vec &b)
+        { return VecOps<T, N>::Dot(a.Data(), b.Data()); }
+
+        static T Dist(const Vec &a, const Vec &b)
+        { return (b - a).Len(); }
+
+        static Vec Lerp(const Vec &a, const Vec &b, const T t)
+        {
+            Vec r;
+            VecOps<T, N>::MulAdd(a.Data(), (b - a).Data(), t, r.Data());
+            return r;
+        }
+
+        static Vec Min(const Vec &a, const Vec &b)
+        {
+            Vec r;
+            for (unsigned int i = 0; i < N; i++) {
+                r[i] = b[i] < a[i] ? b[i] : a[i];
+            }
+            return r;
+        }
+
+        static Vec Max(const Vec &a, const Vec &b)
+        {
+            Vec r;
+            for (unsigned int i = 0; i < N; i++) {
+                r[i] = a[i] < b[i] ? b[i] : a[i];
+            }
+            return r;
+        }
+    };
+
+    template<typename T>
+    Vec<T, 3> Cross(const Vec<T, 3> &a, const Vec<T, 3> &b)
+    { return Vec<T, 3>(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]); }
+
+    // Row-major R x C matrix in one flat array, so Matrix3 and Matrix4 keep their m[] layout.
+    // Products run on the Vec kernels a row at a time: row i of a * b is the sum of b's rows
+    // weighted by row i of a.
+    template<typename T, unsigned int R, unsigned int C>
+    class Mat
+    {
+    public:
+
+        T m[R * C];
+
+        // Uninitialized, like Matrix4.
+        Mat()
+        { }
+
+        static Mat Zero()
+        {
+            Mat r;
+            for (unsigned int i = 0; i < R * C; i++) {
+                r.m[i] = T(0);
+            }
+            return r;
+        }
+
+        static Mat Identity()
+        {
+            Mat r = Zero();
+            for (unsigned int i = 0; i < R && i < C; i++) {
+                r.m[i * C + i] = T(1);
+            }
+            return r;
+        }
+
+        T &operator ()(const unsigned int r, const unsigned int c)
+        { return m[r * C + c]; }
+
+        const T &operator ()(const unsigned int r, const unsigned int c) const
+        { return m[r * C + c]; }
+
+        T *Row(const unsigned int r)
+        { return m + r * C; }
+
+        const T *Row(const unsigned int r) const
+        { return m + r * C; }
+
+        template<unsigned int K>
+        Mat<T, R, K> operator *(const Mat<T, C, K> &b) const
+        {
+            Mat<T, R, K> r;
+            for (unsigned int i = 0; i < R; i++) {
+                T *row = r.Row(i);
+                VecOps<T, K>::Scale(b.Row(0), m[i * C], row);
+                for (unsigned int k = 1; k < C; k++) {
+                    VecOps<T, K>::MulAdd(row, b.Row(k), m[i * C + k], row);
+                }
+            }
+            return r;
+        }
+
+        // Matrix times column vector.
+        Vec<T, R> operator *(const Vec<T, C> &x) const
+        {
+            Vec<T, R> r;
+            for (unsigned int i = 0; i < R; i++) {
+                r[i] = VecOps<T, C>::Dot(Row(i), x.Data());
+            }
+            return r;
+        }
+
+        Mat operator +(const Mat &b) const
+        {
+            Mat r;
+            for (unsigned int i = 0; i < R; i++) {
+                VecOps<T, C>::Add(Row(i), b.Row(i), r.Row(i));
+            }
+            return r;
+        }
+
+        Mat operator -(const Mat &b) const
+        {
+            Mat r;
+            for (unsigned int i = 0; i < R; i++) {
+                VecOps<T, C>::Sub(Row(i), b.Row(i), r.Row(i));
+            }
+            return r;
+        }
+
+        Mat operator *(const T k) const
+        {
+            Mat r;
+            for (unsigned int i = 0; i < R; i++) {
+                VecOps<T, C>::Scale(Row(i), k, r.Row(i));
+            }
+            return r;
+        }
+
+        Mat<T, C, R> Transposed() const
+        {
+            Mat<T, C, R> r;
+            for (unsigned int i = 0; i < R; i++) {
+                for (unsigned int j = 0; j < C; j++) {
+                    r.m[j * R + i] = m[i * C + j];
+                }
+            }
+            return r;
+        }
+    };
+
+    // Row vector times matrix: the sum of the matrix rows weighted by x.
+    template<typename T, unsigned int R, unsigned int C>
+    Vec<T, C> operator *(const Vec<T, R> &x, const Mat<T, R, C> &a)
+    {
+        Vec<T, C> r;
+        VecOps<T, C>::Scale(a.Row(0), x[0], r.Data());
+        for (unsigned int k = 1; k < R; k++) {
+            VecOps<T, C>::MulAdd(r.Data(), a.Row(k), x[k], r.Data());
+        }
+        return r;
+    }
+
+    typedef Vec<float, 2> Vec2f;
+    typedef Vec<float, 3> Vec3f;
+    typedef Vec<float, 4> Vec4f;
+    typedef Vec<float, 8> Vec8f;
+    typedef Vec<double, 2> Vec2d;
+    typedef Vec<double, 3> Vec3d;
+    typedef Vec<double, 4> Vec4d;
+    typedef Vec<Float16, 4> Vec4h;
+
+    typedef Mat<float, 3, 3> Mat3f;
+    typedef Mat<float, 3, 4> Mat3x4f;
+    typedef Mat<float, 4, 4> Mat4f;
+    typedef Mat<double, 4, 4> Mat4d;
+
+    // The four-component vector the hand-written classes never had.
+    typedef Vec4f Vector4;
+}
+#endif // __BCOSTA_VEC__
@@ -0,0 +1,227 @@
+#include <math.h>
+#include <stdio.h>
+#include <random>
+#include "matrix3.h"
+#include "matrix4.h"
+#include "vec.h"
+#include "vector.h"
+
+using namespace BCosta;
+
+// Instantiates the Vec and Mat templates with their SIMD specializations and checks them
+// against plain loops, and checks Vector2, Vector3, Matrix3 and Matrix4 on top of them
+// against their scalar formulas. Returns nonzero on failure.
+
+namespace BCosta
+{
+    // Every member, including the ones nothing else in the tree calls yet.
+    template class Vec<float, 2>;
+    template class Vec<float, 3>;
+    template class Vec<float, 4>;
+    template class Vec<float, 8>;
+    template class Vec<double, 2>;
+    template class Vec<double, 4>;
+    template class Vec<Float16, 4>;
+    template class Vec<Float16, 8>;
+    template class Mat<float, 3, 3>;
+    template class Mat<float, 3, 4>;
+    template class Mat<float, 4, 4>;
+    template class Mat<double, 4, 4>;
+}
+
+namespace
+{
+    unsigned int failures = 0;
+
+    void Check(const bool ok, const char *what, const double error)
+    {
+        if (!ok) {
+            if (failures < 20) {
+                printf("FAIL %s, error %g\n", what, error);
+            }
+            failures++;
+        }
+    }
+
+    template<typename T, unsigned int N>
+    void CheckVec(std::mt19937 &engine, const char *name, const double tolerance)
+    {
+        std::uniform_real_distribution<float> uniform(-2.f, 2.f);
+        for (unsigned int s = 0; s < 100; s++) {
+            Vec<T, N> a, b;
+            float fa[N], fb[N];
+            for (unsigned int i = 0; i < N; i++) {
+                a[i] = T(uniform(engine));
+                b[i] = T(uniform(engine));
+                fa[i] = (float) a[i];
+                fb[i] = (float) b[i];
+            }
+            const float k = uniform(engine);
+            const Vec<T, N> sum = a + b, difference = a - b, product = a * b, scaled = a * T(k);
+            const Vec<T, N> lerp = Vec<T, N>::Lerp(a, b, T(.25f));
+            const Vec<T, N> low = Vec<T, N>::Min(a, b), high = Vec<T, N>::Max(a, b);
+
+            double dot = 0.0, error = 0.0;
+            for (unsigned int i = 0; i < N; i++) {
+                dot += (double) fa[i] * fb[i];
+                error = fmax(error, fabs((double) sum[i] - (fa[i] + fb[i])));
+                error = fmax(error, fabs((double) difference[i] - (fa[i] - fb[i])));
+                error = fmax(error, fabs((double) product[i] - fa[i] * fb[i]));
+                error = fmax(error, fabs((double) scaled[i] - fa[i] * (float) T(k)));
+                error = fmax(error, fabs((double) lerp[i] - (fa[i] + (fb[i] - fa[i]) * .25f)));
+                error = fmax(error, fabs((double) low[i] - fmin(fa[i], fb[i])));
+                error = fmax(error, fabs((double) high[i] - fmax(fa[i], fb[i])));
+            }
+            error = fmax(error, fabs((double) Vec<T, N>::Dot(a, b) - dot) / N);
+            Check(error <= tolerance, name, error);
+
+            const double len = (double) a.Normalized().Len();
+            Check(fabs(len - 1.0) <= tolerance * N, name, fabs(len - 1.0));
+        }
+    }
+
+    Mat4d ToMatD(const Mat4f &m)
+    {
+        Mat4d r;
+        for (unsigned int i = 0; i < 4; i++) {
+            for (unsigned int j = 0; j < 4; j++) {
+                r(i, j) = m(i, j);
+            }
+        }
+        return r;
+    }
+
+    void CheckMat(std::mt19937 &engine)
+    {
+        std::uniform_real_distribution<float> uniform(-2.f, 2.f);
+        for (unsigned int s = 0; s < 100; s++) {
+            Matrix4 a, b;
+            for (unsigned int i = 0; i < 16; i++) {
+                a.m[i] = uniform(engine);
+                b.m[i] = uniform(engine);
+            }
+            const Mat4f &ma = a, &mb = b;
+            const Mat4f product = ma * mb;
+            const Mat4d product_d = ToMatD(ma) * ToMatD(mb);
+            const Vector4 x(uniform(engine), uniform(engine), uniform(engine), uniform(engine));
+            const Vector4 y = ma * x;
+
+            double error = 0.0;
+            for (unsigned int i = 0; i < 4; i++) {
+                double expected_y = 0.0;
+                for (unsigned int j = 0; j < 4; j++) {
+                    double expected = 0.0;
+                    for (unsigned int k = 0; k < 4; k++) {
+                        expected += (double) a.m[i * 4 + k] * b.m[k * 4 + j];
+                    }
+                    error = fmax(error, fabs(product(i, j) - expected));
+                    error = fmax(error, fabs(product_d(i, j) - expected));
+                    expected_y += (double) a.m[i * 4 + j] * x[j];
+                }
+                error = fmax(error, fabs(y[i] - expected_y));
+            }
+            Check(error <= 1e-5, "Mat4 product", error);
+
+            const Matrix4 back = ma.Transposed().Transposed();
+            bool same = true;
+            for (unsigned int i = 0; i < 16; i++) {
+                same = same && back.m[i] == a.m[i];
+            }
+            Check(same, "Matrix4 transpose", 0.0);
+        }
+
+        const Vec3f c = Cross(Vec3f(1.f, 0.f, 0.f), Vec3f(0.f, 1.f, 0.f));
+        Check(c == Vec3f(0.f, 0.f, 1.f), "Cross", 0.0);
+    }
+
+    // The historical classes: element order, layout and results of their scalar formulas.
+    void CheckClasses(std::mt19937 &engine)
+    {
+        static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 must be two packed floats");
+        static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be three packed floats");
+        static_assert(sizeof(Matrix3) == 9 * sizeof(float), "Matrix3 must be nine packed floats");
+        static_assert(sizeof(Matrix4) == 16 * sizeof(float), "Matrix4 must be sixteen packed floats");
+
+        std::uniform_real_distribution<float> uniform(-2.f, 2.f);
+        for (unsigned int s = 0; s < 100; s++) {
+            Vector3 a(uniform(engine), uniform(engine), uniform(engine));
+            Vector3 b(uniform(engine), uniform(engine), uniform(engine));
+            const float k = uniform(engine);
+
+            const Vector3 sum = a + b, quotient = a / k, cross = a.Cross(b);
+            bool same = &a.x == a.Data() && a[1] == a.y && a[2] == a.z;
+            same = same && sum.x == a.x + b.x && sum.y == a.y + b.y && sum.z == a.z + b.z;
+            same = same && quotient.x == a.x / k && quotient.y == a.y / k && quotient.z == a.z / k;
+            same = same && cross.x == a.y * b.z - a.z * b.y && cross.y == a.z * b.x - a.x * b.z &&
+                   cross.z == a.x * b.y - a.y * b.x;
+            same = same && Vector3::Dot(a, b) == a.x * b.x + a.y * b.y + a.z * b.z;
+            same = same && a.Len2() == a.x * a.x + a.y * a.y + a.z * a.z;
+            Vector3 n = a;
+            n.normalize();
+            const float l = a.Len();
+            same = same && n.x == a.x / l && n.y == a.y / l && n.z == a.z / l;
+            Check(same, "Vector3", 0.0);
+
+            Matrix4 m, p;
+            Matrix3 r, q;
+            for (unsigned int i = 0; i < 16; i++) {
+                m.m[i] = uniform(engine);
+                p.m[i] = uniform(engine);
+            }
+            for (unsigned int i = 0; i < 9; i++) {
+                r.m[i] = uniform(engine);
+                q.m[i] = uniform(engine);
+            }
+
+            // Products add their terms in the order the hand-written ones did.
+            const Matrix4 mp = m * p;
+            same = true;
+            for (unsigned int i = 0; i < 4; i++) {
+                for (unsigned int j = 0; j < 4; j++) {
+                    const float e = m.m[i * 4] * p.m[j] + m.m[i * 4 + 1] * p.m[4 + j] +
+                                    m.m[i * 4 + 2] * p.m[8 + j] + m.m[i * 4 + 3] * p.m[12 + j];
+                    same = same && mp.m[i * 4 + j] == e;
+                }
+            }
+            Matrix3 rq = r;
+            rq.Multiply(&q);
+            for (unsigned int i = 0; i < 3; i++) {
+                for (unsigned int j = 0; j < 3; j++) {
+                    const float e = r.m[i * 3] * q.m[j] + r.m[i * 3 + 1] * q.m[3 + j] + r.m[i * 3 + 2] * q.m[6 + j];
+                    same = same && rq.m[i * 3 + j] == e;
+                }
+            }
+            Vector2 v(uniform(engine), uniform(engine));
+            const Vector2 w = v * r;
+            same = same && w.x == v.x * r.m[0] + v.y * r.m[3] + r.m[6] && w.y == v.x * r.m[1] + v.y * r.m[4] + r.m[7];
+            const Vector3 t = a * m;
+            for (unsigned int i = 0; i < 3; i++) {
+                same = same && t[i] == a.x * m.m[i * 4] + a.y * m.m[i * 4 + 1] + a.z * m.m[i * 4 + 2] + m.m[i * 4 + 3];
+            }
+            Check(same, "Matrix products", 0.0);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 engine(99);
+    CheckVec<float, 2>(engine, "Vec2f", 1e-5);
+    CheckVec<float, 3>(engine, "Vec3f", 1e-5);
+    CheckVec<float, 4>(engine, "Vec4f", 1e-5);
+    CheckVec<float, 8>(engine, "Vec8f", 1e-5);
+    CheckVec<double, 2>(engine, "Vec2d", 1e-5);
+    CheckVec<double, 4>(engine, "Vec4d", 1e-5);
+    // Every Float16 result is rounded to 11 significant bits.
+    CheckVec<Float16, 4>(engine, "Vec4h", 1e-2);
+    CheckVec<Float16, 8>(engine, "Vec8h", 1e-2);
+    CheckMat(engine);
+    CheckClasses(engine);
+
+    if (failures) {
+        printf("%u failures\n", failures);
+        return 1;
+    }
+    printf("Vec, Mat: all kernels match\n");
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "vector.h"
+#include "matrix3.h"
 #include "matrix4.h"
+#include "profile.h"
 
 using namespace BCosta;
 
@@ -11,41 +13,41 @@ const Vector3 Vector3::origin(0.f, 0.f, 0.f);
 
 const Vector3 Vector3::identity(1.f, 1.f, 1.f);
 
+Vector2 Vector2::operator *(const Matrix3 &m)
+{
+    const Vec3f p = Vec3f(x, y, 1.f) * m;
+    return Vector2(p.x, p.y);
+}
+
+void Vector2::operator *=(const Matrix3 &m)
+{ *this = *this * m; }
+
+// The point's implicit w = 1 adds the translation column; three-wide dots avoid packing a
+// Vector4 per point.
 Vector3 Vector3::operator *(const Matrix4 &m)
 {
     return Vector3(
-        x * m.m[0] + y * m.m[1] + z * m.m[2] + m.m[3],
-        x * m.m[4] + y * m.m[5] + z * m.m[6] + m.m[7],
-        x * m.m[8] + y * m.m[9] + z * m.m[10] + m.m[11]
+        VecOps<float, 3>::Dot(m.Row(0), Data()) + m.m[3],
+        VecOps<float, 3>::Dot(m.Row(1), Data()) + m.m[7],
+        VecOps<float, 3>::Dot(m.Row(2), Data()) + m.m[11]
     );
 }
 
 void Vector3::operator *=(const Matrix4 &m)
-{
-    float _x = x, _y = y, _z = z;
-    x = _x * m.m[0] + _y * m.m[1] + _z * m.m[2] + m.m[3];
-    y = _x * m.m[4] + _y * m.m[5] + _z * m.m[6] + m.m[7];
-    z = _x * m.m[8] + _y * m.m[9] + _z * m.m[10] + m.m[11];
-}
+{ *this = *this * m; }
 
 Vector3 Vector3::Normalized()
-{
-    float l = 1.f / Len();
-    return Vector3(x * l, y * l, z * l);
-}
+{ return Vec3f::operator *(1.f / Len()); }
 
 Vector3 &Vector3::normalize()
 {
+    BCOSTA_PROFILE_SCOPE(Op_Vector3Normalize);
     float l = Len();
     if (l) {
-        x /= l, y /= l, z /= l;
+        Vec3f::operator /=(Vec3f(l));
     }
     return *this;
 }
 
 const void Vector3::Cross(Vector3 &r, const Vector3 &a, const Vector3 &b)
-{
-    r.x = a.y * b.z - a.z * b.y;
-    r.y = a.z * b.x - a.x * b.z;
-    r.z = a.x * b.y - a.y * b.x;
-}
\ No newline at end of file
+{ r = BCosta::Cross<float>(a, b); }
\ No newline at end of file
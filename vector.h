@@ -2,109 +2,85 @@
 #define __BCOSTA_MATH_VECTOR__
 
 #include <math.h>
+#include "vec.h"
 
 namespace BCosta
 {
+    class Matrix3;
     class Matrix4;
 
-    class Vector2
+    // Vec<float, 2> under its historical interface.
+    class Vector2 : public Vec2f
     {
     public:
 
-        float x, y;
-
         Vector2()
-        {
-            x = 0.f;
-            y = 0.f;
-        }
+        { }
 
         Vector2(float a, float b)
-        {
-            x = a;
-            y = b;
-        }
+            : Vec2f(a, b)
+        { }
 
-        Vector2(const Vector2 &v)
-        {
-            x = v.x;
-            y = v.y;
-        }
-
-        Vector2 &operator =(const Vector2 &v)
-        {
-            x = v.x, y = v.y;
-            return *this;
-        }
+        Vector2(const Vec2f &v)
+            : Vec2f(v)
+        { }
 
         Vector2 operator +(const Vector2 &b)
-        { return Vector2(x + b.x, y + b.y); }
+        { return Vec2f::operator +(b); }
 
         Vector2 operator +(const float &k)
-        { return Vector2(x + k, y + k); }
+        { return Vec2f::operator +(Vec2f(k)); }
 
         Vector2 operator -(const Vector2 &b)
-        { return Vector2(x - b.x, y - b.y); }
+        { return Vec2f::operator -(b); }
 
         Vector2 operator -(const float &k)
-        { return Vector2(x - k, y - k); }
+        { return Vec2f::operator -(Vec2f(k)); }
 
         Vector2 operator *(const Vector2 &b)
-        { return Vector2(x * b.x, y * b.y); }
+        { return Vec2f::operator *(b); }
 
         Vector2 operator *(const float &k)
-        { return Vector2(x * k, y * k); }
+        { return Vec2f::operator *(k); }
 
         Vector2 operator /(const Vector2 &b)
-        { return Vector2(x / b.x, y / b.y); }
+        { return Vec2f::operator /(b); }
 
         Vector2 operator /(const float &k)
-        { return Vector2(x / k, y / k); }
+        { return Vec2f::operator /(Vec2f(k)); }
 
         Vector2 operator -() const
-        { return Vector2(-x, -y); }
+        { return Vec2f::operator -(); }
 
         bool operator ==(const Vector2 &b)
-        { return x == b.x && y == b.y; }
+        { return Vec2f::operator ==(b); }
 
         bool operator !=(const Vector2 &b)
-        { return x != b.x || y != b.y; }
+        { return Vec2f::operator !=(b); }
 
         void operator +=(const Vector2 &b)
-        {
-            x += b.x;
-            y += b.y;
-        }
+        { Vec2f::operator +=(b); }
 
         void operator +=(const float &k)
-        {
-            x += k;
-            y += k;
-        }
+        { Vec2f::operator +=(Vec2f(k)); }
 
         void operator -=(const Vector2 &b)
-        {
-            x -= b.x;
-            y -= b.y;
-        }
+        { Vec2f::operator -=(b); }
 
         void operator -=(const float &k)
-        {
-            x -= k;
-            y -= k;
-        }
+        { Vec2f::operator -=(Vec2f(k)); }
 
         void operator *=(const Vector2 &b)
-        {
-            x *= b.x;
-            y *= b.y;
-        }
+        { Vec2f::operator *=(b); }
 
         void operator *=(const float &k)
-        {
-            x *= k;
-            y *= k;
-        }
+        { Vec2f::operator *=(k); }
+
+        // Point times a 2D transform: row vector, translation in m[6] and m[7], as built by
+        // Matrix3::Translation and RotationZAxis.
+        Vector2 operator *(const Matrix3 &m);
+
+        void operator *=(const Matrix3 &m);
 
         void Set(float _x, float _y)
         {
@@ -113,20 +89,19 @@ namespace BCosta
         }
 
         float Lenght2()
-        { return (float) (x * x + y * y); }
+        { return Len2(); }
 
         float Lenght()
-        { return sqrt((float) (x * x + y * y)); }
+        { return Len(); }
 
         Vector2 Reverse()
-        { return Vector2(-x, -y); }
+        { return Vec2f::operator -(); }
 
         void Normalize()
         {
-            float l = Lenght();
+            float l = Len();
             if (l) {
-                x /= l;
-                y /= l;
+                Vec2f::operator /=(Vec2f(l));
             }
         }
 
@@ -143,142 +118,88 @@ namespace BCosta
         static const Vector2 identity;
 
         static const float dot(const Vector2 &a, const Vector2 &b)
-        { return a.x * b.x + a.y * b.y; }
+        { return Dot(a, b); }
 
         static const float dist(const Vector2 &a, const Vector2 &b)
-        { return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y)); }
+        { return Dist(a, b); }
     };
 
-    class Vector3
+    // Vec<float, 3> under its historical interface.
+    class Vector3 : public Vec3f
     {
     public:
 
-        float x, y, z;
-
         Vector3()
-        {
-            x = 0.f;
-            y = 0.f;
-            z = 0.f;
-        }
+        { }
 
         Vector3(float v)
-        {
-            x = v;
-            y = v;
-            z = v;
-        }
+            : Vec3f(v)
+        { }
 
         Vector3(float a, float b, float c)
-        {
-            x = a;
-            y = b;
-            z = c;
-        }
+            : Vec3f(a, b, c)
+        { }
 
-        Vector3(const Vector3 &v)
-        {
-            x = v.x;
-            y = v.y;
-            z = v.z;
-        }
-
-        Vector3 &operator =(const Vector3 &v)
-        {
-            x = v.x;
-            y = v.y;
-            z = v.z;
-            return *this;
-        }
+        Vector3(const Vec3f &v)
+            : Vec3f(v)
+        { }
 
         Vector3 operator +(const Vector3 &b)
-        { return Vector3(x + b.x, y + b.y, z + b.z); }
+        { return Vec3f::operator +(b); }
 
         Vector3 operator +(const float &k)
-        { return Vector3(x + k, y + k, z + k); }
+        { return Vec3f::operator +(Vec3f(k)); }
 
         Vector3 operator -(const Vector3 &b)
-        { return Vector3(x - b.x, y - b.y, z - b.z); }
+        { return Vec3f::operator -(b); }
 
         Vector3 operator -(const float &k)
-        { return Vector3(x - k, y - k, z - k); }
+        { return Vec3f::operator -(Vec3f(k)); }
 
         Vector3 operator *(const Vector3 &b)
-        { return Vector3(x * b.x, y * b.y, z * b.z); }
+        { return Vec3f::operator *(b); }
 
         Vector3 operator *(const float &k)
-        { return Vector3(x * k, y * k, z * k); }
+        { return Vec3f::operator *(k); }
 
         Vector3 operator /(const Vector3 &b)
-        { return Vector3(x / b.x, y / b.y, z / b.z); }
+        { return Vec3f::operator /(b); }
 
         Vector3 operator /(const float &k)
-        { return Vector3(x / k, y / k, z / k); }
+        { return Vec3f::operator /(Vec3f(k)); }
 
         Vector3 operator -() const
-        { return Vector3(-x, -y, -z); }
+        { return Vec3f::operator -(); }
 
         bool operator ==(const Vector3 &b)
-        { return x == b.x && y == b.y && z == b.z; }
+        { return Vec3f::operator ==(b); }
 
         bool operator !=(const Vector3 &b)
-        { return x != b.x || y != b.y || z != b.z; }
+        { return Vec3f::operator !=(b); }
 
         void operator +=(const Vector3 &b)
-        {
-            x += b.x;
-            y += b.y;
-            z += b.z;
-        }
+        { Vec3f::operator +=(b); }
 
         void operator +=(const float &k)
-        {
-            x += k;
-            y += k;
-            z += k;
-        }
+        { Vec3f::operator +=(Vec3f(k)); }
 
         void operator -=(const Vector3 &b)
-        {
-            x -= b.x;
-            y -= b.y;
-            z -= b.z;
-        }
+        { Vec3f::operator -=(b); }
 
         void operator -=(const float &k)
-        {
-            x -= k;
-            y -= k;
-            z -= k;
-        }
+        { Vec3f::operator -=(Vec3f(k)); }
 
         void operator *=(const Vector3 &b)
-        {
-            x *= b.x;
-            y *= b.y;
-            z *= b.z;
-        }
+        { Vec3f::operator *=(b); }
 
         void operator *=(const float &k)
-        {
-            x *= k;
-            y *= k;
-            z *= k;
-        }
+        { Vec3f::operator *=(k); }
 
         void operator /=(const Vector3 &b)
-        {
-            x /= b.x;
-            y /= b.y;
-            z /= b.z;
-        }
+        { Vec3f::operator /=(b); }
 
         void operator /=(const float &k)
-        {
-            x /= k;
-            y /= k;
-            z /= k;
-        }
+        { Vec3f::operator /=(Vec3f(k)); }
 
         Vector3 operator *(const Matrix4 &m);
 
@@ -299,20 +220,20 @@ namespace BCosta
         }
 
         Vector3 Cross(const Vector3 v)
-        { return Vector3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+        { return BCosta::Cross<float>(*this, v); }
 
         float Len()
-        { return sqrt((float) (x * x + y * y + z * z)); }
+        { return Vec3f::Len(); }
 
         float Len2()
-        { return (float) (x * x + y * y + z * z); }
+        { return Vec3f::Len2(); }
 
         Vector3 &normalize();
 
         Vector3 Normalized();
 
         Vector3 Reverse()
-        { return Vector3(-x, -y, -z); }
+        { return Vec3f::operator -(); }
 
         void Zeroify()
         { x = y = z = 0.f; }
@@ -323,10 +244,10 @@ namespace BCosta
         static const void Cross(Vector3 &r, const Vector3 &a, const Vector3 &b);
 
         static const float Dot(const Vector3 &a, const Vector3 &b)
-        { return a.x * b.x + a.y * b.y + a.z * b.z; }
+        { return Vec3f::Dot(a, b); }
 
         static const float Dist(const Vector3 &a, const Vector3 &b)
-        { return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z)); }
+        { return Vec3f::Dist(a, b); }
     };
 }
 #endif // __BCOSTA_MATH_VECTOR__
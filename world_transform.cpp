@@ -0,0 +1,117 @@
+#include "world_transform.h"
+#include "matrix4.h"
+#include "parallel.h"
+
+using namespace BCosta;
+
+static const unsigned int grain = 8192;
+
+namespace
+{
+    void Write(const float *l, const Vector3d &t, const Vector3d &origin, Matrix4 &out)
+    {
+        float *m = out.m;
+        m[0] = l[0];
+        m[1] = l[1];
+        m[2] = l[2];
+        m[3] = (float) (t.x - origin.x);
+        m[4] = l[3];
+        m[5] = l[4];
+        m[6] = l[5];
+        m[7] = (float) (t.y - origin.y);
+        m[8] = l[6];
+        m[9] = l[7];
+        m[10] = l[8];
+        m[11] = (float) (t.z - origin.z);
+        m[12] = m[13] = m[14] = 0.f;
+        m[15] = 1.f;
+    }
+}
+
+WorldTransform WorldTransform::Compose(const Vector3d &t, const Quaternion &r, const Vector3 &s)
+{
+    WorldTransform w;
+    r.ToRotationScale(s, w.linear);
+    w.translation = t;
+    return w;
+}
+
+WorldTransform WorldTransform::Identity()
+{
+    WorldTransform w;
+    for (unsigned int i = 0; i < 9; i++) {
+        w.linear[i] = i % 4 == 0 ? 1.f : 0.f;
+    }
+    return w;
+}
+
+WorldTransform WorldTransform::operator *(const WorldTransform &b) const
+{
+    WorldTransform r;
+    for (unsigned int i = 0; i < 3; i++) {
+        for (unsigned int j = 0; j < 3; j++) {
+            r.linear[i * 3 + j] = linear[i * 3] * b.linear[j] + linear[i * 3 + 1] * b.linear[3 + j] +
+                                  linear[i * 3 + 2] * b.linear[6 + j];
+        }
+    }
+    r.translation = TransformPoint(b.translation);
+    return r;
+}
+
+Vector3d WorldTransform::TransformPoint(const Vector3d &p) const
+{
+    return Vector3d(
+        linear[0] * p.x + linear[1] * p.y + linear[2] * p.z + translation.x,
+        linear[3] * p.x + linear[4] * p.y + linear[5] * p.z + translation.y,
+        linear[6] * p.x + linear[7] * p.y + linear[8] * p.z + translation.z
+    );
+}
+
+Vector3d WorldTransform::TransformVector(const Vector3 &v) const
+{
+    return Vector3d(
+        (double) linear[0] * v.x + (double) linear[1] * v.y + (double) linear[2] * v.z,
+        (double) linear[3] * v.x + (double) linear[4] * v.y + (double) linear[5] * v.z,
+        (double) linear[6] * v.x + (double) linear[7] * v.y + (double) linear[8] * v.z
+    );
+}
+
+void WorldTransform::Concatenate(const WorldTransform *parents, const WorldTransform *locals,
+                                 const unsigned int count, WorldTransform *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            out[i] = parents[i] * locals[i];
+        }
+    });
+}
+
+void Rebase::ToMatrices(const WorldTransform *in, const unsigned int count, const Vector3d &origin, Matrix4 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            Write(in[i].linear, in[i].translation, origin, out[i]);
+        }
+    });
+}
+
+void Rebase::ToMatrices(const Vector3d *translations, const Quaternion *rotations, const Vector3 *scales,
+                        const unsigned int count, const Vector3d &origin, Matrix4 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        float l[9];
+        for (unsigned int i = begin; i < end; i++) {
+            rotations[i].ToRotationScale(scales[i], l);
+            Write(l, translations[i], origin, out[i]);
+        }
+    });
+}
+
+void Rebase::ToPoints(const Vector3d *in, const unsigned int count, const Vector3d &origin, Vector3 *out)
+{
+    Parallel::For(count, grain, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            out[i].Set((float) (in[i].x - origin.x), (float) (in[i].y - origin.y), (float) (in[i].z - origin.z));
+        }
+    });
+}
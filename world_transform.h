@@ -0,0 +1,117 @@
+#ifndef __BCOSTA_WORLD_TRANSFORM__
+#define __BCOSTA_WORLD_TRANSFORM__
+
+#include <math.h>
+#include "quaternion.h"
+#include "vector.h"
+
+namespace BCosta
+{
+    class Matrix4;
+
+    // Double-precision position for large worlds, where float spacing exceeds a millimeter
+    // beyond ~16 km from the origin.
+    class Vector3d
+    {
+    public:
+
+        double x, y, z;
+
+        Vector3d()
+        {
+            x = 0.0;
+            y = 0.0;
+            z = 0.0;
+        }
+
+        Vector3d(double a, double b, double c)
+        {
+            x = a;
+            y = b;
+            z = c;
+        }
+
+        explicit Vector3d(const Vector3 &v)
+        {
+            x = v.x;
+            y = v.y;
+            z = v.z;
+        }
+
+        Vector3d operator +(const Vector3d &b) const
+        { return Vector3d(x + b.x, y + b.y, z + b.z); }
+
+        Vector3d operator -(const Vector3d &b) const
+        { return Vector3d(x - b.x, y - b.y, z - b.z); }
+
+        Vector3d operator *(const double k) const
+        { return Vector3d(x * k, y * k, z * k); }
+
+        void operator +=(const Vector3d &b)
+        {
+            x += b.x;
+            y += b.y;
+            z += b.z;
+        }
+
+        void operator -=(const Vector3d &b)
+        {
+            x -= b.x;
+            y -= b.y;
+            z -= b.z;
+        }
+
+        double Len() const
+        { return sqrt(x * x + y * y + z * z); }
+
+        // Nearest float vector; only meaningful once rebased close to the origin.
+        Vector3 ToFloat() const
+        { return Vector3((float) x, (float) y, (float) z); }
+
+        static double Dot(const Vector3d &a, const Vector3d &b)
+        { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    };
+
+    // Affine transform with a float linear part (rotation and scale need no more) and a
+    // double translation: world = linear * local + translation.
+    //
+    // Hierarchies compose in this form, and rendering goes through Rebase, which turns it
+    // into float matrices relative to a camera origin.
+    struct WorldTransform
+    {
+        // Row-major 3x3.
+        float linear[9];
+        Vector3d translation;
+
+        static WorldTransform Compose(const Vector3d &t, const Quaternion &r, const Vector3 &s);
+
+        static WorldTransform Identity();
+
+        // this * b: b applied first, as with Matrix4.
+        WorldTransform operator *(const WorldTransform &b) const;
+
+        Vector3d TransformPoint(const Vector3d &p) const;
+
+        // Local offset to world: linear part only, in double.
+        Vector3d TransformVector(const Vector3 &v) const;
+
+        // out[i] = parents[i] * locals[i] over whole arrays, in parallel.
+        static void Concatenate(const WorldTransform *parents, const WorldTransform *locals,
+                                const unsigned int count, WorldTransform *out);
+    };
+
+    // Camera-relative rebasing: subtract a double origin and emit float data. Differences
+    // are taken in double before rounding, so nearby objects keep full float precision
+    // wherever the camera is. Passes are straight loops over the arrays, split across threads.
+    namespace Rebase
+    {
+        void ToMatrices(const WorldTransform *in, const unsigned int count, const Vector3d &origin, Matrix4 *out);
+
+        // Same from TRS streams, composed on the fly.
+        void ToMatrices(const Vector3d *translations, const Quaternion *rotations, const Vector3 *scales,
+                        const unsigned int count, const Vector3d &origin, Matrix4 *out);
+
+        void ToPoints(const Vector3d *in, const unsigned int count, const Vector3d &origin, Vector3 *out);
+    }
+}
+#endif // __BCOSTA_WORLD_TRANSFORM__